@@ -3,32 +3,36 @@ BLE Controller Application for Benjamin the Robot
 """
 import sys
 import enum
-import simplepyble
-import numpy as np
-from PyQt6.QtCore import Qt, QRectF, QTimer
+import math
+import argparse
+import time
+from PyQt6.QtCore import Qt, QTimer
 from PyQt6.QtWidgets import QApplication, QWidget, QCheckBox, QVBoxLayout, QHBoxLayout, QGridLayout, QPushButton, QLabel
-from PyQt6.QtGui import QPainter
+from radar_frame import decode_radar_frame
+from drive_tx import DriveTransmitter
+from drive_packet import DRIVE_PACKET_HEADER
+from robot_stats import decode_stats, STATS_CMD_RESET
+from sensor_ranges import decode_sensor_ranges
+from notify_queue import NotifyQueue, NotifyKind, Notification, NOTIFY_QUEUE_DEPTH
+from ble_link import BleLoop, RobotFinder, RobotLink, BLEStatus, stop_links, DRIVE_CHARACTERISTIC, STATS_CHARACTERISTIC
+from radar_view import RadarView, RADAR_VIEW_COLUMNS
+from session_log import SessionRecorder, SessionReplay
 
 
 WINDOW_WIDTH = 400
 WINDOW_HEIGHT = 400
+FLEET_TILE_WIDTH = 320
+FLEET_TILE_HEIGHT = 400
 
-MAC_ADDRESS = "f7:6d:e3:5f:cb:f9"
-BLE_SCAN_TIMEOUT_MS = 3000
-
-MOVEMENT_SERVICE = "e9ea0001-e19b-482d-9293-c7907585fc48"
-MOVEMENT_CHARACTERISTIC = "e9ea0003-e19b-482d-9293-c7907585fc48"
-TRANSMIT_MOVE_COMMAND_PERIOD_MS = 80        # Transmits move command 
-
-RADAR_SERVICE = "6e400001-b5a3-f393-e0a9-e50e24dcca9e"
-RADAR_CHARACTERISTIC = "6e400003-b5a3-f393-e0a9-e50e24dcca9e"
-POLL_RADAR_NOTIFICATION_PERIOD_MS = 10      # Retreives radar notification data
+GUI_FRAME_PERIOD_MS = 16                    # Drains queued notifications into the GUI
+RATE_PERIOD_MS = 1000                       # Updates frame rates and loop lag
 
 
 DIRECTION_CONTROLS = {"forwards": Qt.Key.Key_W,
                       "left": Qt.Key.Key_A,
                       "backwards": Qt.Key.Key_S,
                       "right": Qt.Key.Key_D}
+RESET_STATS_KEY = Qt.Key.Key_R
 
 
 class RobotDir(enum.Enum):
@@ -44,93 +48,19 @@ class RobotDir(enum.Enum):
     e_northwest = 8
 
 
-class BLEStatus(enum.Enum):
-    """ BLE connection status """
-    e_unknown = 0
-    e_connecting = 1
-    e_connected = 2
-    e_disconnecting = 3
-    e_disconnected = 4
+# (throttle, steering) of each direction, per mille of full motor speed
+ROBOT_SPEED = 700
+DRIVE_SETPOINTS = {RobotDir.e_none: (0, 0),
+                   RobotDir.e_north: (ROBOT_SPEED, 0),
+                   RobotDir.e_northeast: (ROBOT_SPEED * 3 // 4, ROBOT_SPEED // 4),
+                   RobotDir.e_east: (0, ROBOT_SPEED),
+                   RobotDir.e_southeast: (-ROBOT_SPEED * 3 // 4, -ROBOT_SPEED // 4),
+                   RobotDir.e_south: (-ROBOT_SPEED, 0),
+                   RobotDir.e_southwest: (-ROBOT_SPEED * 3 // 4, ROBOT_SPEED // 4),
+                   RobotDir.e_west: (0, -ROBOT_SPEED),
+                   RobotDir.e_northwest: (ROBOT_SPEED * 3 // 4, -ROBOT_SPEED // 4)}
 
 
-class RadarGrid(QWidget):
-    """ Radar grid related components """
-    def __init__(self):
-        super().__init__()
-        self.columns = 20
-        self.rows = 20
-        self.column_depth = 0
-        self.row_number = 0
-        self.data = np.zeros((self.rows, self.columns), dtype=bool)
-        
-        self.layout = QVBoxLayout()
-        self.data_box = QLabel("Column: -  Distance: -  Depth: -")
-        self.layout.addWidget(self.data_box, stretch=1)
-        self.layout.addWidget(self, stretch=10)
-
-    def resizeEvent(self, event):
-        # Compute the square size based on the aspect ratio, assuming that the
-        # column and row numbers are fixed
-        reference = self.width() * self.rows / self.columns
-        if reference > self.height():
-            # The window is larger than the aspect ratio
-            # Use the height as a reference (minus 1 pixel)
-            self.squareSize = (self.height() - 1) / self.rows
-        else:
-            # The opposite
-            self.squareSize = (self.width() - 1) / self.columns
-        
-    def paintEvent(self, event):
-        qp = QPainter(self)
-        # Translate the painter by half a pixel to ensure correct line painting
-        qp.translate(0.5, 0.5)
-        qp.setRenderHints(qp.RenderHint.Antialiasing)
-
-        width = self.squareSize * self.columns
-        height = self.squareSize * self.rows
-        # Center the grid
-        left_pos = (self.width() - width) / 2
-        top_pos = (self.height() - height) / 2
-        y = top_pos
-        # We need to add 1 to draw the topmost right/bottom lines too
-        for row in range(self.rows + 1):
-            qp.drawLine(int(left_pos), int(y), int(left_pos) + int(width), int(y))
-            y += self.squareSize
-        x = left_pos
-        for column in range(self.columns + 1):
-            qp.drawLine(int(x), int(top_pos), int(x), int(top_pos) + int(height))
-            x += self.squareSize
-
-        # Create a smaller rectangle
-        objectSize = self.squareSize * 0.8
-        margin = self.squareSize * 0.1
-        objectRect = QRectF(margin, margin, objectSize, objectSize)
-        qp.setBrush(Qt.GlobalColor.darkGreen)
-        for index, value in np.ndenumerate(self.data):
-            row = index[0]
-            col = index[1]
-            if value == True:
-                qp.drawRect(objectRect.translated(
-                    left_pos + col * self.squareSize, top_pos + row * self.squareSize))
-                
-    def write_grid_row(self, col_number, distance):
-        """ Convert distance to squares and write to a row on the grid """
-        depth = self.scale(distance, 0, 1000, 0, self.rows)
-        depth = self.rows - depth
-        self.data_box.setText(f"Column: {col_number}  Distance: {distance}  Depth: {depth}")
-        self.data[:depth, col_number] = 1
-        self.data[depth:, col_number] = 0
-        self.update()
-
-    def scale(self, val, in_min, in_max, out_min, out_max):
-        """ Map a range of values onto another, keeping within bounds """
-        if val < in_min:
-            val = in_min
-        if val > in_max:
-            val = in_max
-        return round((val - in_min) * (out_max - out_min) / (in_max - in_min) + out_min)
-    
-
 class DirIndicatorBox(QCheckBox):
     """ Components for direction indicators"""
     def __init__(self, bin_code_id):
@@ -219,39 +149,66 @@ class DirectionFinder(QWidget):
 
 
 class BLETransceiver():
-    """ GUI module for BLE related functionality """
-    def __init__(self):
+    """ GUI module for BLE related functionality of one robot """
+    def __init__(self, ble_loop, finder, notify_queue, robot=0, resolution=RADAR_VIEW_COLUMNS, recorder=None,
+                 verbose=False):
         super().__init__()
+        self.robot = robot
+        self.verbose = verbose          # Print every radar frame and stats notification
         self.direction = RobotDir.e_none
         self.status = BLEStatus.e_disconnected
-        self.radar_position = 0
-        self.radar_distance = 0
-        self.grid_update_ready = False
+        self.link_wanted = False
+        self.battery_level = None       # Percent, from the Battery Service
+        self.battery_mv = 0             # From the stats, 0 until the robot has measured it
+        self.link_summary = "link -"    # From the stats
+        self.frames = 0                 # Radar frames since the last rate update
+        self.frame_rate = 0
+        self.replayed_drive = None      # (throttle, steering) of the latest drive command in a replay
+        self.recorder = recorder
+        self.link = RobotLink(ble_loop, finder, notify_queue, robot)
+        self.transmitter = DriveTransmitter(self.send_drive)
+        self.radar = RadarView(resolution, resolution)
 
         self.layout = QHBoxLayout()
         self.ble_label = QLabel("BLE Status: ")
         self.ble_status_label = QLabel(self.status.name)
         self.checkbox = QCheckBox()
+        self.battery_label = QLabel()
+        self.tx_label = QLabel()
+        self.link_label = QLabel()
+        self.ranges_label = QLabel("Sensors: -")
         self.ble_button = QPushButton("Connect")
         self.ble_button.clicked.connect(self.on_button_press)
         self.layout.addWidget(self.ble_label)
         self.layout.addWidget(self.ble_status_label)
         self.layout.addWidget(self.checkbox)
         self.layout.addWidget(self.ble_button)
+        self.layout.addWidget(self.battery_label)
+        self.update_battery_label()
         self.update_connection_status(BLEStatus.e_disconnected)
 
     def on_button_press(self):
-        """ Handle pressing of Connect button """
-        if self.status is BLEStatus.e_disconnected:
-            self.connect()
-        elif self.status is BLEStatus.e_connected:
-            self.update_connection_status(BLEStatus.e_disconnecting)
-            self.disconnect()   
+        """ Handle pressing of Connect button, the link manager keeps reconnecting until Disconnect """
+        self.set_link_wanted(not self.link_wanted)
+
+    def set_link_wanted(self, wanted):
+        self.link_wanted = wanted
+        if self.link_wanted:
+            self.link.start()
+            self.ble_button.setText("Disconnect")
+        else:
+            self.link.stop()
+            self.ble_button.setText("Connect")
 
     def update_connection_status(self, new_status):
         """ Update BLE status label """
+        if (new_status == BLEStatus.e_connected) != (self.status == BLEStatus.e_connected):
+            self.transmitter.set_connected(new_status == BLEStatus.e_connected)
         self.status = new_status
-        if self.status == BLEStatus.e_connecting:
+        if self.status == BLEStatus.e_scanning:
+            self.ble_status_label.setText("Scanning")
+            self.checkbox.setStyleSheet("QCheckBox::indicator{background-color: yellow}")
+        elif self.status == BLEStatus.e_connecting:
             self.ble_status_label.setText("Connecting")
             self.checkbox.setStyleSheet("QCheckBox::indicator{background-color: yellow}")
         elif self.status == BLEStatus.e_connected:
@@ -264,112 +221,209 @@ class BLETransceiver():
             self.ble_status_label.setText("Disconnected")
             self.checkbox.setStyleSheet("QCheckBox::indicator{background-color: red}")
 
-    def connect(self):
-        """ Attempt to connect to Benjamin """
-        self.adapter = simplepyble.Adapter.get_adapters()[0]
-
-        def scan_found_cb(self, peripheral):
-            self.peripheral = peripheral                
-            if self.peripheral.address() == MAC_ADDRESS:
-                print("Found Benjamin")
-                self.update_connection_status(BLEStatus.e_connecting)
-                self.adapter.scan_stop()
-                self.peripheral.connect()
-                self.update_connection_status(BLEStatus.e_connected)
-                self.ble_button.setText("Disconnect")
-                print("Successfully connected, listing services...")
-                services = peripheral.services()
-                service_characteristic_pairs = []
-                for service in services:
-                    for characteristic in service.characteristics():
-                        service_characteristic_pairs.append((service.uuid(), characteristic.uuid()))
-                print(service_characteristic_pairs)
-        self.adapter.set_callback_on_scan_found(lambda peripheral: scan_found_cb(self, peripheral))
-        print("Starting scan")
-        self.adapter.scan_for(BLE_SCAN_TIMEOUT_MS)
-        if self.status == BLEStatus.e_disconnected:
-            print("Connection failed")
-
-    def disconnect(self):
-        self.peripheral.disconnect()
-        self.update_connection_status(BLEStatus.e_disconnected)
-        self.ble_button.setText("Connect")
-
-    def transmit(self):
-        if self.status == BLEStatus.e_connected:
-            self.peripheral.write_command(MOVEMENT_SERVICE, MOVEMENT_CHARACTERISTIC, str.encode(str(self.direction.value)))
-
-    def process_notification(self):
+    def send_drive(self, packet, on_sent):
+        def sent(sent_at):
+            on_sent(sent_at)
+            if self.recorder is not None:
+                self.recorder.record(Notification(time.monotonic(), NotifyKind.e_drive, packet, self.robot))
+        self.link.write(DRIVE_CHARACTERISTIC, packet, sent)
+
+    def set_selected(self, selected):
+        """ Marks the robot driven by the keys in fleet mode """
+        self.ble_label.setText(f"{'>' if selected else ' '} Robot {self.robot + 1}: ")
+        self.ble_label.setStyleSheet("font-weight: bold" if selected else "")
+
+    def set_direction(self, direction):
+        """ Sent straight away if it changed, kept alive by the transmitter while moving """
+        self.direction = direction
+        self.transmitter.set_setpoint(*DRIVE_SETPOINTS[direction])
+
+    def handle_notification(self, notification):
+        """ Called from the GUI thread for each notification of this robot, in arrival order """
+        if notification.kind is NotifyKind.e_radar:
+            frame = self.radar_frame(notification.data)
+            for position, distance in frame.bins:
+                self.radar.write_bin(position, distance)
+        elif notification.kind is NotifyKind.e_stats:
+            self.stats(notification.data)
+        elif notification.kind is NotifyKind.e_ranges:
+            self.ranges_label.setText(f"Sensors: {decode_sensor_ranges(notification.data).summary()}")
+        elif notification.kind is NotifyKind.e_battery:
+            self.battery(notification.data)
+        elif notification.kind is NotifyKind.e_link:
+            self.update_connection_status(BLEStatus(notification.data[0]))
+        elif notification.kind is NotifyKind.e_drive:
+            _, throttle, steering = DRIVE_PACKET_HEADER.unpack_from(notification.data)
+            self.replayed_drive = (throttle, steering)
+
+    def radar_frame(self, data):
+        """ Decode radar sweep frame """
+        frame = decode_radar_frame(data)
+        self.frames += 1
+        if self.verbose:
+            print(f"-> Robot {self.robot + 1} radar frame {frame.seq} at {frame.timestamp_ms} ms: {len(frame.bins)} bins")
+        return frame
+
+    def stats(self, data):
+        """ Runtime statistics of the robot, printed in full if verbose """
+        stats = decode_stats(data)
+        self.battery_mv = stats.battery_mv
+        self.link_summary = stats.link_summary()
+        if self.verbose:
+            print(f"-> Robot {self.robot + 1} stats: {stats.summary()}")
+
+    def battery(self, data):
+        """ Battery level, only notified by the robot when it changed """
+        self.battery_level = data[0]
+
+    def update_labels(self):
+        """ Called every GUI frame """
+        self.update_battery_label()
+        if self.replayed_drive is None:
+            self.tx_label.setText(self.transmitter.summary())
+        else:
+            self.tx_label.setText(f"Replay drive: throttle {self.replayed_drive[0]} steering {self.replayed_drive[1]}")
+        # Echoes fade between samples, so the view is repainted every frame
+        self.radar.update()
+
+    def update_battery_label(self):
+        level = "--" if self.battery_level is None else f"{self.battery_level}"
+        volts = "-.--" if self.battery_mv == 0 else f"{self.battery_mv / 1000:.2f}"
+        self.battery_label.setText(f"Battery: {level} % {volts} V")
+
+    def update_rates(self, period_s):
+        """ Called once a second """
+        self.frame_rate = self.frames / period_s
+        self.frames = 0
+        self.link_label.setText(f"{self.frame_rate:.1f} frames/s, {self.link_summary}")
+
+    def reset_stats(self):
         if self.status == BLEStatus.e_connected:
-            self.peripheral.notify(RADAR_SERVICE, RADAR_CHARACTERISTIC, lambda data: self.notification_cb(data))
-
-    def notification_cb(self, data):
-        """ Clean radar notification data and prepare for GUI update """
-        # Split around '&' delimeter
-        position_slice = str(data).split("&", 1)[0]
-        distance_slice = str(data).split("&", 1)[1]
-        # Clear up extra characters around value
-        self.radar_position = int(position_slice[2:])
-        self.radar_distance = int(distance_slice.split("&", 1)[0])
-        print(f"-> Raw data notification: {data} Position: {self.radar_position} Distance: {self.radar_distance}")
-        # Set flag to update grid
-        self.grid_update_ready = True
+            self.link.write(STATS_CHARACTERISTIC, bytes([STATS_CMD_RESET]))
 
 
 class MainWindow(QWidget):
-    def __init__(self):
+    def __init__(self, args):
         super().__init__()
 
         # Window settings
         self.setWindowTitle("Benjamin BLE Remote")
-        self.setFixedWidth(400)
-        self.setFixedHeight(400)
-
-        # Radar grid
-        self.grid = RadarGrid()
+        self.replay = SessionReplay(args.replay, args.fast) if args.replay else None
+        robots = max(args.fleet, self.replay.robots) if self.replay else args.fleet
+        self.fleet = robots > 1
+
+        # Connectivity, one loop, scan and notification queue shared by all robots
+        self.notify_queue = NotifyQueue(NOTIFY_QUEUE_DEPTH * robots)
+        self.notify_overflows = 0
+        self.recorder = SessionRecorder(args.record) if args.record else None
+        if self.recorder is not None:
+            self.notify_queue.tap = self.recorder.record
+        self.ble_loop = BleLoop()
+        self.finder = RobotFinder()
+        self.transceivers = [BLETransceiver(self.ble_loop, self.finder, self.notify_queue, robot, args.resolution,
+                                            self.recorder, args.verbose)
+                             for robot in range(robots)]
+        self.selected = 0
+        self.frame_timer = QTimer()
+        self.frame_timer.start(GUI_FRAME_PERIOD_MS)
+        self.frame_timer.timeout.connect(self.update_grid)
+        self.rate_timer = QTimer()
+        self.rate_timer.start(RATE_PERIOD_MS)
+        self.rate_timer.timeout.connect(self.update_rates)
 
         # User input
         self.direction_finder = DirectionFinder()
 
-        # Connectivity
-        self.transceiver = BLETransceiver()
-        self.movement_tx_timer = QTimer()
-        self.movement_tx_timer.start(TRANSMIT_MOVE_COMMAND_PERIOD_MS)
-        self.movement_tx_timer.timeout.connect(self.transceiver.transmit)
-        self.radar_rx_timer = QTimer()
-        self.radar_rx_timer.start(POLL_RADAR_NOTIFICATION_PERIOD_MS)
-        self.radar_rx_timer.timeout.connect(self.update_grid)
-
         # Layout formation
         self.windowLayout = QVBoxLayout()
         self.toplayout = QHBoxLayout()
         self.middleLayout = QHBoxLayout()
         self.bottomLayout = QHBoxLayout()
 
-        # TODO Add battery voltage to gui eventually
-
         # Layout assembly
-        self.toplayout.addLayout(self.grid.layout)
-        self.middleLayout.addLayout(self.direction_finder.layout)
-        self.windowLayout.addLayout(self.toplayout)
-        self.windowLayout.addLayout(self.middleLayout)
-        self.windowLayout.addLayout(self.transceiver.layout)
+        if self.fleet:
+            tiles = QGridLayout()
+            columns = math.ceil(math.sqrt(robots))
+            for transceiver in self.transceivers:
+                tile = QVBoxLayout()
+                tile.addLayout(transceiver.radar.layout)
+                tile.addWidget(transceiver.ranges_label)
+                tile.addLayout(transceiver.layout)
+                tile.addWidget(transceiver.link_label)
+                tile.addWidget(transceiver.tx_label)
+                tiles.addLayout(tile, transceiver.robot // columns, transceiver.robot % columns)
+                transceiver.set_selected(transceiver.robot == self.selected)
+            self.toplayout.addLayout(tiles)
+            self.loop_label = QLabel()
+            self.middleLayout.addLayout(self.direction_finder.layout)
+            self.middleLayout.addWidget(self.loop_label)
+            self.windowLayout.addLayout(self.toplayout)
+            self.windowLayout.addLayout(self.middleLayout)
+            rows = math.ceil(robots / columns)
+            self.resize(columns * FLEET_TILE_WIDTH, rows * FLEET_TILE_HEIGHT + WINDOW_HEIGHT // 4)
+        else:
+            self.setFixedWidth(WINDOW_WIDTH)
+            self.setFixedHeight(WINDOW_HEIGHT)
+            transceiver = self.transceivers[0]
+            self.toplayout.addLayout(transceiver.radar.layout)
+            self.middleLayout.addLayout(self.direction_finder.layout)
+            self.windowLayout.addLayout(self.toplayout)
+            self.windowLayout.addWidget(transceiver.ranges_label)
+            self.windowLayout.addLayout(self.middleLayout)
+            self.windowLayout.addLayout(transceiver.layout)
+            self.windowLayout.addWidget(transceiver.tx_label)
         self.setLayout(self.windowLayout)
         self.show()
-    
+
+        if self.replay is not None:
+            # The replay stands in for the robots
+            for transceiver in self.transceivers:
+                transceiver.ble_button.setEnabled(False)
+            self.replay.start(self.notify_queue)
+        elif self.fleet:
+            for transceiver in self.transceivers:
+                transceiver.set_link_wanted(True)
+
     def update_grid(self):
-        if self.transceiver.status == BLEStatus.e_connected:
-            # Retreive data from radar notification
-            self.transceiver.process_notification()
-            # Write to grid
-            if self.transceiver.grid_update_ready:
-                print("WRITING TO GRID")
-                self.grid.write_grid_row(self.transceiver.radar_position, self.transceiver.radar_distance)
-                self.transceiver.grid_update_ready = False
+        # Every notification received since the last GUI frame is applied in order, then painted once
+        notifications = self.notify_queue.drain()
+        for notification in notifications:
+            self.transceivers[notification.robot].handle_notification(notification)
+        if self.replay is not None:
+            self.replay.finished(len(notifications) == 0)
+        if self.notify_queue.overflows != self.notify_overflows:
+            self.notify_overflows = self.notify_queue.overflows
+            print(f"-> Notification queue overflowed, {self.notify_overflows} dropped")
+        for transceiver in self.transceivers:
+            transceiver.update_labels()
+
+    def update_rates(self):
+        for transceiver in self.transceivers:
+            transceiver.update_rates(RATE_PERIOD_MS / 1000)
+        if self.fleet:
+            lag_ms = self.ble_loop.lag_max_s * 1000
+            self.ble_loop.lag_max_s = 0.0
+            self.loop_label.setText(f"BLE loop lag max {lag_ms:.1f} ms")
+
+    def select(self, robot):
+        """ Stop the robot driven so far and hand the keys to another """
+        if robot == self.selected or robot >= len(self.transceivers):
+            return
+        self.transceivers[self.selected].set_direction(RobotDir.e_none)
+        self.transceivers[self.selected].set_selected(False)
+        self.selected = robot
+        self.transceivers[self.selected].set_selected(True)
 
     def keyPressEvent(self, event):
+        # Auto-repeat would send a stop and a start for every repeat of a held key
+        if event.isAutoRepeat():
+            return
         if event.key() == Qt.Key.Key_Escape:
-            sys.exit()
+            self.close()
+        elif event.key() == RESET_STATS_KEY:
+            self.transceivers[self.selected].reset_stats()
+        elif Qt.Key.Key_1.value <= event.key() <= Qt.Key.Key_9.value:
+            self.select(event.key() - Qt.Key.Key_1.value)
         elif event.key() == DIRECTION_CONTROLS["forwards"]:
             self.direction_finder.forwards_indicator.button_pressed()
         elif event.key() == DIRECTION_CONTROLS["left"]:
@@ -378,9 +432,17 @@ class MainWindow(QWidget):
             self.direction_finder.backwards_indicator.button_pressed()
         elif event.key() == DIRECTION_CONTROLS["right"]:
             self.direction_finder.right_indicator.button_pressed()
-        self.transceiver.direction = self.direction_finder.calculate_dir()
+        self.transceivers[self.selected].set_direction(self.direction_finder.calculate_dir())
+
+    def closeEvent(self, event):
+        stop_links([transceiver.link for transceiver in self.transceivers])
+        if self.recorder is not None:
+            self.recorder.close()
+        event.accept()
 
     def keyReleaseEvent(self, event):
+        if event.isAutoRepeat():
+            return
         if event.key() == DIRECTION_CONTROLS["forwards"]:
             self.direction_finder.forwards_indicator.button_released()
         elif event.key() == DIRECTION_CONTROLS["left"]:
@@ -389,12 +451,26 @@ class MainWindow(QWidget):
             self.direction_finder.backwards_indicator.button_released()
         elif event.key() == DIRECTION_CONTROLS["right"]:
             self.direction_finder.right_indicator.button_released()
-        self.transceiver.direction = self.direction_finder.calculate_dir()
+        self.transceivers[self.selected].set_direction(self.direction_finder.calculate_dir())
 
 
 if __name__ == "__main__":
-    app = QApplication(sys.argv)
-    window = MainWindow()
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--resolution", type=int, default=RADAR_VIEW_COLUMNS,
+                        help="cells along each side of the radar image")
+    parser.add_argument("--fleet", type=int, default=1,
+                        help="number of robots to connect to, shown as tiles and driven one at a time with keys 1 to 9")
+    parser.add_argument("--record", metavar="LOG",
+                        help="record notifications, link changes and drive commands to a session log")
+    parser.add_argument("--replay", metavar="LOG",
+                        help="replay a session log instead of connecting, at the recorded pace")
+    parser.add_argument("--fast", action="store_true",
+                        help="replay as fast as the GUI takes the records")
+    parser.add_argument("--verbose", action="store_true",
+                        help="print every radar frame and stats notification")
+    args, qt_args = parser.parse_known_args()
+    app = QApplication(sys.argv[:1] + qt_args)
+    window = MainWindow(args)
     window.show()
     sys.exit(app.exec())
   
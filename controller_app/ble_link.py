@@ -0,0 +1,284 @@
+"""
+Connection manager for Benjamin the Robot.
+bleak runs in an asyncio event loop on a worker thread, so scanning and
+connecting never block the GUI. Robots are found by the Remote Service UUID
+in their scan response rather than by address, and a link is re-established
+with exponential backoff whenever it drops. Notifications and link status
+changes reach the GUI through the notification queue.
+
+Any number of robots share the one loop and adapter. Each has its own link
+task, and a single scan serves every link waiting for a robot. Nothing in the
+loop blocks, so a drive command waits at most for the callbacks already
+queued, and the loop measures how long that is.
+"""
+import asyncio
+import concurrent.futures
+import enum
+import threading
+import time
+from bleak import BleakClient, BleakScanner
+from bleak.exc import BleakError
+from notify_queue import NotifyKind
+from radar_frame import RADAR_CFG_DELTA
+
+MOVEMENT_SERVICE = "e9ea0001-e19b-482d-9293-c7907585fc48"      # BT_UUID_REMOTE_SERV_VAL, advertised
+MOVEMENT_CHARACTERISTIC = "e9ea0003-e19b-482d-9293-c7907585fc48"
+DRIVE_CHARACTERISTIC = "e9ea0004-e19b-482d-9293-c7907585fc48"
+STATS_CHARACTERISTIC = "e9ea0006-e19b-482d-9293-c7907585fc48"
+
+RADAR_SERVICE = "e9ea0011-e19b-482d-9293-c7907585fc48"
+RADAR_CHARACTERISTIC = "e9ea0012-e19b-482d-9293-c7907585fc48"
+RANGES_CHARACTERISTIC = "e9ea0013-e19b-482d-9293-c7907585fc48"
+
+BATTERY_SERVICE = "0000180f-0000-1000-8000-00805f9b34fb"            # Standard Battery Service
+BATTERY_LEVEL_CHARACTERISTIC = "00002a19-0000-1000-8000-00805f9b34fb"
+
+NOTIFY_CHARACTERISTICS = {RADAR_CHARACTERISTIC: NotifyKind.e_radar,
+                          RANGES_CHARACTERISTIC: NotifyKind.e_ranges,
+                          STATS_CHARACTERISTIC: NotifyKind.e_stats,
+                          BATTERY_LEVEL_CHARACTERISTIC: NotifyKind.e_battery}
+WRITE_CHARACTERISTICS = (DRIVE_CHARACTERISTIC, STATS_CHARACTERISTIC, RADAR_CHARACTERISTIC)
+
+SCAN_TIMEOUT_S = 5.0
+CONNECT_TIMEOUT_S = 10.0
+BACKOFF_MIN_S = 0.25            # First retry after a failure or link loss, doubled on each further failure
+BACKOFF_MAX_S = 8.0
+STOP_TIMEOUT_S = 3.0
+LAG_PROBE_S = 0.01              # Period of the loop latency probe
+
+
+class BLEStatus(enum.Enum):
+    """ BLE connection status """
+    e_unknown = 0
+    e_connecting = 1
+    e_connected = 2
+    e_disconnecting = 3
+    e_disconnected = 4
+    e_scanning = 5
+
+
+class BleLoop():
+    """ asyncio event loop on a daemon thread, owns all bleak objects """
+    def __init__(self):
+        self.loop = asyncio.new_event_loop()
+        self.lag_max_s = 0.0        # Largest delay of the latency probe, the GUI may reset it
+        self.thread = threading.Thread(target=self.run, name="ble", daemon=True)
+        self.thread.start()
+
+    def run(self):
+        asyncio.set_event_loop(self.loop)
+        self.loop.create_task(self.probe_lag())
+        self.loop.run_forever()
+
+    async def probe_lag(self):
+        """ Anything queued in the loop, a drive command included, waits at most this long """
+        while True:
+            start = self.loop.time()
+            await asyncio.sleep(LAG_PROBE_S)
+            self.lag_max_s = max(self.lag_max_s, self.loop.time() - start - LAG_PROBE_S)
+
+    def submit(self, coro):
+        """ Run a coroutine in the loop from any thread, returns a concurrent.futures.Future """
+        return asyncio.run_coroutine_threadsafe(coro, self.loop)
+
+    def call(self, callback, *args):
+        """ Run a plain function in the loop from any thread """
+        self.loop.call_soon_threadsafe(callback, *args)
+
+
+class RobotFinder():
+    """ One scan shared by every link waiting for a robot.
+
+    A robot, once handed to a link, is claimed by it until the link stops,
+    so a link reconnects to the same robot and never to another link's.
+    Runs in the loop thread only.
+    """
+    def __init__(self):
+        self.waiting = {}           # Link to the future it waits on
+        self.claims = {}            # Robot address to link
+        self.scanner = None
+        self.scanner_lock = None    # Created in the loop, older asyncio binds locks to the loop of their creator
+
+    async def find(self, link, timeout):
+        """ Robot claimed by the link, or the first unclaimed robot seen, None on timeout """
+        found = asyncio.get_running_loop().create_future()
+        self.waiting[link] = found
+        try:
+            await self.update_scanner()
+            return await asyncio.wait_for(found, timeout)
+        except asyncio.TimeoutError:
+            return None
+        finally:
+            del self.waiting[link]
+            await self.update_scanner()
+
+    def release(self, link):
+        if link.address is not None:
+            self.claims.pop(link.address, None)
+            link.address = None
+
+    async def update_scanner(self):
+        """ Scan while any link waits """
+        if self.scanner_lock is None:
+            self.scanner_lock = asyncio.Lock()
+        async with self.scanner_lock:
+            if self.waiting and self.scanner is None:
+                self.scanner = BleakScanner(detection_callback=self.on_detect)
+                await self.scanner.start()
+            elif not self.waiting and self.scanner is not None:
+                scanner, self.scanner = self.scanner, None
+                await scanner.stop()
+
+    def on_detect(self, device, adv):
+        if MOVEMENT_SERVICE not in adv.service_uuids:
+            return
+        owner = self.claims.get(device.address)
+        if owner is None:
+            owner = next((link for link in self.waiting if link.address is None), None)
+            if owner is None:
+                return
+            self.claims[device.address] = owner
+            owner.address = device.address
+        found = self.waiting.get(owner)
+        if found is not None and not found.done():
+            found.set_result(device)
+
+
+class RobotLink():
+    """ Keeps a connection to a robot up until stopped.
+
+    The public methods may be called from any thread. Everything else runs in
+    the loop thread and owns the client and the characteristic cache.
+    """
+    def __init__(self, ble_loop, finder, notify_queue, robot=0):
+        self.ble_loop = ble_loop
+        self.finder = finder
+        self.notify_queue = notify_queue
+        self.robot = robot          # Index of the robot in the fleet, tags its notifications
+        self.address = None         # Robot claimed from the finder
+        self.status = BLEStatus.e_disconnected
+        self.client = None
+        self.chars = {}             # Characteristics resolved once per connection, by UUID
+        self.task = None
+
+    def start(self):
+        """ Scan, connect and reconnect in the background until stop() """
+        self.ble_loop.call(self._start)
+
+    def stop(self):
+        """ Disconnect and stop reconnecting, returns a future which completes when the link is down """
+        return self.ble_loop.submit(self._stop())
+
+    def write(self, uuid, data, on_sent=None):
+        """ Write without response, dropped while not connected.
+
+        on_sent is called from the loop thread with time.perf_counter() just before the write is issued.
+        """
+        self.ble_loop.call(self._write, uuid, bytes(data), on_sent)
+
+    def _start(self):
+        if self.task is None:
+            self.task = self.ble_loop.loop.create_task(self.run())
+
+    async def _stop(self):
+        task, self.task = self.task, None
+        if task is not None:
+            task.cancel()
+            await asyncio.gather(task, return_exceptions=True)
+        self.finder.release(self)
+
+    def _write(self, uuid, data, on_sent):
+        char = self.chars.get(uuid)
+        if self.status is BLEStatus.e_connected and char is not None:
+            self.ble_loop.loop.create_task(self.write_char(self.client, char, data, on_sent))
+
+    async def write_char(self, client, char, data, on_sent):
+        if on_sent is not None:
+            on_sent(time.perf_counter())
+        try:
+            await client.write_gatt_char(char, data, response=False)
+        except (BleakError, OSError) as err:
+            print(f"Robot {self.robot}: write to {char.uuid} failed: {err}")
+
+    def set_status(self, status):
+        if status is not self.status:
+            self.status = status
+            self.notify_queue.put(NotifyKind.e_link, bytes([status.value]), self.robot)
+
+    async def run(self):
+        backoff = BACKOFF_MIN_S
+        try:
+            while True:
+                lost = asyncio.Event()
+                if await self.connect(lost):
+                    backoff = BACKOFF_MIN_S
+                    await lost.wait()
+                    print(f"Robot {self.robot}: link lost")
+                    self.client = None
+                    self.chars = {}
+                self.set_status(BLEStatus.e_disconnected)
+                await asyncio.sleep(backoff)
+                backoff = min(backoff * 2, BACKOFF_MAX_S)
+        finally:
+            await self.close()
+
+    async def connect(self, lost):
+        """ Find a robot and bring the link up, True if it is ready for use """
+        self.set_status(BLEStatus.e_scanning)
+        device = await self.finder.find(self, SCAN_TIMEOUT_S)
+        if device is None:
+            return False
+
+        print(f"Robot {self.robot}: found {device.name} at {device.address}")
+        self.set_status(BLEStatus.e_connecting)
+        client = BleakClient(device, disconnected_callback=lambda _: lost.set(),
+                             services=[MOVEMENT_SERVICE, RADAR_SERVICE, BATTERY_SERVICE],
+                             timeout=CONNECT_TIMEOUT_S)
+        try:
+            await client.connect()
+            chars = {}
+            for uuid in (*NOTIFY_CHARACTERISTICS, *WRITE_CHARACTERISTICS):
+                chars[uuid] = client.services.get_characteristic(uuid)
+                if chars[uuid] is None:
+                    raise BleakError(f"Characteristic {uuid} not found")
+            print(f"Robot {self.robot}: handles " + ", ".join(f"{uuid[4:8]} {char.handle}" for uuid, char in chars.items()))
+
+            # Only bins that changed need to be sent after the first sweep
+            await client.write_gatt_char(chars[RADAR_CHARACTERISTIC], bytes([RADAR_CFG_DELTA]), response=False)
+            for uuid, kind in NOTIFY_CHARACTERISTICS.items():
+                await client.start_notify(chars[uuid], lambda _, data, kind=kind: self.notify_queue.put(kind, data, self.robot))
+        except (BleakError, asyncio.TimeoutError, OSError) as err:
+            print(f"Robot {self.robot}: connection failed: {err}")
+            await self.disconnect(client)
+            return False
+        except asyncio.CancelledError:
+            await self.disconnect(client)
+            raise
+
+        self.client = client
+        self.chars = chars
+        self.set_status(BLEStatus.e_connected)
+        return True
+
+    async def close(self):
+        client, self.client = self.client, None
+        self.chars = {}
+        if client is not None:
+            self.set_status(BLEStatus.e_disconnecting)
+            await self.disconnect(client)
+        self.set_status(BLEStatus.e_disconnected)
+
+    @staticmethod
+    async def disconnect(client):
+        try:
+            await client.disconnect()
+        except (BleakError, asyncio.TimeoutError, OSError) as err:
+            print(f"Disconnect failed: {err}")
+
+
+def stop_links(links):
+    """ Blocking stop of all links at once, for application exit """
+    futures = [link.stop() for link in links]
+    _, pending = concurrent.futures.wait(futures, timeout=STOP_TIMEOUT_S)
+    if pending:
+        print(f"{len(pending)} links did not disconnect in time")
@@ -0,0 +1,29 @@
+"""
+Encoder for binary drive command packets sent to Benjamin the Robot.
+See src/remote_service/drive_packet.h in the firmware for the layout.
+"""
+import struct
+
+DRIVE_FULL_SCALE = 1000
+DRIVE_PACKET_MAX_SETPOINTS = 8
+DRIVE_PACKET_HEADER = struct.Struct("<Hhh")
+DRIVE_PACKET_SETPOINT = struct.Struct("<Hhh")
+
+
+def _clamp(value):
+    return max(-DRIVE_FULL_SCALE, min(DRIVE_FULL_SCALE, int(value)))
+
+
+def encode_drive_packet(seq, throttle, steering, batch=()):
+    """ Encode a drive command.
+
+    throttle and steering run from -DRIVE_FULL_SCALE to DRIVE_FULL_SCALE and apply on receipt.
+    batch is an optional sequence of (delay_ms, throttle, steering) setpoints applied delay_ms
+    after receipt, in order of non-decreasing delay.
+    """
+    if len(batch) >= DRIVE_PACKET_MAX_SETPOINTS:
+        raise ValueError(f"At most {DRIVE_PACKET_MAX_SETPOINTS - 1} batched setpoints per packet")
+    data = bytearray(DRIVE_PACKET_HEADER.pack(seq & 0xFFFF, _clamp(throttle), _clamp(steering)))
+    for delay_ms, batch_throttle, batch_steering in batch:
+        data += DRIVE_PACKET_SETPOINT.pack(int(delay_ms), _clamp(batch_throttle), _clamp(batch_steering))
+    return bytes(data)
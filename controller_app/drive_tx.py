@@ -0,0 +1,93 @@
+"""
+Drive command transmitter for the controller app.
+A command goes out as soon as the setpoint changes. While the robot is moving
+the command is repeated as a keep-alive, early enough that the motor watchdog
+of the firmware cannot expire between two commands even when the link and the
+OS timer are both late. A stop is sent once, the watchdog covers a lost one.
+
+A stop lets the link drop to its idle interval. The first command after it
+asks the robot for the active interval again, but until that update takes
+effect a command can wait a whole idle interval for its connection event, so
+keep-alives go out more often for a while after each start from a stop. This
+only works because the idle mode has no peripheral latency: every event the
+robot may skip adds an idle interval to the wait.
+"""
+import collections
+import time
+from PyQt6.QtCore import Qt, QTimer
+from drive_packet import encode_drive_packet
+
+MOTOR_TIMEOUT_MS = 120          # See src/motor.h in the firmware
+LINK_DELAY_MS = 30              # Two connection events at the longest active interval, see src/remote_service/link.h
+LINK_IDLE_INTERVAL_MS = 60      # LINK_IDLE_INTERVAL_MAX, see src/remote_service/link.h
+LINK_IDLE_LATENCY = 0           # LINK_IDLE_LATENCY, events the robot may skip while idle
+LINK_IDLE_DELAY_MS = (1 + LINK_IDLE_LATENCY) * LINK_IDLE_INTERVAL_MS
+LINK_SETTLE_S = 0.5             # Time for the robot's switch back to the active interval, a few idle events
+TIMER_SLACK_MS = 25             # Allowance for the OS running the keep-alive timer late
+KEEPALIVE_MS = MOTOR_TIMEOUT_MS - LINK_DELAY_MS - TIMER_SLACK_MS
+KEEPALIVE_SETTLE_MS = MOTOR_TIMEOUT_MS - LINK_IDLE_DELAY_MS - TIMER_SLACK_MS
+assert KEEPALIVE_SETTLE_MS > 0, "Idle link too slow for the motor watchdog"
+JITTER_WINDOW = 128             # Keep-alive gaps kept for the jitter figures
+
+
+class DriveTransmitter():
+    """ Sends drive setpoints on change, with keep-alives while moving """
+    def __init__(self, send):
+        self.send = send                # send(packet, on_sent), on_sent(time_s) is called when the write is issued
+        self.setpoint = (0, 0)          # (throttle, steering)
+        self.seq = 0
+        self.connected = False
+        self.moving_since = None        # time.monotonic() of the last start from a stop
+        self.period_ms = KEEPALIVE_MS   # Of the keep-alive scheduled last
+        self.keepalive_timer = QTimer()
+        self.keepalive_timer.setSingleShot(True)
+        self.keepalive_timer.setTimerType(Qt.TimerType.PreciseTimer)
+        self.keepalive_timer.timeout.connect(lambda: self.transmit(keepalive=True))
+        # Written by the thread that issues the writes, read by the GUI
+        self.last_sent = None
+        self.gaps = collections.deque(maxlen=JITTER_WINDOW)
+
+    def set_setpoint(self, throttle, steering):
+        if (throttle, steering) != self.setpoint:
+            self.setpoint = (throttle, steering)
+            self.transmit(keepalive=False)
+
+    def set_connected(self, connected):
+        """ A setpoint held across a reconnect goes out again straight away """
+        self.connected = connected
+        self.last_sent = None
+        if connected:
+            self.transmit(keepalive=False)
+        else:
+            self.keepalive_timer.stop()
+
+    def transmit(self, keepalive):
+        self.keepalive_timer.stop()
+        if not self.connected:
+            return
+        self.seq = (self.seq + 1) & 0xFFFF
+        period_ms = self.period_ms if keepalive else None
+        self.send(encode_drive_packet(self.seq, *self.setpoint), lambda sent: self.on_sent(sent, period_ms))
+        if self.setpoint == (0, 0):
+            self.moving_since = None
+            return
+        if self.moving_since is None:
+            self.moving_since = time.monotonic()
+        settling = time.monotonic() - self.moving_since < LINK_SETTLE_S
+        self.period_ms = KEEPALIVE_SETTLE_MS if settling else KEEPALIVE_MS
+        self.keepalive_timer.start(self.period_ms)
+
+    def on_sent(self, sent, period_ms):
+        # Only keep-alives are scheduled, a change goes out whenever the key is pressed
+        if period_ms is not None and self.last_sent is not None:
+            self.gaps.append((sent - self.last_sent, period_ms))
+        self.last_sent = sent
+
+    def summary(self):
+        """ Keep-alive gap and its jitter against the schedule, in ms """
+        gaps = list(self.gaps)
+        if not gaps:
+            return f"TX keep-alive {KEEPALIVE_MS} ms: -"
+        jitter = [abs(gap * 1000 - period_ms) for gap, period_ms in gaps]
+        return (f"TX keep-alive {KEEPALIVE_MS} ms: gap max {max(gap for gap, _ in gaps) * 1000:.1f} ms, "
+                f"jitter avg {sum(jitter) / len(jitter):.1f} max {max(jitter):.1f} ms")
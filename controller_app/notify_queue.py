@@ -0,0 +1,74 @@
+"""
+Hand-over of BLE notifications from the BLE callback thread to the GUI thread.
+The callbacks only copy the payload into the queue, all decoding and drawing
+happens when the GUI thread drains it once per frame.
+"""
+import enum
+import queue
+import threading
+import time
+from dataclasses import dataclass
+
+NOTIFY_QUEUE_DEPTH = 1024       # Per robot, about 10 s of radar frames, far beyond any GUI stall
+
+
+class NotifyKind(enum.IntEnum):
+    """ Source characteristic of a notification """
+    e_radar = 1
+    e_stats = 2
+    e_battery = 3
+    e_link = 4              # Link status change, the data is the BLEStatus value
+    e_drive = 5             # Drive command sent by the app, only found in session logs
+    e_ranges = 6
+
+
+@dataclass
+class Notification:
+    """ One notification as received """
+    timestamp: float        # time.monotonic() on arrival
+    kind: NotifyKind
+    data: bytes
+    robot: int = 0          # Index of the robot in the fleet
+
+
+class NotifyQueue():
+    """ Bounded thread-safe FIFO of notifications.
+
+    If the GUI stops draining for longer than the queue covers, the oldest
+    notification is dropped to make room and counted in overflows.
+    """
+    def __init__(self, depth=NOTIFY_QUEUE_DEPTH):
+        self.queue = queue.Queue(maxsize=depth)
+        self.overflows = 0
+        self.overflow_lock = threading.Lock()
+        self.tap = None         # Called with each notification put, from the putting thread
+
+    def put(self, kind, data, robot=0):
+        """ Called from the BLE callback thread, never blocks """
+        item = Notification(time.monotonic(), kind, bytes(data), robot)
+        if self.tap is not None:
+            self.tap(item)
+        while True:
+            try:
+                self.queue.put_nowait(item)
+                return
+            except queue.Full:
+                try:
+                    self.queue.get_nowait()
+                except queue.Empty:
+                    continue
+                with self.overflow_lock:
+                    self.overflows += 1
+
+    def put_wait(self, notification):
+        """ Blocks while the queue is full, for a producer which must not lose anything """
+        self.queue.put(notification)
+
+    def drain(self):
+        """ Called from the GUI thread, returns everything queued so far in arrival order """
+        items = []
+        while True:
+            try:
+                items.append(self.queue.get_nowait())
+            except queue.Empty:
+                return items
@@ -0,0 +1,49 @@
+"""
+Decoder for binary radar sweep frames sent by Benjamin the Robot.
+See src/remote_service/radar_frame.h in the firmware for the layout.
+"""
+import struct
+from dataclasses import dataclass, field
+
+RADAR_FRAME_VERSION = 1
+RADAR_FRAME_HEADER = struct.Struct("<BBHIBB")
+RADAR_FRAME_FLAG_SPARSE = 0x01
+RADAR_FRAME_FLAG_KEYFRAME = 0x02
+RADAR_FRAME_FLAG_CONFIDENCE = 0x04
+RADAR_FRAME_NO_RETURN = 0xFFFF
+
+RADAR_CFG_DELTA = 0x01      # Write to radar characteristic to allow delta-only frames
+
+
+@dataclass
+class RadarFrame:
+    """ One decoded radar frame """
+    seq: int
+    timestamp_ms: int
+    bin_count: int
+    keyframe: bool
+    bins: list = field(default_factory=list)      # (bin, distance_mm) pairs carried by the frame
+    confidence: list = field(default_factory=list)    # (bin, confidence) pairs, confidence 0 to 255
+
+
+def decode_radar_frame(data):
+    """ Decode a radar notification payload into a RadarFrame """
+    data = bytes(data)
+    version, flags, seq, timestamp_ms, bin_count, entries = RADAR_FRAME_HEADER.unpack_from(data)
+    if version != RADAR_FRAME_VERSION:
+        raise ValueError(f"Unsupported radar frame version {version}")
+
+    payload = memoryview(data)[RADAR_FRAME_HEADER.size:]
+    entry = ("B" if flags & RADAR_FRAME_FLAG_SPARSE else "") + "H" + ("B" if flags & RADAR_FRAME_FLAG_CONFIDENCE else "")
+    values = struct.unpack_from("<" + entry * entries, payload)
+    stride = len(entry)
+    if flags & RADAR_FRAME_FLAG_SPARSE:
+        positions = values[0::stride]
+        distances = values[1::stride]
+    else:
+        positions = range(entries)
+        distances = values[0::stride]
+    bins = list(zip(positions, distances))
+    confidence = list(zip(positions, values[stride - 1::stride])) if flags & RADAR_FRAME_FLAG_CONFIDENCE else []
+
+    return RadarFrame(seq, timestamp_ms, bin_count, bool(flags & RADAR_FRAME_FLAG_KEYFRAME), bins, confidence)
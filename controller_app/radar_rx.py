@@ -5,13 +5,14 @@ Script for testing reception of radar data
 import enum
 from time import sleep
 import simplepyble
+from radar_frame import decode_radar_frame
 
 MAC_ADDRESS = "f7:6d:e3:5f:cb:f9"
 MOVEMENT_SERVICE = "e9ea0001-e19b-482d-9293-c7907585fc48"
 MOVEMENT_CHARACTERISTIC = "e9ea0003-e19b-482d-9293-c7907585fc48"  
 
-RADAR_SERVICE = "6e400001-b5a3-f393-e0a9-e50e24dcca9e"
-RADAR_CHARACTERISTIC = "6e400003-b5a3-f393-e0a9-e50e24dcca9e"
+RADAR_SERVICE = "e9ea0011-e19b-482d-9293-c7907585fc48"
+RADAR_CHARACTERISTIC = "e9ea0012-e19b-482d-9293-c7907585fc48"
 
 BLE_SCAN_TIMEOUT_MS = 3000
 
@@ -94,7 +95,8 @@ class BLETransceiver():
 
 def print_notif(data):
     # print(f"--Notification: {data}")
-    print(f"{bcolors.OKCYAN}Notification: {data}{bcolors.ENDC}")
+    frame = decode_radar_frame(data)
+    print(f"{bcolors.OKCYAN}Notification: seq {frame.seq} t {frame.timestamp_ms} ms {frame.bins}{bcolors.ENDC}")
 
 
 if __name__ == "__main__":
@@ -0,0 +1,134 @@
+"""
+Radar view for the controller app.
+Echoes are drawn into a polar fan with persistence: each cell keeps the time
+it last held an echo and fades out from then on. The fan is rasterised once
+into per-cell bin and range lookup tables, so a sample only touches the cells
+of its own bin and a frame is a few numpy operations over the whole image,
+blitted as one scaled QImage.
+"""
+import math
+import time
+import numpy as np
+from PyQt6.QtCore import QRectF, QPointF
+from PyQt6.QtWidgets import QWidget, QVBoxLayout, QLabel
+from PyQt6.QtGui import QPainter, QImage, QColor, QPen
+
+# Scan geometry, see src/radar_bx.h in the firmware
+RADAR_SCAN_BINS = 20            # Bin 0 is left
+RADAR_FOV_DEG = 90
+RADAR_RANGE_MM = 1000
+RADAR_CELL_MM = 40              # Range resolution of the robot's grid
+
+RADAR_VIEW_COLUMNS = 200
+RADAR_VIEW_ROWS = 200
+PERSISTENCE_S = 1.5             # Time for an echo to fade to 1/e
+RANGE_RING_MM = 250
+
+FAN_BACKGROUND = 0xFF0A1A0A
+OUTSIDE_BACKGROUND = 0xFF202020
+
+
+def _palette():
+    """ ARGB colour of each intensity step, black through green to white """
+    level = np.arange(256, dtype=np.int32)
+    red = np.clip(level * 2 - 255, 0, 255).astype(np.uint32)
+    green = np.maximum(level, 0x1A).astype(np.uint32)
+    blue = red
+    colours = 0xFF000000 | (red << 16) | (green << 8) | blue
+    colours[0] = FAN_BACKGROUND
+    return np.append(colours, np.uint32(OUTSIDE_BACKGROUND)).astype(np.uint32)
+
+
+class RadarView(QWidget):
+    """ Polar radar fan with echo persistence """
+    def __init__(self, columns=RADAR_VIEW_COLUMNS, rows=RADAR_VIEW_ROWS,
+                 bins=RADAR_SCAN_BINS, fov_deg=RADAR_FOV_DEG, range_mm=RADAR_RANGE_MM,
+                 persistence_s=PERSISTENCE_S):
+        super().__init__()
+        self.columns = columns
+        self.rows = rows
+        self.bins = bins
+        self.fov_deg = fov_deg
+        self.range_mm = range_mm
+        self.persistence_s = persistence_s
+        self.build_tables()
+
+        self.layout = QVBoxLayout()
+        self.data_box = QLabel("Bin: -  Distance: -")
+        self.layout.addWidget(self.data_box, stretch=1)
+        self.layout.addWidget(self, stretch=10)
+
+    def build_tables(self):
+        """ Rasterise the fan, apex at the bottom centre, scaled so the whole fan fits """
+        half_fov = math.radians(self.fov_deg / 2)
+        fan_width_mm = 2 * self.range_mm * math.sin(half_fov) if self.fov_deg < 180 else 2 * self.range_mm
+        self.mm_per_cell = max(fan_width_mm / self.columns, self.range_mm / self.rows)
+
+        x = (np.arange(self.columns) + 0.5 - self.columns / 2) * self.mm_per_cell
+        y = (self.rows - np.arange(self.rows) - 0.5) * self.mm_per_cell
+        dx, dy = np.meshgrid(x, y)
+        cell_range = np.hypot(dx, dy).ravel()
+        cell_angle = np.degrees(np.arctan2(dx, dy)).ravel()      # 0 is straight ahead, positive is right
+        cell_bin = np.floor((cell_angle + self.fov_deg / 2) * self.bins / self.fov_deg).astype(np.int32)
+        inside = (cell_bin >= 0) & (cell_bin < self.bins) & (cell_range <= self.range_mm)
+
+        # Cells of each bin, and their ranges, for the per-sample update
+        self.bin_cells = []
+        self.bin_ranges = []
+        for b in range(self.bins):
+            cells = np.flatnonzero(inside & (cell_bin == b))
+            self.bin_cells.append(cells)
+            self.bin_ranges.append(cell_range[cells])
+        self.echo_tolerance_mm = max(RADAR_CELL_MM / 2, self.mm_per_cell)
+
+        self.outside = np.flatnonzero(~inside)
+        self.hit_time = np.full(self.rows * self.columns, -np.inf)
+        self.palette = _palette()
+        self.pixels = np.empty((self.rows, self.columns), dtype=np.uint32)
+        self.image = QImage(self.pixels.data, self.columns, self.rows, self.columns * 4, QImage.Format.Format_RGB32)
+
+    def write_bin(self, position, distance):
+        """ Apply one sample: space in front of the echo is free, the echo itself lights up """
+        self.data_box.setText(f"Bin: {position}  Distance: {distance}")
+        if position >= self.bins:
+            return
+        cells = self.bin_cells[position]
+        ranges = self.bin_ranges[position]
+        self.hit_time[cells[ranges < distance - self.echo_tolerance_mm]] = -np.inf
+        self.hit_time[cells[np.abs(ranges - distance) <= self.echo_tolerance_mm]] = time.monotonic()
+
+    def clear(self):
+        self.hit_time.fill(-np.inf)
+        self.update()
+
+    def render(self):
+        """ Fade every cell from the time of its last echo into the image buffer """
+        intensity = np.exp((self.hit_time - time.monotonic()) / self.persistence_s)
+        index = (intensity * 255).astype(np.uint16)
+        index[self.outside] = len(self.palette) - 1
+        np.take(self.palette, index, out=self.pixels.reshape(-1))
+
+    def paintEvent(self, event):
+        self.render()
+        scale = min(self.width() / self.columns, self.height() / self.rows)
+        width = self.columns * scale
+        height = self.rows * scale
+        target = QRectF((self.width() - width) / 2, (self.height() - height) / 2, width, height)
+
+        qp = QPainter(self)
+        qp.drawImage(target, self.image)
+
+        # Range rings and fan edges, a handful of primitives on top of the image
+        qp.setRenderHints(qp.RenderHint.Antialiasing)
+        qp.setPen(QPen(QColor(0, 120, 0), 1))
+        apex = QPointF(target.center().x(), target.bottom())
+        px_per_mm = scale / self.mm_per_cell
+        start = int((90 - self.fov_deg / 2) * 16)
+        span = int(self.fov_deg * 16)
+        for ring_mm in range(RANGE_RING_MM, self.range_mm + 1, RANGE_RING_MM):
+            radius = ring_mm * px_per_mm
+            qp.drawArc(QRectF(apex.x() - radius, apex.y() - radius, 2 * radius, 2 * radius), start, span)
+        radius = self.range_mm * px_per_mm
+        for edge_deg in (-self.fov_deg / 2, self.fov_deg / 2):
+            edge = math.radians(edge_deg)
+            qp.drawLine(apex, QPointF(apex.x() + radius * math.sin(edge), apex.y() - radius * math.cos(edge)))
@@ -0,0 +1,99 @@
+"""
+Decoder for the runtime statistics of Benjamin the Robot.
+See src/stats.h in the firmware for the layout.
+"""
+import struct
+from dataclasses import dataclass, field
+
+STATS_VERSION = 4
+STATS_HEADER = struct.Struct("<BBIIHHIIIIHHHHHHBB")
+STATS_TASK = struct.Struct("<4sIHHH")
+STATS_CMD_RESET = 0x01      # Write to stats characteristic to clear counters and histograms
+PHY_NAMES = {0: "-", 1: "1M", 2: "2M", 4: "coded"}
+
+
+@dataclass
+class TaskStats:
+    """ Timing of one periodic task on the robot """
+    name: str
+    deadline_misses: int
+    skipped: int
+    jitter_max_us: int
+    exec_max_us: int
+
+    def summary(self):
+        return (f"{self.name} miss {self.deadline_misses} skip {self.skipped} "
+                f"jitter {self.jitter_max_us} us exec {self.exec_max_us} us")
+
+
+@dataclass
+class RobotStats:
+    """ One decoded stats payload """
+    since_reset_ms: int
+    samples: int
+    samples_per_s: int
+    sweep_period_ms: int
+    echo_timeouts: int
+    no_returns: int
+    notify_failures: int
+    watchdog_stops: int
+    stack_used_ranging: int
+    stack_used_main: int
+    battery_mv: int                                             # 0 until the robot has measured it
+    conn_interval: int                                          # 1.25 ms units, 0 when not connected
+    conn_latency: int                                           # Connection events the robot may skip
+    conn_timeout: int                                           # 10 ms units
+    phy: int                                                    # TX PHY in the low nibble, RX PHY in the high nibble
+    data_len: int                                               # TX data length in octets
+    cmd_to_pwm_hist: list = field(default_factory=list)         # Bucket i counts latencies below 2^i us
+    echo_to_notify_hist: list = field(default_factory=list)
+    tasks: list = field(default_factory=list)                   # TaskStats of each periodic task
+
+    @staticmethod
+    def percentile_us(hist, fraction):
+        """ Upper bound in us of the bucket holding the given fraction of a histogram, or None if empty """
+        total = sum(hist)
+        if total == 0:
+            return None
+        running = 0
+        for bucket, count in enumerate(hist):
+            running += count
+            if running >= fraction * total:
+                return 1 << bucket
+        return 1 << (len(hist) - 1)
+
+    def link_summary(self):
+        tx_phy = PHY_NAMES.get(self.phy & 0x0F, "?")
+        rx_phy = PHY_NAMES.get(self.phy >> 4, "?")
+        return (f"link {self.conn_interval * 1.25:g} ms latency {self.conn_latency} "
+                f"timeout {self.conn_timeout * 10} ms, PHY {tx_phy}/{rx_phy}, {self.data_len} B")
+
+    def summary(self):
+        p99_cmd = self.percentile_us(self.cmd_to_pwm_hist, 0.99)
+        p99_echo = self.percentile_us(self.echo_to_notify_hist, 0.99)
+        return (f"{self.samples_per_s} samples/s, sweep {self.sweep_period_ms} ms, "
+                f"faults {self.echo_timeouts}, no return {self.no_returns}, notify fail {self.notify_failures}, "
+                f"watchdog {self.watchdog_stops}, cmd p99 <{p99_cmd} us, echo p99 <{p99_echo} us, "
+                f"stack {self.stack_used_ranging}/{self.stack_used_main} B, battery {self.battery_mv} mV, "
+                f"{self.link_summary()}"
+                + "".join(f", {task.summary()}" for task in self.tasks))
+
+
+def decode_stats(data):
+    """ Decode a stats characteristic payload into RobotStats """
+    data = bytes(data)
+    version, buckets, *fields = STATS_HEADER.unpack_from(data)
+    if version != STATS_VERSION:
+        raise ValueError(f"Unsupported stats version {version}")
+    offset = STATS_HEADER.size
+    hists = struct.unpack_from(f"<{2 * buckets}I", data, offset)
+    offset += 2 * buckets * 4
+    task_count = data[offset]
+    offset += 1
+    tasks = []
+    for _ in range(task_count):
+        name, *timing = STATS_TASK.unpack_from(data, offset)
+        tasks.append(TaskStats(name.rstrip(b"\0").decode(errors="replace"), *timing))
+        offset += STATS_TASK.size
+    return RobotStats(*fields, cmd_to_pwm_hist=list(hists[:buckets]), echo_to_notify_hist=list(hists[buckets:]),
+                      tasks=tasks)
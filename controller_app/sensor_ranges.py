@@ -0,0 +1,34 @@
+"""
+Decoder for the fixed sensor ranges of Benjamin the Robot.
+See remote_ranges_notify() in src/remote_service/remote.h in the firmware for the layout.
+"""
+import struct
+from dataclasses import dataclass, field
+
+RANGES_HEADER = struct.Struct("<IB")
+RANGES_SENSOR = struct.Struct("<hH")
+RANGES_NO_RETURN = 0xFFFF
+RANGES_FAULT = 0xFFFE
+
+
+@dataclass
+class SensorRanges:
+    """ Latest distance of each fixed sensor """
+    timestamp_ms: int
+    sensors: list = field(default_factory=list)     # (bearing_deg, distance_mm) pairs
+
+    def summary(self):
+        def distance(mm):
+            if mm == RANGES_NO_RETURN:
+                return "-"
+            if mm == RANGES_FAULT:
+                return "fault"
+            return f"{mm} mm"
+        return "  ".join(f"{bearing}° {distance(mm)}" for bearing, mm in self.sensors)
+
+
+def decode_sensor_ranges(data):
+    """ Decode a ranges notification payload into SensorRanges """
+    timestamp_ms, count = RANGES_HEADER.unpack_from(data)
+    sensors = [RANGES_SENSOR.unpack_from(data, RANGES_HEADER.size + i * RANGES_SENSOR.size) for i in range(count)]
+    return SensorRanges(timestamp_ms, sensors)
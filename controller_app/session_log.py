@@ -0,0 +1,128 @@
+"""
+Session recorder and replay for the controller app.
+A log is a 256 byte header followed by fixed size 256 byte records, each one
+notification, link status change or drive command with the time it arrived or
+was sent. Records are appended by a background writer, so the BLE and GUI
+threads only queue them. A replay memory-maps the log and feeds the records
+into the notification queue, paced at their recorded times or as fast as the
+GUI drains them.
+"""
+import mmap
+import queue
+import struct
+import threading
+import time
+import numpy as np
+from notify_queue import Notification, NotifyKind
+
+LOG_MAGIC = b"BENJLOG\0"
+LOG_VERSION = 1
+LOG_HEADER = struct.Struct("<8sHHd")        # Magic, version, record size, start time since the epoch in s
+RECORD_SIZE = 256
+RECORD_PAYLOAD = 244                        # Largest notification with the 247 byte ATT MTU
+RECORD = struct.Struct(f"<QBBH{RECORD_PAYLOAD}s")
+RECORD_DTYPE = np.dtype([("t_us", "<u8"), ("robot", "u1"), ("kind", "u1"), ("length", "<u2"),
+                         ("payload", f"V{RECORD_PAYLOAD}")])
+FLUSH_PERIOD_S = 0.5
+
+assert RECORD.size == RECORD_SIZE and RECORD_DTYPE.itemsize == RECORD_SIZE
+
+
+class SessionRecorder():
+    """ Appends records to a log from a background thread """
+    def __init__(self, path):
+        self.file = open(path, "wb")
+        self.start = time.monotonic()
+        self.file.write(LOG_HEADER.pack(LOG_MAGIC, LOG_VERSION, RECORD_SIZE, time.time()).ljust(RECORD_SIZE, b"\0"))
+        self.pending = queue.Queue()
+        self.records = 0
+        self.truncated = 0
+        self.thread = threading.Thread(target=self.run, name="recorder", daemon=True)
+        self.thread.start()
+
+    def record(self, notification):
+        """ Called from any thread, never blocks """
+        self.pending.put(notification)
+
+    def close(self):
+        self.pending.put(None)
+        self.thread.join()
+        print(f"Recorded {self.records} records, {self.truncated} truncated")
+
+    def run(self):
+        last_flush = time.monotonic()
+        closing = False
+        while not closing:
+            # Whatever queued up meanwhile goes out in the same write
+            batch = []
+            try:
+                notification = self.pending.get(timeout=FLUSH_PERIOD_S)
+                while notification is not None:
+                    batch.append(self.pack(notification))
+                    notification = self.pending.get_nowait()
+                closing = True
+            except queue.Empty:
+                pass
+            self.file.write(b"".join(batch))
+            self.records += len(batch)
+            if closing or time.monotonic() - last_flush >= FLUSH_PERIOD_S:
+                self.file.flush()
+                last_flush = time.monotonic()
+        self.file.close()
+
+    def pack(self, notification):
+        if len(notification.data) > RECORD_PAYLOAD:
+            self.truncated += 1
+        t_us = max(0, int((notification.timestamp - self.start) * 1e6))
+        return RECORD.pack(t_us, notification.robot, notification.kind, min(len(notification.data), RECORD_PAYLOAD),
+                           notification.data[:RECORD_PAYLOAD])
+
+
+class SessionReplay():
+    """ Feeds a recorded log into a notification queue from a background thread """
+    def __init__(self, path, fast=False):
+        with open(path, "rb") as file:
+            self.map = mmap.mmap(file.fileno(), 0, access=mmap.ACCESS_READ)
+        magic, version, record_size, self.start_time = LOG_HEADER.unpack_from(self.map)
+        if magic != LOG_MAGIC or version != LOG_VERSION or record_size != RECORD_SIZE:
+            raise ValueError(f"{path} is not a version {LOG_VERSION} session log")
+        # A trailing partial record, left by a crash, is ignored
+        count = (len(self.map) - RECORD_SIZE) // RECORD_SIZE
+        self.records = np.frombuffer(self.map, dtype=RECORD_DTYPE, count=count, offset=RECORD_SIZE)
+        self.robots = int(self.records["robot"].max()) + 1 if count else 1
+        self.notify_queue = None
+        self.fast = fast
+        self.started = None
+        self.fed = threading.Event()        # Set once every record is in the queue
+        self.thread = threading.Thread(target=self.run, name="replay", daemon=True)
+
+    def start(self, notify_queue):
+        self.notify_queue = notify_queue
+        self.thread.start()
+
+    def run(self):
+        t_s = self.records["t_us"] / 1e6
+        robots = self.records["robot"]
+        kinds = self.records["kind"]
+        lengths = self.records["length"]
+        self.started = start = time.monotonic()
+        for index in range(len(self.records)):
+            if not self.fast:
+                delay = start + t_s[index] - time.monotonic()
+                if delay > 0:
+                    time.sleep(delay)
+            offset = RECORD_SIZE * (index + 1) + RECORD.size - RECORD_PAYLOAD
+            data = self.map[offset:offset + int(lengths[index])]
+            # Blocks while the queue is full, so a fast replay is paced by the GUI and loses nothing
+            self.notify_queue.put_wait(Notification(time.monotonic(), NotifyKind(kinds[index]), data, int(robots[index])))
+        self.fed.set()
+
+    def finished(self, queue_empty):
+        """ Called by the consumer with whether it just emptied the queue, True once when the replay is through """
+        if not self.fed.is_set() or not queue_empty or self.started is None:
+            return False
+        elapsed = time.monotonic() - self.started
+        print(f"Replayed {len(self.records)} records in {elapsed:.2f} s"
+              + (f", {len(self.records) / elapsed:.0f} records/s" if self.fast and elapsed > 0 else ""))
+        self.started = None
+        return True
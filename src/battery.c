@@ -0,0 +1,77 @@
+/**
+ * @file battery.c
+ * @brief Source file for the battery monitor
+ */
+
+#include "battery.h"
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/logging/log.h>
+
+#define LOG_MODULE_NAME battery
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+static void changed_work_handler(struct k_work *work);
+
+static battery_changed_t changed_cb;
+static K_WORK_DEFINE(changed_work, changed_work_handler);
+static atomic_t reported_mv;
+
+// Owned by the backend's context
+static uint16_t last_report_mv;
+
+int battery_init(battery_changed_t changed)
+{
+    int error;
+
+    changed_cb = changed;
+    error = battery_adc_start();
+    if (error)
+    {
+        LOG_ERR("Error %d: failed to start battery ADC", error);
+    }
+    return error;
+} /* battery_init */
+
+uint16_t battery_mv_get(void)
+{
+    return (uint16_t)atomic_get(&reported_mv);
+} /* battery_mv_get */
+
+uint8_t battery_level(uint16_t mv)
+{
+    if (mv <= BATTERY_EMPTY_MV)
+    {
+        return 0;
+    }
+    if (mv >= BATTERY_FULL_MV)
+    {
+        return 100;
+    }
+    return ((uint32_t)(mv - BATTERY_EMPTY_MV) * 100U) / (BATTERY_FULL_MV - BATTERY_EMPTY_MV);
+} /* battery_level */
+
+void battery_adc_done(uint16_t mv)
+{
+    uint16_t delta = (mv > last_report_mv) ? mv - last_report_mv : last_report_mv - mv;
+
+    if (last_report_mv != BATTERY_UNKNOWN && delta <= BATTERY_HYSTERESIS_MV)
+    {
+        return;
+    }
+    last_report_mv = mv;
+    atomic_set(&reported_mv, mv);
+    k_work_submit(&changed_work);
+} /* battery_adc_done */
+
+static void changed_work_handler(struct k_work *work)
+{
+    uint16_t mv = battery_mv_get();
+
+    ARG_UNUSED(work);
+    LOG_INF("Battery %u mV, %u %%", mv, battery_level(mv));
+    if (changed_cb != NULL)
+    {
+        changed_cb(mv);
+    }
+} /* changed_work_handler */
@@ -0,0 +1,84 @@
+/**
+ * @file battery.h
+ * @brief Header file for the battery monitor
+ *
+ * The battery is sampled by hardware alone: a timer triggers each SAADC
+ * conversion through DPPI, the SAADC oversamples in a burst and EasyDMA
+ * fills a buffer of results. The CPU only wakes when a buffer is full, to
+ * average it, so the monitor adds no interrupts to the ranging loop between
+ * buffers.
+ *
+ * The averaged voltage is only reported when it moved by more than
+ * BATTERY_HYSTERESIS_MV from the last report, so noise and load steps from
+ * the motors do not turn into a stream of Battery Service notifications.
+ * Reports are delivered from the system workqueue.
+ */
+
+#ifndef BATTERY_H
+#define BATTERY_H
+
+#include <stdint.h>
+
+#define BATTERY_UNKNOWN             0
+#define BATTERY_SAMPLE_PERIOD_MS    500     // Between conversions, each one a burst of oversamples
+#define BATTERY_BUFFER_SAMPLES      8       // Conversions averaged per wake up
+#define BATTERY_HYSTERESIS_MV       50      // Change needed before a new report
+#define BATTERY_EMPTY_MV            4400    // 4 x NiMH AA at 1.1 V per cell
+#define BATTERY_FULL_MV             5600    // 4 x NiMH AA at 1.4 V per cell
+
+/**
+ * @brief Called with the battery voltage when it changed by more than the hysteresis.
+ *
+ * @param mv Battery voltage in millivolts.
+ */
+typedef void (*battery_changed_t)(uint16_t mv);
+
+/**
+ * @brief Start monitoring the battery.
+ *
+ * @param changed Called from the system workqueue with each new report.
+ * @retval 0 if successful.
+ * @retval Negative error code if the ADC could not be set up.
+ */
+int battery_init(battery_changed_t changed);
+
+/**
+ * @brief Get the last reported battery voltage.
+ *
+ * @returns Battery voltage in millivolts, or BATTERY_UNKNOWN before the first report.
+ */
+uint16_t battery_mv_get(void);
+
+/**
+ * @brief Convert a battery voltage to a state of charge.
+ *
+ * Linear between BATTERY_EMPTY_MV and BATTERY_FULL_MV.
+ *
+ * @param mv Battery voltage in millivolts.
+ * @returns State of charge in percent.
+ */
+uint8_t battery_level(uint16_t mv);
+
+/*
+ * ADC backend, battery_saadc.c on the robot and sim/battery_sim.c in the
+ * simulation build.
+ */
+
+/**
+ * @brief Start periodic conversions. Called once by battery_init().
+ *
+ * @retval 0 if successful.
+ * @retval Negative error code otherwise.
+ */
+int battery_adc_start(void);
+
+/**
+ * @brief Hand over the average of a buffer of conversions. Called by the backend.
+ *
+ * Safe from interrupt context. Must be called from one context only.
+ *
+ * @param mv Average battery voltage in millivolts.
+ */
+void battery_adc_done(uint16_t mv);
+
+#endif /* BATTERY_H */
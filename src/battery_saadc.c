@@ -0,0 +1,159 @@
+/**
+ * @file battery_saadc.c
+ * @brief Source file for the SAADC backend of the battery monitor
+ *
+ * Peripheral use:
+ *   TIMER2 - CC0 fires every BATTERY_SAMPLE_PERIOD_MS and clears the timer
+ *   DPPI   - TIMER2 COMPARE0 triggers SAADC SAMPLE
+ *   DPPI   - SAADC END triggers SAADC START, so the next buffer is armed
+ *            without waiting for the interrupt
+ *   SAADC  - one channel in burst mode, so each SAMPLE is a whole run of
+ *            oversamples averaged in hardware into one result
+ *
+ * The SAADC interrupt only runs when a buffer of BATTERY_BUFFER_SAMPLES
+ * results is complete, and when the driver asks for the next buffer.
+ */
+
+#include "battery.h"
+#include <zephyr/kernel.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/logging/log.h>
+#include <nrfx_saadc.h>
+#include <nrfx_timer.h>
+#include <helpers/nrfx_gppi.h>
+#include <hal/nrf_saadc.h>
+
+#define LOG_MODULE_NAME battery_saadc
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+// Timer peripheral dedicated to the battery monitor
+#define BATTERY_TIMER_IDX       2
+#define BATTERY_TIMER_FREQ_HZ   31250
+
+#define BATTERY_ADC_NODE        DT_NODELABEL(adc)
+#define BATTERY_DIVIDER_NODE    DT_NODELABEL(vbatt)
+#define BATTERY_ADC_INPUT       (NRF_SAADC_INPUT_AIN0 + DT_IO_CHANNELS_INPUT(BATTERY_DIVIDER_NODE))
+#define BATTERY_OUTPUT_OHMS     DT_PROP(BATTERY_DIVIDER_NODE, output_ohms)
+#define BATTERY_FULL_OHMS       DT_PROP(BATTERY_DIVIDER_NODE, full_ohms)
+
+// Gain 1/6 against the 0.6 V internal reference, 14 bit results
+#define BATTERY_ADC_RANGE_MV    3600
+#define BATTERY_ADC_RESOLUTION  NRF_SAADC_RESOLUTION_14BIT
+#define BATTERY_ADC_MAX         BIT(14)
+
+static const nrfx_timer_t timer = NRFX_TIMER_INSTANCE(BATTERY_TIMER_IDX);
+static nrf_saadc_value_t buffers[2][BATTERY_BUFFER_SAMPLES];
+static uint8_t next_buffer;
+
+static void timer_handler(nrf_timer_event_t event_type, void *p_context)
+{
+    // Compare interrupts are not enabled
+    ARG_UNUSED(event_type);
+    ARG_UNUSED(p_context);
+} /* timer_handler */
+
+static uint16_t raw_to_mv(int32_t raw)
+{
+    uint32_t pin_mv = ((uint32_t)MAX(raw, 0) * BATTERY_ADC_RANGE_MV) / BATTERY_ADC_MAX;
+
+    return (pin_mv * BATTERY_FULL_OHMS) / BATTERY_OUTPUT_OHMS;
+} /* raw_to_mv */
+
+static void saadc_handler(nrfx_saadc_evt_t const *p_event)
+{
+    int32_t sum = 0;
+
+    switch (p_event->type)
+    {
+    case NRFX_SAADC_EVT_DONE:
+        for (uint16_t i = 0; i < p_event->data.done.size; i++)
+        {
+            sum += p_event->data.done.p_buffer[i];
+        }
+        battery_adc_done(raw_to_mv(sum / p_event->data.done.size));
+        break;
+
+    case NRFX_SAADC_EVT_BUF_REQ:
+        nrfx_saadc_buffer_set(buffers[next_buffer], BATTERY_BUFFER_SAMPLES);
+        next_buffer ^= 1;
+        break;
+
+    default:
+        break;
+    }
+} /* saadc_handler */
+
+int battery_adc_start(void)
+{
+    nrfx_timer_config_t timer_cfg = NRFX_TIMER_DEFAULT_CONFIG;
+    nrfx_saadc_channel_t channel = NRFX_SAADC_DEFAULT_CHANNEL_SE(BATTERY_ADC_INPUT, 0);
+    nrfx_saadc_adv_config_t adv_cfg = NRFX_SAADC_DEFAULT_ADV_CONFIG;
+    uint8_t ppi_sample, ppi_restart;
+    nrfx_err_t err;
+
+    // The divider is high impedance, so give the sampling capacitor time to charge
+    channel.channel_config.acq_time = NRF_SAADC_ACQTIME_40US;
+
+    IRQ_CONNECT(DT_IRQN(BATTERY_ADC_NODE), DT_IRQ(BATTERY_ADC_NODE, priority), nrfx_isr,
+                nrfx_saadc_irq_handler, 0);
+    err = nrfx_saadc_init(DT_IRQ(BATTERY_ADC_NODE, priority));
+    err = (err == NRFX_SUCCESS) ? nrfx_saadc_offset_calibrate(NULL) : err;
+    err = (err == NRFX_SUCCESS) ? nrfx_saadc_channels_config(&channel, 1) : err;
+    if (err != NRFX_SUCCESS)
+    {
+        LOG_ERR("SAADC init failed (err 0x%08x)", err);
+        return -EIO;
+    }
+
+    // Conversions are triggered through DPPI, and restarted on END through DPPI
+    adv_cfg.oversampling = NRF_SAADC_OVERSAMPLE_64X;
+    adv_cfg.burst = NRF_SAADC_BURST_ENABLED;
+    adv_cfg.internal_timer_cc = 0;
+    adv_cfg.start_on_end = false;
+    err = nrfx_saadc_advanced_mode_set(BIT(0), BATTERY_ADC_RESOLUTION, &adv_cfg, saadc_handler);
+    err = (err == NRFX_SUCCESS) ? nrfx_saadc_buffer_set(buffers[0], BATTERY_BUFFER_SAMPLES) : err;
+    if (err != NRFX_SUCCESS)
+    {
+        LOG_ERR("SAADC mode failed (err 0x%08x)", err);
+        return -EIO;
+    }
+    next_buffer = 1;
+
+    // Slow timer clock, the period is far longer than a conversion
+    timer_cfg.frequency = NRF_TIMER_FREQ_31250Hz;
+    timer_cfg.bit_width = NRF_TIMER_BIT_WIDTH_32;
+    err = nrfx_timer_init(&timer, &timer_cfg, timer_handler);
+    if (err != NRFX_SUCCESS)
+    {
+        LOG_ERR("Timer init failed (err 0x%08x)", err);
+        return -EBUSY;
+    }
+    nrfx_timer_extended_compare(&timer, NRF_TIMER_CC_CHANNEL0,
+                                (BATTERY_SAMPLE_PERIOD_MS * BATTERY_TIMER_FREQ_HZ) / 1000,
+                                NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK, false);
+
+    if (nrfx_gppi_channel_alloc(&ppi_sample) != NRFX_SUCCESS ||
+        nrfx_gppi_channel_alloc(&ppi_restart) != NRFX_SUCCESS)
+    {
+        LOG_ERR("No DPPI channel available");
+        return -EBUSY;
+    }
+    nrfx_gppi_channel_endpoints_setup(ppi_sample,
+        nrfx_timer_compare_event_address_get(&timer, NRF_TIMER_CC_CHANNEL0),
+        nrf_saadc_task_address_get(NRF_SAADC, NRF_SAADC_TASK_SAMPLE));
+    nrfx_gppi_channel_endpoints_setup(ppi_restart,
+        nrf_saadc_event_address_get(NRF_SAADC, NRF_SAADC_EVENT_END),
+        nrf_saadc_task_address_get(NRF_SAADC, NRF_SAADC_TASK_START));
+    nrfx_gppi_channels_enable(BIT(ppi_sample) | BIT(ppi_restart));
+
+    // Starts the first buffer. From here on the timer paces the conversions
+    err = nrfx_saadc_mode_trigger();
+    if (err != NRFX_SUCCESS)
+    {
+        LOG_ERR("SAADC start failed (err 0x%08x)", err);
+        return -EIO;
+    }
+    nrfx_timer_enable(&timer);
+
+    return 0;
+} /* battery_adc_start */
@@ -4,72 +4,224 @@
  */
 
 #include "dot_matrix.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/spi.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/pm/device_runtime.h>
+#include <zephyr/logging/log.h>
 
 // Logging
+#define LOG_MODULE_NAME dot_matrix
 LOG_MODULE_REGISTER(LOG_MODULE_NAME);
 
-// SPI
-#define MY_SPI_MASTER DT_NODELABEL(my_spi_master)
-static const struct device *spi_dev;
+// MAX7219 registers
+#define REG_DIGIT0          0x01
+#define REG_DECODE_MODE     0x09
+#define REG_INTENSITY       0x0A
+#define REG_SCAN_LIMIT      0x0B
+#define REG_SHUTDOWN        0x0C
+#define REG_DISPLAY_TEST    0x0F
 
-const struct spi_cs_control dot_matrix_cs = {
-	.gpio = SPI_CS_GPIOS_DT_SPEC_GET(DT_NODELABEL(dot_matrix)),
-	.delay = 0,
-};
+#define DOT_MATRIX_NODE     DT_NODELABEL(dot_matrix)
+
+static int write_reg(uint8_t addr, uint8_t data);
+static int start_row(void);
+static void on_row_sent(struct k_work *work);
+
+static const struct spi_dt_spec dot_matrix_spi = SPI_DT_SPEC_GET(DOT_MATRIX_NODE,
+    SPI_WORD_SET(8) | SPI_TRANSFER_MSB | SPI_MODE_CPHA | SPI_MODE_CPOL, 0);
 
-const struct spi_config spi_cfg = {
-	.operation = SPI_WORD_SET(8) | SPI_TRANSFER_MSB | SPI_MODE_CPHA |  SPI_MODE_CPOL, 
-	.frequency = 4000000,
-	.slave = 0,
-	.cs = &dot_matrix_cs,
+// Owned by the drawing thread
+static uint8_t frame[DOT_MATRIX_ROWS];
+static uint8_t dirty;
+
+// Frame going out, owned by the transfer chain while busy is set
+static uint8_t tx_words[DOT_MATRIX_ROWS][2];
+static struct spi_buf tx_buf;
+static const struct spi_buf_set tx_set = {
+    .buffers = &tx_buf,
+    .count = 1
 };
+static uint8_t tx_count;
+static uint8_t tx_next;
+static struct k_poll_signal *tx_done;
+static atomic_t busy;
+static atomic_t requeue;
+
+static struct k_poll_signal spi_signal;
+static struct k_poll_event spi_event;
+static struct k_work_poll chain_work;
 
-void spi_init(void)
+// Blocking, for configuration only
+static int write_reg(uint8_t addr, uint8_t data)
 {
-	
-	spi_dev = DEVICE_DT_GET(MY_SPI_MASTER);
-	if(!device_is_ready(spi_dev)) 
+    uint8_t tx_buffer[2] = { addr, data };
+    const struct spi_buf tx_buf = {
+        .buf = tx_buffer,
+        .len = sizeof(tx_buffer)
+    };
+    const struct spi_buf_set tx = {
+        .buffers = &tx_buf,
+        .count = 1
+    };
+
+    return spi_write_dt(&dot_matrix_spi, &tx);
+} /* write_reg */
+
+int dot_matrix_init(void)
+{
+    int error;
+
+    if (!spi_is_ready(&dot_matrix_spi))
     {
-		LOG_ERR("SPI master device not ready!\n");
-	}
-	if(!device_is_ready(dot_matrix_cs.gpio.port))
+        LOG_ERR("SPI master or chip select device not ready");
+        return -ENODEV;
+    }
+
+    k_poll_signal_init(&spi_signal);
+    k_work_poll_init(&chain_work, on_row_sent);
+
+    pm_device_runtime_get(dot_matrix_spi.bus);
+    error = write_reg(REG_DISPLAY_TEST, 0x00);
+    error = error ? error : write_reg(REG_DECODE_MODE, 0x00);
+    error = error ? error : write_reg(REG_SCAN_LIMIT, DOT_MATRIX_ROWS - 1);
+    error = error ? error : write_reg(REG_INTENSITY, DT_PROP(DOT_MATRIX_NODE, intensity));
+    error = error ? error : write_reg(REG_SHUTDOWN, 0x01);
+    pm_device_runtime_put(dot_matrix_spi.bus);
+    if (error)
     {
-		LOG_ERR("SPI master chip select device not ready!\n");
-	}
-} /* spi_init */
+        LOG_ERR("SPI write error: %d", error);
+        return error;
+    }
 
-void dot_matrix_init(void)
-{
-    dot_matrix_write(0x0C, 0x01);   // Shutdown register
-    dot_matrix_write(0x0A, 0x00);   // Intensity register
-    dot_matrix_write(0x0B, 0x07);   // Scan limit register
-    dot_matrix_write(0x09, 0x00);   // Decode-mode register
+    // Display RAM is undefined at power up
+    memset(frame, 0, sizeof(frame));
+    dirty = BIT_MASK(DOT_MATRIX_ROWS);
+
+    return dot_matrix_flush(NULL);
 } /* dot_matrix_init */
 
-void dot_matrix_write(uint8_t addr, uint8_t data)
+void dot_matrix_row_set(uint8_t row, uint8_t bits)
+{
+    if (row >= DOT_MATRIX_ROWS || frame[row] == bits)
+    {
+        return;
+    }
+    frame[row] = bits;
+    dirty |= BIT(row);
+} /* dot_matrix_row_set */
+
+// The SPI driver may still read the buffer descriptors after returning, so they live with the frame
+static int start_row(void)
+{
+    int error;
+
+    tx_buf.buf = tx_words[tx_next];
+    tx_buf.len = sizeof(tx_words[tx_next]);
+    k_poll_signal_reset(&spi_signal);
+    error = spi_transceive_async(dot_matrix_spi.bus, &dot_matrix_spi.config, &tx_set, NULL, &spi_signal);
+    if (error)
+    {
+        return error;
+    }
+
+    // Picks up a transfer which already completed, too
+    k_poll_event_init(&spi_event, K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY, &spi_signal);
+    return k_work_poll_submit(&chain_work, &spi_event, 1, K_FOREVER);
+} /* start_row */
+
+// Ends the frame, handing rows which did not go out back to the next flush
+static void finish_frame(int result)
 {
-	uint8_t tx_buffer[2];
-	const struct spi_buf tx_buf = {
-		.buf = tx_buffer,
-		.len = sizeof(tx_buffer)
-	};
-	const struct spi_buf_set tx = {
-		.buffers = &tx_buf,
-		.count = 1
-	};
-
-    tx_buffer[0] = addr;
-    tx_buffer[1] = data;
-    
-    LOG_DBG("SPI TX: 0x%.2x, 0x%.2x\n", tx_buffer[0], tx_buffer[1]);
-	
-	// Start transaction
-    int16_t error;
-	error = spi_write(spi_dev, &spi_cfg, &tx);
-    if(error != 0)
+    struct k_poll_signal *done = tx_done;
+    uint8_t unsent = 0;
+
+    for (uint8_t i = (result == 0) ? tx_count : tx_next; i < tx_count; i++)
+    {
+        unsent |= BIT(tx_words[i][0] - REG_DIGIT0);
+    }
+    atomic_or(&requeue, unsent);
+    if (tx_count > 0)
+    {
+        // The SPIM is only powered while a frame goes out
+        pm_device_runtime_put(dot_matrix_spi.bus);
+    }
+    atomic_clear(&busy);
+    if (result)
+    {
+        LOG_DBG("SPI write error: %d", result);
+    }
+    if (done != NULL)
+    {
+        k_poll_signal_raise(done, result);
+    }
+} /* finish_frame */
+
+// Runs in the system workqueue when a row transfer completes
+static void on_row_sent(struct k_work *work)
+{
+    unsigned int signaled;
+    int result;
+    int error;
+
+    ARG_UNUSED(work);
+    k_poll_signal_check(&spi_signal, &signaled, &result);
+    if (result < 0)
+    {
+        finish_frame(result);
+        return;
+    }
+
+    tx_next++;
+    if (tx_next == tx_count)
+    {
+        finish_frame(0);
+        return;
+    }
+    error = start_row();
+    if (error)
+    {
+        finish_frame(error);
+    }
+} /* on_row_sent */
+
+int dot_matrix_flush(struct k_poll_signal *done)
+{
+    int error;
+
+    if (!atomic_cas(&busy, 0, 1))
+    {
+        return -EBUSY;
+    }
+
+    dirty |= (uint8_t)atomic_clear(&requeue);
+    tx_count = 0;
+    for (uint8_t row = 0; row < DOT_MATRIX_ROWS; row++)
+    {
+        if (dirty & BIT(row))
+        {
+            tx_words[tx_count][0] = REG_DIGIT0 + row;
+            tx_words[tx_count][1] = frame[row];
+            tx_count++;
+        }
+    }
+    dirty = 0;
+
+    tx_next = 0;
+    tx_done = done;
+    if (tx_count == 0)
+    {
+        finish_frame(0);
+        return 0;
+    }
+
+    pm_device_runtime_get(dot_matrix_spi.bus);
+    error = start_row();
+    if (error)
     {
-		LOG_ERR("SPI write error: %i\n", error);
-		return;
-	}
-	return;
-} /* dot_matrix_write */
\ No newline at end of file
+        finish_frame(error);
+    }
+    return error;
+} /* dot_matrix_flush */
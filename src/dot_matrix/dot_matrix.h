@@ -1,39 +1,68 @@
 /**
  * @file dot_matrix.h
  * @brief Header file for MAX7219 dot display with 8*8 LED matrix
+ *
+ * Rows are drawn into a framebuffer, which marks the rows that changed.
+ * A flush queues the dirty rows and returns straight away. The MAX7219
+ * latches one register per chip select, so each row is its own
+ * asynchronous SPI transfer, and the completion of one starts the next
+ * from the system workqueue. The caller is told when the whole frame is out
+ * through an optional poll signal.
  */
 
 #ifndef MAX7219_H
 #define MAX7219_H
 
+#include <stdint.h>
 #include <zephyr/kernel.h>
-#include <zephyr/device.h>
-#include <zephyr/logging/log.h>
-#include <zephyr/drivers/gpio.h>
-#include <zephyr/drivers/spi.h>
+
+#define DOT_MATRIX_ROWS     8       // Row 0 is the top, bit 7 of a row is the leftmost column
 
 /**
- * @brief Initialise SPI devices.
+ * @brief Initialise MAX7219 dot matrix display.
  *
- * Checks if SPI master and CS pins are ready.
+ * Sets up the configuration registers and clears the matrix. Blocks until
+ * the configuration is written.
+ *
+ * @retval 0 if successful.
+ * @retval -ENODEV if the SPI bus is not ready.
+ * @retval Negative error code from the SPI API otherwise.
  */
-void spi_init(void);
+int dot_matrix_init(void);
 
 /**
- * @brief Initialise MAX7219 dot matrix display.
+ * @brief Set a row of the framebuffer.
+ *
+ * Marks the row dirty if it changed. Only one thread may draw.
+ *
+ * @param row Row, 0 is the top.
+ * @param bits Row pixels, bit 7 is the leftmost column.
+ */
+void dot_matrix_row_set(uint8_t row, uint8_t bits);
+
+/**
+ * @brief Queue the dirty rows for transfer to the matrix.
+ *
+ * Does not block. Only one thread may flush.
  *
- * Set up configuration registers.
+ * @param done Raised with the transfer result when the frame is out, or NULL.
+ * @retval 0 if the frame was queued, or there was nothing to send.
+ * @retval -EBUSY if the previous frame is still going out. The rows stay
+ *         dirty and go out with the next flush.
+ * @retval Negative error code from the SPI API otherwise.
  */
-void dot_matrix_init(void);
+int dot_matrix_flush(struct k_poll_signal *done);
 
 /**
- * @brief Write to MAX7219 dot matrix display.
+ * @brief Draw a radar sweep into the framebuffer.
  *
- * Binary representation of will displayed on digit register.
+ * The sweep is split into one sector per column, left to right. Each column
+ * is a bar which grows from the bottom as the nearest obstacle in its sector
+ * comes closer, and is empty if there is nothing within range.
  *
- * @param add Register address.
- * @param data Data to write to address.
+ * @param bins_mm Distance of each bin in millimetres, bin 0 is left.
+ * @param bin_count Number of bins.
  */
-void dot_matrix_write(uint8_t addr, uint8_t data);
+void dot_matrix_show_radar(const uint16_t *bins_mm, uint8_t bin_count);
 
 #endif /* MAX7219_H */
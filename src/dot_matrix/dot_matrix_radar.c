@@ -0,0 +1,47 @@
+/**
+ * @file dot_matrix_radar.c
+ * @brief Radar view for the MAX7219 dot matrix
+ */
+
+#include "dot_matrix.h"
+#include "radar_bx.h"
+
+#define DOT_MATRIX_COLUMNS  8
+
+void dot_matrix_show_radar(const uint16_t *bins_mm, uint8_t bin_count)
+{
+    uint8_t height[DOT_MATRIX_COLUMNS];
+
+    for (uint8_t col = 0; col < DOT_MATRIX_COLUMNS; col++)
+    {
+        // Sectors share the bins out evenly, nearest echo in each sector wins
+        uint8_t first = (col * bin_count) / DOT_MATRIX_COLUMNS;
+        uint8_t last = ((col + 1) * bin_count) / DOT_MATRIX_COLUMNS;
+        uint16_t nearest_mm = RADAR_RANGE_MM;
+
+        for (uint8_t bin = first; bin < last; bin++)
+        {
+            nearest_mm = MIN(nearest_mm, bins_mm[bin]);
+        }
+
+        height[col] = 0;
+        if (nearest_mm < RADAR_RANGE_MM)
+        {
+            height[col] = DOT_MATRIX_ROWS - (nearest_mm * DOT_MATRIX_ROWS) / RADAR_RANGE_MM;
+        }
+    }
+
+    for (uint8_t row = 0; row < DOT_MATRIX_ROWS; row++)
+    {
+        uint8_t bits = 0;
+
+        for (uint8_t col = 0; col < DOT_MATRIX_COLUMNS; col++)
+        {
+            if (height[col] >= DOT_MATRIX_ROWS - row)
+            {
+                bits |= BIT(7 - col);
+            }
+        }
+        dot_matrix_row_set(row, bits);
+    }
+} /* dot_matrix_show_radar */
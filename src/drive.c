@@ -0,0 +1,45 @@
+/**
+ * @file drive.c
+ * @brief Source file for the mapping of drive commands to motor speeds
+ */
+
+#include "drive.h"
+#include <errno.h>
+#include <zephyr/sys/util.h>
+#include "drive_packet.h"
+
+// Left and right motor speed of each direction, in half speeds
+static const int8_t dir_half_speeds[DIR_COUNT_E][2] = {
+    [NONE_E]        = {0, 0},
+    [NORTH_E]       = {2, 2},
+    [NORTHEAST_E]   = {2, 1},
+    [EAST_E]        = {2, -2},
+    [SOUTHEAST_E]   = {-2, -1},
+    [SOUTH_E]       = {-2, -2},
+    [SOUTHWEST_E]   = {-1, -2},
+    [WEST_E]        = {-2, 2},
+    [NORTHWEST_E]   = {1, 2},
+};
+
+int drive_dir_speeds(uint8_t dir, int16_t speed_us, struct motor_setpoint *sp)
+{
+    if (dir >= DIR_COUNT_E)
+    {
+        return -EINVAL;
+    }
+    sp->left_us = (dir_half_speeds[dir][0] * speed_us) / 2;
+    sp->right_us = (dir_half_speeds[dir][1] * speed_us) / 2;
+
+    return 0;
+} /* drive_dir_speeds */
+
+void drive_mix(int16_t throttle, int16_t steering, struct motor_setpoint *sp)
+{
+    int32_t left = throttle + steering;
+    int32_t right = throttle - steering;
+    int32_t peak = MAX(MAX(left, -left), MAX(right, -right));
+    int32_t scale = MAX(peak, DRIVE_FULL_SCALE);
+
+    sp->left_us = (left * MOTOR_SPEED_MAX_US) / scale;
+    sp->right_us = (right * MOTOR_SPEED_MAX_US) / scale;
+} /* drive_mix */
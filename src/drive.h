@@ -0,0 +1,50 @@
+/**
+ * @file drive.h
+ * @brief Header file for the mapping of drive commands to motor speeds
+ */
+
+#ifndef DRIVE_H
+#define DRIVE_H
+
+#include <stdint.h>
+#include "motor.h"
+
+typedef enum
+{
+    NONE_E = 0,
+    NORTH_E = 1,
+    NORTHEAST_E = 2,
+    EAST_E = 3,
+    SOUTHEAST_E = 4,
+    SOUTH_E = 5,
+    SOUTHWEST_E = 6,
+    WEST_E = 7,
+    NORTHWEST_E = 8,
+    DIR_COUNT_E
+} robot_dir_t;
+
+/**
+ * @brief Get the motor speeds of a compass direction command.
+ *
+ * Diagonals run the inner wheels at half speed, east and west turn on the spot.
+ *
+ * @param dir Direction.
+ * @param speed_us Full speed as an offset from MOTOR_STOP_US. Max MOTOR_SPEED_MAX_US.
+ * @param[out] sp Motor speeds. The delay is left alone.
+ * @retval 0 if successful.
+ * @retval -EINVAL if the direction is out of range.
+ */
+int drive_dir_speeds(uint8_t dir, int16_t speed_us, struct motor_setpoint *sp);
+
+/**
+ * @brief Differential drive mix of throttle and steering.
+ *
+ * When a wheel would saturate, both are scaled down to keep the turn rate.
+ *
+ * @param throttle -DRIVE_FULL_SCALE to DRIVE_FULL_SCALE, positive is forwards.
+ * @param steering -DRIVE_FULL_SCALE to DRIVE_FULL_SCALE, positive is to the right.
+ * @param[out] sp Motor speeds. The delay is left alone.
+ */
+void drive_mix(int16_t throttle, int16_t steering, struct motor_setpoint *sp);
+
+#endif /* DRIVE_H */
@@ -1,95 +1,271 @@
 /**
  * @file ultrasonic_hc-sr04.c
- * @brief Source file for HC-SR04 proximity sensor module library
+ * @brief Source file for HC-SR04 proximity sensor driver
+ *
+ * Each sensor has its own TIMER, taken from the devicetree, whose interrupt
+ * is bound to the sensor device, so any number of sensors can measure at
+ * the same time. The TIMER is driven through the HAL rather than the nrfx
+ * driver, which only supports instances fixed at build time.
+ *
+ * Timer compare and capture channel usage (1 MHz, cleared at every trigger):
+ *   CC0 - sets trigger pin through DPPI
+ *   CC1 - clears trigger pin through DPPI, 10 us later
+ *   CC2 - captures timer on every echo pin edge through DPPI
+ *   CC3 - software capture of the current time
+ *   CC4 - range gate, or measurement timeout when no gate is set
+ *
+ * The measurement cycle and the sensor API are shared with the GPIO backend,
+ * see ultrasonic_hc-sr04_common.h. The timer is the measurement clock and is
+ * stopped between measurements.
  */
 
-#include "ultrasonic_hc-sr04.h"
+#define DT_DRV_COMPAT hc_sr04
 
-// Filewide scope variables to be used by any function.
-// These exist so sense_distance can be called without passing input arguments.
-static const struct device *port_fw;
-static gpio_pin_t pin_trig_fw;
-static gpio_pin_t pin_echo_fw;
+#include "ultrasonic_hc-sr04_common.h"
+#include <zephyr/logging/log.h>
+#include <nrfx_gpiote.h>
+#include <helpers/nrfx_gppi.h>
+#include <hal/nrf_gpio.h>
+#include <hal/nrf_timer.h>
 
-// Variables accessable by ISR 
-static volatile bool latch;
-static volatile uint32_t start_time;
-static volatile uint32_t stop_time;	
-static volatile uint32_t cycles_spent;
-static volatile uint32_t us_spent;
-static volatile uint32_t distance;
+LOG_MODULE_DECLARE(hc_sr04, CONFIG_SENSOR_LOG_LEVEL);
+
+// Timer channel allocation
+#define CC_TRIG_SET         NRF_TIMER_CC_CHANNEL0
+#define CC_TRIG_CLR         NRF_TIMER_CC_CHANNEL1
+#define CC_ECHO             NRF_TIMER_CC_CHANNEL2
+#define CC_NOW              NRF_TIMER_CC_CHANNEL3
+#define CC_GATE             NRF_TIMER_CC_CHANNEL4
+
+// Trigger pulse timing, in microseconds after the timer is started
+#define TRIG_START_US       1
+#define TRIG_PULSE_US       10
+
+struct hc_sr04_config {
+	struct hc_sr04_common_config common;
+	NRF_TIMER_Type *timer;
+	uint32_t trig_pin;
+	uint32_t echo_pin;
+	void (*irq_connect)(void);
+};
+
+struct hc_sr04_data {
+	struct hc_sr04_common_data common;
+};
 
 // Private function prototypes
-static void echo_cb(void);
-static struct gpio_callback echo_cb_data;
+static void hc_sr04_trigger(const struct device *dev);
+static void hc_sr04_stop(const struct device *dev);
+static uint32_t hc_sr04_now(const struct device *dev);
+static void hc_sr04_gate_set(const struct device *dev, uint32_t at_us);
+static void hc_sr04_gate_stop(const struct device *dev);
+static bool hc_sr04_echo_get(const struct device *dev);
+static void hc_sr04_echo_handler(nrfx_gpiote_pin_t pin, nrfx_gpiote_trigger_t trigger, void *context);
+static void hc_sr04_timer_isr(const struct device *dev);
+
+static const struct hc_sr04_backend hc_sr04_timer_backend = {
+	.trigger = hc_sr04_trigger,
+	.stop = hc_sr04_stop,
+	.now_us = hc_sr04_now,
+	.gate_set = hc_sr04_gate_set,
+	.gate_stop = hc_sr04_gate_stop,
+	.echo_get = hc_sr04_echo_get,
+};
 
 
-// Ultrasonic echo ISR. Is called on rising and falling edge, hence the use of the latch variable.
-static void echo_cb(void)
+// Starting the cleared timer fires the trigger pulse through DPPI
+static void hc_sr04_trigger(const struct device *dev)
 {
-	if (!latch)
-	{
-		latch = 1;
-		// Capture time stamp on rising edge
-		start_time = k_cycle_get_32();
-	} 
-	else
+	const struct hc_sr04_config *cfg = dev->config;
+
+	nrf_timer_task_trigger(cfg->timer, NRF_TIMER_TASK_CLEAR);
+	nrf_timer_task_trigger(cfg->timer, NRF_TIMER_TASK_START);
+} /* hc_sr04_trigger */
+
+static void hc_sr04_stop(const struct device *dev)
+{
+	const struct hc_sr04_config *cfg = dev->config;
+
+	nrf_timer_task_trigger(cfg->timer, NRF_TIMER_TASK_STOP);
+} /* hc_sr04_stop */
+
+// Current time on the measurement timer
+static uint32_t hc_sr04_now(const struct device *dev)
+{
+	const struct hc_sr04_config *cfg = dev->config;
+
+	nrf_timer_task_trigger(cfg->timer, nrf_timer_capture_task_get(CC_NOW));
+	return nrf_timer_cc_get(cfg->timer, CC_NOW);
+} /* hc_sr04_now */
+
+// Arm the range gate or measurement timeout interrupt
+static void hc_sr04_gate_set(const struct device *dev, uint32_t at_us)
+{
+	const struct hc_sr04_config *cfg = dev->config;
+
+	nrf_timer_event_clear(cfg->timer, nrf_timer_compare_event_get(CC_GATE));
+	nrf_timer_cc_set(cfg->timer, CC_GATE, at_us);
+	nrf_timer_int_enable(cfg->timer, nrf_timer_compare_int_get(CC_GATE));
+} /* hc_sr04_gate_set */
+
+static void hc_sr04_gate_stop(const struct device *dev)
+{
+	const struct hc_sr04_config *cfg = dev->config;
+
+	nrf_timer_int_disable(cfg->timer, nrf_timer_compare_int_get(CC_GATE));
+} /* hc_sr04_gate_stop */
+
+static bool hc_sr04_echo_get(const struct device *dev)
+{
+	const struct hc_sr04_config *cfg = dev->config;
+
+	return nrf_gpio_pin_read(cfg->echo_pin);
+} /* hc_sr04_echo_get */
+
+// Echo pin ISR, called on both edges. The edge time itself was already captured in CC2 by DPPI.
+static void hc_sr04_echo_handler(nrfx_gpiote_pin_t pin, nrfx_gpiote_trigger_t trigger, void *context)
+{
+	ARG_UNUSED(pin);
+	ARG_UNUSED(trigger);
+	const struct device *dev = context;
+	const struct hc_sr04_config *cfg = dev->config;
+	struct hc_sr04_data *data = dev->data;
+
+	// The pin may have moved on since the edge, so take the level from the cycle. Echo is low when triggered
+	hc_sr04_echo_edge(dev, nrf_timer_cc_get(cfg->timer, CC_ECHO),
+			  atomic_get(&data->common.state) == HC_SR04_WAIT_RISE);
+} /* hc_sr04_echo_handler */
+
+// Timer ISR, only enabled for the gate compare channel
+static void hc_sr04_timer_isr(const struct device *dev)
+{
+	const struct hc_sr04_config *cfg = dev->config;
+	nrf_timer_event_t gate_event = nrf_timer_compare_event_get(CC_GATE);
+
+	if (!nrf_timer_event_check(cfg->timer, gate_event))
 	{
-		// Capture time stamp on falling edge
-		stop_time = k_cycle_get_32();
-		latch = 0;
-		// Compute proximity based on the echo pin pulse length (assumes no counter rollover)
-		cycles_spent = stop_time - start_time;
-		us_spent = k_cyc_to_us_floor32(cycles_spent);
+		return;
 	}
-} /* echo_cb */
+	nrf_timer_event_clear(cfg->timer, gate_event);
+	hc_sr04_gate_expired(dev);
+} /* hc_sr04_timer_isr */
 
-int32_t ultrasonic_init(const struct device *port, gpio_pin_t pin_trig, gpio_pin_t pin_echo)
+static int hc_sr04_init(const struct device *dev)
 {
-    // Set filewide variables for sense_distance() to use
-    port_fw = port;
-	pin_trig_fw = pin_trig;
-    pin_echo_fw = pin_echo;
-	
-    // Configure trigger and echo pins
-    int err;
-	err = gpio_pin_configure(port, pin_trig, GPIO_OUTPUT);
-	err = gpio_pin_configure(port, pin_echo, GPIO_INPUT);
-	err = gpio_pin_interrupt_configure(port, pin_echo, GPIO_INT_EDGE_BOTH);
-	if (err)
+	const struct hc_sr04_config *cfg = dev->config;
+	uint8_t trig_ch, echo_ch;
+	uint8_t ppi_set, ppi_clr, ppi_echo;
+	nrfx_err_t err;
+
+	hc_sr04_common_init(dev);
+
+	// Timer ticking at 1 MHz so captured values are in microseconds, stopped until the first trigger
+	nrf_timer_task_trigger(cfg->timer, NRF_TIMER_TASK_STOP);
+	nrf_timer_int_disable(cfg->timer, nrf_timer_compare_int_get(CC_GATE));
+	nrf_timer_mode_set(cfg->timer, NRF_TIMER_MODE_TIMER);
+	nrf_timer_bit_width_set(cfg->timer, NRF_TIMER_BIT_WIDTH_32);
+	nrf_timer_frequency_set(cfg->timer, NRF_TIMER_FREQ_1MHz);
+	nrf_timer_cc_set(cfg->timer, CC_TRIG_SET, TRIG_START_US);
+	nrf_timer_cc_set(cfg->timer, CC_TRIG_CLR, TRIG_START_US + TRIG_PULSE_US);
+	nrf_timer_task_trigger(cfg->timer, NRF_TIMER_TASK_CLEAR);
+	cfg->irq_connect();
+
+	// GPIOTE is initialised by the GPIO driver, only allocate channels here
+	if (!nrfx_gpiote_is_init() ||
+	    nrfx_gpiote_channel_alloc(&trig_ch) != NRFX_SUCCESS ||
+	    nrfx_gpiote_channel_alloc(&echo_ch) != NRFX_SUCCESS)
 	{
-		return 666;
+		LOG_ERR("No GPIOTE channel available");
+		return -ENODEV;
 	}
 
-	// Initialise callback and add callback functions
-	gpio_init_callback(&echo_cb_data, (gpio_callback_handler_t)echo_cb, BIT(pin_echo));
-	err = gpio_add_callback(port, &echo_cb_data);
-	if (err)
+	const nrfx_gpiote_output_config_t trig_out_cfg = NRFX_GPIOTE_DEFAULT_OUTPUT_CONFIG;
+	const nrfx_gpiote_task_config_t trig_task_cfg = {
+		.task_ch = trig_ch,
+		.polarity = NRF_GPIOTE_POLARITY_TOGGLE,
+		.init_val = NRF_GPIOTE_INITIAL_VALUE_LOW,
+	};
+	err = nrfx_gpiote_output_configure(cfg->trig_pin, &trig_out_cfg, &trig_task_cfg);
+	if (err != NRFX_SUCCESS)
 	{
-		return 667;
+		LOG_ERR("Trigger pin config failed (err 0x%08x)", err);
+		return -EIO;
 	}
+	nrfx_gpiote_out_task_enable(cfg->trig_pin);
 
-	return 0;
-} /* ultrasonic_init */
-
+	const nrfx_gpiote_input_config_t echo_in_cfg = {
+		.pull = NRF_GPIO_PIN_NOPULL,
+	};
+	const nrfx_gpiote_trigger_config_t echo_trig_cfg = {
+		.trigger = NRFX_GPIOTE_TRIGGER_TOGGLE,
+		.p_in_channel = &echo_ch,
+	};
+	const nrfx_gpiote_handler_config_t echo_handler_cfg = {
+		.handler = hc_sr04_echo_handler,
+		.p_context = (void *)dev,
+	};
+	err = nrfx_gpiote_input_configure(cfg->echo_pin, &echo_in_cfg, &echo_trig_cfg, &echo_handler_cfg);
+	if (err != NRFX_SUCCESS)
+	{
+		LOG_ERR("Echo pin config failed (err 0x%08x)", err);
+		return -EIO;
+	}
 
-uint32_t sense_distance(void) 
-{
-	// Send 10 us trigger pulse, after which the echo_cb() ISR will run
-	gpio_pin_set_raw(port_fw, pin_trig_fw, 0);
-	k_sleep(K_USEC(2));
-	gpio_pin_set_raw(port_fw, pin_trig_fw, 1);
-	k_sleep(K_USEC(10));
-	gpio_pin_set_raw(port_fw, pin_trig_fw, 0);
-	k_sleep(K_USEC(2));
-
-	// If device gives a bad reading, return last good value. 15000 chosen empirically
-	if (us_spent > 15000)
+	// Connect timer compares to trigger pin, and echo edges to timer capture
+	if (nrfx_gppi_channel_alloc(&ppi_set) != NRFX_SUCCESS ||
+	    nrfx_gppi_channel_alloc(&ppi_clr) != NRFX_SUCCESS ||
+	    nrfx_gppi_channel_alloc(&ppi_echo) != NRFX_SUCCESS)
 	{
-		return distance;
+		LOG_ERR("No DPPI channel available");
+		return -ENODEV;
 	}
+	nrfx_gppi_channel_endpoints_setup(ppi_set,
+		nrf_timer_event_address_get(cfg->timer, nrf_timer_compare_event_get(CC_TRIG_SET)),
+		nrfx_gpiote_set_task_addr_get(cfg->trig_pin));
+	nrfx_gppi_channel_endpoints_setup(ppi_clr,
+		nrf_timer_event_address_get(cfg->timer, nrf_timer_compare_event_get(CC_TRIG_CLR)),
+		nrfx_gpiote_clr_task_addr_get(cfg->trig_pin));
+	nrfx_gppi_channel_endpoints_setup(ppi_echo,
+		nrfx_gpiote_in_event_addr_get(cfg->echo_pin),
+		nrf_timer_task_address_get(cfg->timer, nrf_timer_capture_task_get(CC_ECHO)));
+	nrfx_gppi_channels_enable(BIT(ppi_set) | BIT(ppi_clr) | BIT(ppi_echo));
+	nrfx_gpiote_trigger_enable(cfg->echo_pin, true);
+
+	return 0;
+} /* hc_sr04_init */
+
+// Absolute nRF pin number of a devicetree GPIO property
+#define HC_SR04_PIN(inst, prop)						\
+	NRF_GPIO_PIN_MAP(DT_PROP(DT_INST_GPIO_CTLR(inst, prop), port),	\
+			 DT_INST_GPIO_PIN(inst, prop))
+
+// TIMER dedicated to a sensor
+#define HC_SR04_TIMER(inst)	DT_INST_PHANDLE(inst, timer)
+
+#define HC_SR04_DEFINE(inst)							\
+	BUILD_ASSERT(DT_INST_NODE_HAS_PROP(inst, timer),			\
+		     "HC-SR04 needs a dedicated TIMER");			\
+	static void hc_sr04_irq_connect_##inst(void)				\
+	{									\
+		IRQ_CONNECT(DT_IRQN(HC_SR04_TIMER(inst)),			\
+			    DT_IRQ(HC_SR04_TIMER(inst), priority),		\
+			    hc_sr04_timer_isr, DEVICE_DT_INST_GET(inst), 0);	\
+		irq_enable(DT_IRQN(HC_SR04_TIMER(inst)));			\
+	}									\
+	static struct hc_sr04_data hc_sr04_data_##inst;				\
+	static const struct hc_sr04_config hc_sr04_config_##inst = {		\
+		.common = {							\
+			.backend = &hc_sr04_timer_backend,			\
+			.mount_deg = DT_INST_PROP(inst, mount_angle),		\
+		},								\
+		.timer = (NRF_TIMER_Type *)DT_REG_ADDR(HC_SR04_TIMER(inst)),	\
+		.trig_pin = HC_SR04_PIN(inst, trig_gpios),			\
+		.echo_pin = HC_SR04_PIN(inst, echo_gpios),			\
+		.irq_connect = hc_sr04_irq_connect_##inst,			\
+	};									\
+	DEVICE_DT_INST_DEFINE(inst, hc_sr04_init, NULL,				\
+			      &hc_sr04_data_##inst, &hc_sr04_config_##inst,	\
+			      POST_KERNEL, CONFIG_SENSOR_INIT_PRIORITY,		\
+			      &hc_sr04_api);
 
-	// Calculate distance in mm. 0.344 is the speed of sound in millimeters per microsecond
-	distance = 0.344*us_spent/2;
-	return distance;
-} /* measure_distance */
+DT_INST_FOREACH_STATUS_OKAY(HC_SR04_DEFINE)
@@ -1,6 +1,34 @@
 /**
  * @file ultrasonic_hc-sr04.h
- * @brief Header file for HC-SR04 proximity sensor module library
+ * @brief Header file for HC-SR04 proximity sensor driver
+ *
+ * The driver implements the Zephyr sensor API. The 10 us trigger pulse is
+ * generated and the echo pulse width is captured by a TIMER connected to the
+ * trigger and echo pins through GPIOTE and DPPI, so the measurement does not
+ * depend on interrupt latency.
+ *
+ * sensor_sample_fetch() blocks until the echo completes unless a
+ * SENSOR_TRIG_DATA_READY handler has been installed with sensor_trigger_set(),
+ * in which case it returns immediately and the handler is called from
+ * interrupt context when the measurement completes or times out. A fetch
+ * issued while the sensor is still recovering from the previous measurement
+ * is queued and triggered by the driver as soon as the sensor is ready.
+ *
+ * Setting HC_SR04_ATTR_MAX_RANGE enables the range-gated fast mode: echoes
+ * beyond the gate are reported as no return as soon as the gate expires, and
+ * the next trigger is allowed once the gate plus a crosstalk guard
+ * (HC_SR04_ATTR_GUARD_US) has passed, instead of waiting out the full echo
+ * window of the sensor.
+ *
+ * sensor_channel_get() fails with -ENODATA when there was no return within
+ * range, and with -ETIMEDOUT when the sensor did not answer the trigger.
+ * Only the first means the way ahead is clear: callers must keep a fault
+ * apart from a no return, see HC_SR04_FAULT_MM.
+ *
+ * Each devicetree instance is a separate device with its own state and
+ * mounting angle, and sensors measure independently of each other. Keeping
+ * sensors which face each other from firing together is up to the caller,
+ * see ranging_sched.h.
  */
 
 #ifndef HCSR04_H
@@ -8,31 +36,82 @@
 
 #include <zephyr/kernel.h>
 #include <zephyr/device.h>
-#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/sensor.h>
+
+/* Echo pulse width in microseconds, read with sensor_channel_get() */
+#define HC_SR04_CHAN_ECHO_US    ((enum sensor_channel)SENSOR_CHAN_PRIV_START)
+
+/* Range gate in metres. Zero disables the gate */
+#define HC_SR04_ATTR_MAX_RANGE  ((enum sensor_attribute)SENSOR_ATTR_PRIV_START)
+/* Crosstalk guard in microseconds, val1 only */
+#define HC_SR04_ATTR_GUARD_US   ((enum sensor_attribute)(SENSOR_ATTR_PRIV_START + 1))
+
+/* Distance reported when there is no return within range */
+#define HC_SR04_NO_RETURN_MM    UINT16_MAX
+/* Distance reported when the measurement failed, which says nothing about the range */
+#define HC_SR04_FAULT_MM        (UINT16_MAX - 1)
+/* Largest distance reported for an actual echo */
+#define HC_SR04_RANGE_MAX_MM    (HC_SR04_FAULT_MM - 1)
+
+/* Without a gate, an echo still high this long after the trigger is treated as no return */
+#define HC_SR04_TIMEOUT_US      25000
+/* Trigger to echo rising edge, while the sensor sends its burst */
+#define HC_SR04_ECHO_DELAY_US   500
+/* Echo width the sensor produces when nothing reflects the burst */
+#define HC_SR04_ECHO_MAX_US     38000
+/* Default time to let residual echoes die out before the next trigger */
+#define HC_SR04_GUARD_US        3000
+/* Trigger to ready again when nothing reflects, the longest cycle of a working sensor */
+#define HC_SR04_CYCLE_US        (HC_SR04_ECHO_DELAY_US + HC_SR04_ECHO_MAX_US + HC_SR04_GUARD_US)
+/* Worst case time from fetch to result */
+#define HC_SR04_CYCLE_MAX_US    (HC_SR04_ECHO_MAX_US + HC_SR04_GUARD_US + HC_SR04_TIMEOUT_US)
+
+/* Convert between echo pulse width and distance. Sound travels 0.344 mm/us and covers the distance twice */
+#define HC_SR04_US_TO_MM(us)    (((uint32_t)(us) * 172U) / 1000U)
+#define HC_SR04_MM_TO_US(mm)    (((uint32_t)(mm) * 1000U) / 172U)
 
 /**
- * @brief Initialise HC-SR04 sensor.
+ * @brief Convert a SENSOR_CHAN_DISTANCE value to millimetres.
  *
- * Intialise trigger and echo pins. Configure an interrupt on the rising and
- * falling edge on the trigger pin.
- *
- * @param port Pointer to the device structure for the driver instance.
- * @param pin_trig Pin number of the trigger pin.
- * @param pin_echo Pin number of the echo pin.
- * @retval 0 if successful.
+ * @param val Distance in metres, as returned by sensor_channel_get().
+ * @returns Distance in millimetres.
  */
-int32_t ultrasonic_init(const struct device *port, gpio_pin_t pin_trig, gpio_pin_t pin_echo);
+static inline uint32_t hc_sr04_value_to_mm(const struct sensor_value *val)
+{
+    return (uint32_t)val->val1 * 1000U + (uint32_t)val->val2 / 1000U;
+}
 
 /**
- * @brief Measure proximity between HC-SR04 and nearest object in sensing range. 
+ * @brief Get the mounting angle of a sensor.
  *
- * Configure trigger and echo pins. Set up an interrupt on the rising and
- * falling edge on the trigger pin.
+ * @param dev HC-SR04 device.
+ * @returns Bearing of the sensor axis in degrees, counter-clockwise from
+ *          straight ahead, from the mount-angle devicetree property.
+ */
+int16_t hc_sr04_mount_angle_get(const struct device *dev);
+
+/**
+ * @brief Get the distance of the last completed measurement.
  *
- * @param port Pointer to the device structure for the driver instance.
- * @param pin_trig Pin number connected to the echo
- * @return Proximity, in millimetres, of nearest object in sensing range.
+ * @param dev HC-SR04 device.
+ * @returns Distance in millimetres, HC_SR04_NO_RETURN_MM if the
+ *          measurement found nothing within range, or HC_SR04_FAULT_MM if
+ *          it failed.
  */
-uint32_t sense_distance(void);
+static inline uint32_t hc_sr04_distance_mm_get(const struct device *dev)
+{
+    struct sensor_value val;
+    int error = sensor_channel_get(dev, SENSOR_CHAN_DISTANCE, &val);
+
+    if (error == -ENODATA)
+    {
+        return HC_SR04_NO_RETURN_MM;
+    }
+    if (error != 0)
+    {
+        return HC_SR04_FAULT_MM;
+    }
+    return MIN(hc_sr04_value_to_mm(&val), HC_SR04_RANGE_MAX_MM);
+}
 
 #endif /* HCSR04_H */
@@ -0,0 +1,303 @@
+/**
+ * @file ultrasonic_hc-sr04_common.c
+ * @brief Source file for the backend independent part of the HC-SR04 driver
+ *
+ * Sensor API and measurement cycle, see ultrasonic_hc-sr04_common.h. The
+ * backends only touch the hardware.
+ */
+
+#include "ultrasonic_hc-sr04_common.h"
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(hc_sr04, CONFIG_SENSOR_LOG_LEVEL);
+
+// Private function prototypes
+static void hc_sr04_start(const struct device *dev);
+static void hc_sr04_ready(const struct device *dev);
+static void hc_sr04_hold(const struct device *dev, uint32_t until_us);
+static void hc_sr04_finish(const struct device *dev, int status, bool drain, uint32_t hold_until_us);
+static void hc_sr04_guard_expired(struct k_timer *timer);
+
+
+// Fire the trigger pulse. Called with interrupts locked or from interrupt context.
+static void hc_sr04_start(const struct device *dev)
+{
+	const struct hc_sr04_common_config *cfg = dev->config;
+	struct hc_sr04_common_data *data = dev->data;
+
+	atomic_set(&data->state, HC_SR04_WAIT_RISE);
+	data->status = -EINPROGRESS;
+	cfg->backend->trigger(dev);
+	cfg->backend->gate_set(dev, HC_SR04_TIMEOUT_US);
+} /* hc_sr04_start */
+
+// Sensor can be triggered again. Start straight away if a fetch is waiting.
+static void hc_sr04_ready(const struct device *dev)
+{
+	struct hc_sr04_common_data *data = dev->data;
+
+	if (data->pending)
+	{
+		data->pending = false;
+		hc_sr04_start(dev);
+	}
+	else
+	{
+		atomic_set(&data->state, HC_SR04_IDLE);
+	}
+} /* hc_sr04_ready */
+
+// Hold off the next trigger until until_us on the clock
+static void hc_sr04_hold(const struct device *dev, uint32_t until_us)
+{
+	const struct hc_sr04_common_config *cfg = dev->config;
+	struct hc_sr04_common_data *data = dev->data;
+	uint32_t now_us = cfg->backend->now_us(dev);
+
+	if (cfg->backend->stop)
+	{
+		cfg->backend->stop(dev);
+	}
+	if ((int32_t)(until_us - now_us) <= 0)
+	{
+		hc_sr04_ready(dev);
+		return;
+	}
+	atomic_set(&data->state, HC_SR04_GUARD);
+	k_timer_start(&data->guard_timer, K_USEC(until_us - now_us), K_NO_WAIT);
+} /* hc_sr04_hold */
+
+// Report a measurement result. Runs in interrupt context.
+static void hc_sr04_finish(const struct device *dev, int status, bool drain, uint32_t hold_until_us)
+{
+	const struct hc_sr04_common_config *cfg = dev->config;
+	struct hc_sr04_common_data *data = dev->data;
+
+	cfg->backend->gate_stop(dev);
+
+	// Leave the measuring states first so the handler can queue the next fetch
+	atomic_set(&data->state, drain ? HC_SR04_DRAIN : HC_SR04_GUARD);
+	data->status = status;
+	k_sem_give(&data->done);
+	if (data->handler)
+	{
+		data->handler(dev, &data->trigger);
+	}
+
+	if (!drain)
+	{
+		hc_sr04_hold(dev, hold_until_us);
+	}
+	else
+	{
+		// No echo lasts longer than this, so the gate bounds a stuck one
+		cfg->backend->gate_set(dev, cfg->backend->now_us(dev) + HC_SR04_ECHO_MAX_US);
+	}
+} /* hc_sr04_finish */
+
+static void hc_sr04_guard_expired(struct k_timer *timer)
+{
+	hc_sr04_ready(k_timer_user_data_get(timer));
+} /* hc_sr04_guard_expired */
+
+void hc_sr04_echo_edge(const struct device *dev, uint32_t at_us, bool high)
+{
+	const struct hc_sr04_common_config *cfg = dev->config;
+	struct hc_sr04_common_data *data = dev->data;
+
+	switch (atomic_get(&data->state))
+	{
+	case HC_SR04_WAIT_RISE:
+		if (!high)
+		{
+			break;
+		}
+		data->echo_start = at_us;
+		atomic_set(&data->state, HC_SR04_WAIT_FALL);
+		if (data->gate_us)
+		{
+			// Cut the measurement short once the echo is beyond the range of interest
+			cfg->backend->gate_set(dev, at_us + data->gate_us);
+		}
+		break;
+	case HC_SR04_WAIT_FALL:
+		if (high)
+		{
+			break;
+		}
+		data->echo_us = at_us - data->echo_start;
+		// Echoes from beyond the gate may still be travelling, so wait until the gate plus guard has passed
+		hc_sr04_finish(dev, 0, false,
+			       data->gate_us ? (data->echo_start + data->gate_us + data->guard_us)
+					     : (at_us + data->guard_us));
+		break;
+	case HC_SR04_DRAIN:
+		if (!high)
+		{
+			cfg->backend->gate_stop(dev);
+			hc_sr04_hold(dev, at_us + data->guard_us);
+		}
+		break;
+	default:
+		break;
+	}
+} /* hc_sr04_echo_edge */
+
+void hc_sr04_gate_expired(const struct device *dev)
+{
+	const struct hc_sr04_common_config *cfg = dev->config;
+	struct hc_sr04_common_data *data = dev->data;
+	uint32_t now_us = cfg->backend->now_us(dev);
+	bool echo_high = cfg->backend->echo_get(dev);
+
+	switch (atomic_get(&data->state))
+	{
+	case HC_SR04_WAIT_RISE:
+		// Sensor never answered the trigger
+		hc_sr04_finish(dev, -ETIMEDOUT, echo_high, now_us + data->guard_us);
+		break;
+	case HC_SR04_WAIT_FALL:
+		// Nothing within range. The sensor ignores triggers while echo is high, so drain it first.
+		hc_sr04_finish(dev, -ENODATA, echo_high, now_us + data->guard_us);
+		break;
+	case HC_SR04_DRAIN:
+		// Echo stuck high, give up on it rather than never trigger again
+		LOG_WRN("%s: echo stuck high, draining abandoned", dev->name);
+		hc_sr04_hold(dev, now_us + data->guard_us);
+		break;
+	default:
+		break;
+	}
+} /* hc_sr04_gate_expired */
+
+static int hc_sr04_sample_fetch(const struct device *dev, enum sensor_channel chan)
+{
+	struct hc_sr04_common_data *data = dev->data;
+	unsigned int key;
+
+	if (chan != SENSOR_CHAN_ALL && chan != SENSOR_CHAN_DISTANCE)
+	{
+		return -ENOTSUP;
+	}
+
+	key = irq_lock();
+	switch (atomic_get(&data->state))
+	{
+	case HC_SR04_IDLE:
+		k_sem_reset(&data->done);
+		hc_sr04_start(dev);
+		break;
+	case HC_SR04_DRAIN:
+	case HC_SR04_GUARD:
+		// Trigger as soon as the sensor is ready again
+		k_sem_reset(&data->done);
+		data->pending = true;
+		break;
+	default:
+		irq_unlock(key);
+		return -EBUSY;
+	}
+	irq_unlock(key);
+
+	// Asynchronous mode, completion is reported through the trigger handler
+	if (data->handler)
+	{
+		return 0;
+	}
+
+	if (k_sem_take(&data->done, K_USEC(HC_SR04_CYCLE_MAX_US)) != 0)
+	{
+		return -ETIMEDOUT;
+	}
+	return data->status;
+} /* hc_sr04_sample_fetch */
+
+static int hc_sr04_channel_get(const struct device *dev, enum sensor_channel chan, struct sensor_value *val)
+{
+	struct hc_sr04_common_data *data = dev->data;
+	uint32_t mm;
+
+	if (data->status != 0)
+	{
+		return data->status;
+	}
+
+	switch ((int)chan)
+	{
+	case SENSOR_CHAN_DISTANCE:
+		mm = HC_SR04_US_TO_MM(data->echo_us);
+		val->val1 = mm / 1000U;
+		val->val2 = (mm % 1000U) * 1000U;
+		return 0;
+	case HC_SR04_CHAN_ECHO_US:
+		val->val1 = data->echo_us;
+		val->val2 = 0;
+		return 0;
+	default:
+		return -ENOTSUP;
+	}
+} /* hc_sr04_channel_get */
+
+static int hc_sr04_attr_set(const struct device *dev, enum sensor_channel chan,
+			    enum sensor_attribute attr, const struct sensor_value *val)
+{
+	struct hc_sr04_common_data *data = dev->data;
+
+	if (chan != SENSOR_CHAN_ALL && chan != SENSOR_CHAN_DISTANCE)
+	{
+		return -ENOTSUP;
+	}
+
+	switch ((int)attr)
+	{
+	case HC_SR04_ATTR_MAX_RANGE:
+		data->gate_us = MIN(HC_SR04_MM_TO_US(hc_sr04_value_to_mm(val)), HC_SR04_TIMEOUT_US);
+		return 0;
+	case HC_SR04_ATTR_GUARD_US:
+		data->guard_us = val->val1;
+		return 0;
+	default:
+		return -ENOTSUP;
+	}
+} /* hc_sr04_attr_set */
+
+static int hc_sr04_trigger_set(const struct device *dev, const struct sensor_trigger *trig,
+			       sensor_trigger_handler_t handler)
+{
+	struct hc_sr04_common_data *data = dev->data;
+
+	if (trig->type != SENSOR_TRIG_DATA_READY)
+	{
+		return -ENOTSUP;
+	}
+	data->trigger = *trig;
+	data->handler = handler;
+
+	return 0;
+} /* hc_sr04_trigger_set */
+
+void hc_sr04_common_init(const struct device *dev)
+{
+	struct hc_sr04_common_data *data = dev->data;
+
+	k_sem_init(&data->done, 0, 1);
+	k_timer_init(&data->guard_timer, hc_sr04_guard_expired, NULL);
+	k_timer_user_data_set(&data->guard_timer, (void *)dev);
+	atomic_set(&data->state, HC_SR04_IDLE);
+	data->status = -ENODATA;
+	data->guard_us = HC_SR04_GUARD_US;
+} /* hc_sr04_common_init */
+
+int16_t hc_sr04_mount_angle_get(const struct device *dev)
+{
+	const struct hc_sr04_common_config *cfg = dev->config;
+
+	return cfg->mount_deg;
+} /* hc_sr04_mount_angle_get */
+
+const struct sensor_driver_api hc_sr04_api = {
+	.sample_fetch = hc_sr04_sample_fetch,
+	.channel_get = hc_sr04_channel_get,
+	.attr_set = hc_sr04_attr_set,
+	.trigger_set = hc_sr04_trigger_set,
+};
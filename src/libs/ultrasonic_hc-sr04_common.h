@@ -0,0 +1,90 @@
+/**
+ * @file ultrasonic_hc-sr04_common.h
+ * @brief Header file for the backend independent part of the HC-SR04 driver
+ *
+ * The sensor API and the measurement cycle are shared by both backends:
+ *   IDLE -> WAIT_RISE -> WAIT_FALL -> GUARD -> IDLE
+ * The result is reported as soon as the echo falls or the gate expires. If
+ * the echo is still high at that point the sensor ignores triggers until it
+ * drops, so the cycle passes through DRAIN before GUARD. An echo still high
+ * HC_SR04_ECHO_MAX_US into DRAIN is stuck, and the driver moves on to GUARD
+ * regardless. A fetch requested during DRAIN or GUARD is started as soon as
+ * the guard ends.
+ *
+ * A backend only supplies the trigger pulse, a microsecond measurement clock
+ * restarted at every trigger and a one shot gate on that clock, through
+ * struct hc_sr04_backend. It reports echo edges with hc_sr04_echo_edge() and
+ * gate expiry with hc_sr04_gate_expired(). Its config and data structures
+ * start with the common ones, so the shared code can reach them through the
+ * device.
+ */
+
+#ifndef HCSR04_COMMON_H
+#define HCSR04_COMMON_H
+
+#include "ultrasonic_hc-sr04.h"
+#include <zephyr/sys/atomic.h>
+
+enum hc_sr04_state {
+	HC_SR04_IDLE,       // Ready to trigger
+	HC_SR04_WAIT_RISE,  // Triggered, waiting for echo rising edge
+	HC_SR04_WAIT_FALL,  // Echo in progress, waiting for falling edge or gate
+	HC_SR04_DRAIN,      // Result reported with echo still high, waiting for it to end
+	HC_SR04_GUARD,      // Waiting for residual echoes to die out
+};
+
+// Hardware access of a backend. Called with interrupts locked or from interrupt context
+struct hc_sr04_backend {
+	void (*trigger)(const struct device *dev);                   // Restart the clock from zero and fire the trigger pulse
+	void (*stop)(const struct device *dev);                      // Clock not needed until the next trigger, may be NULL
+	uint32_t (*now_us)(const struct device *dev);                // Time on the clock
+	void (*gate_set)(const struct device *dev, uint32_t at_us);  // Call hc_sr04_gate_expired() at this time on the clock
+	void (*gate_stop)(const struct device *dev);
+	bool (*echo_get)(const struct device *dev);                  // Echo pin level
+};
+
+struct hc_sr04_common_config {
+	const struct hc_sr04_backend *backend;
+	int16_t mount_deg;
+};
+
+struct hc_sr04_common_data {
+	atomic_t state;
+	bool pending;
+	volatile int status;
+	volatile uint32_t echo_start;
+	volatile uint32_t echo_us;
+	uint32_t gate_us;
+	uint32_t guard_us;
+	struct k_timer guard_timer;
+	struct k_sem done;
+	sensor_trigger_handler_t handler;
+	struct sensor_trigger trigger;
+};
+
+extern const struct sensor_driver_api hc_sr04_api;
+
+/**
+ * @brief Initialise the common state of a sensor, before its backend.
+ *
+ * @param dev HC-SR04 device.
+ */
+void hc_sr04_common_init(const struct device *dev);
+
+/**
+ * @brief Advance the measurement cycle on an echo pin edge. Interrupt context.
+ *
+ * @param dev HC-SR04 device.
+ * @param at_us Time of the edge on the clock.
+ * @param high Echo pin level after the edge.
+ */
+void hc_sr04_echo_edge(const struct device *dev, uint32_t at_us, bool high);
+
+/**
+ * @brief Advance the measurement cycle when the gate set by the backend expires. Interrupt context.
+ *
+ * @param dev HC-SR04 device.
+ */
+void hc_sr04_gate_expired(const struct device *dev);
+
+#endif /* HCSR04_COMMON_H */
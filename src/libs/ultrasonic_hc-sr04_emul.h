@@ -0,0 +1,30 @@
+/**
+ * @file ultrasonic_hc-sr04_emul.h
+ * @brief Header file for the HC-SR04 emulator hook of the GPIO backend
+ *
+ * The GPIO emulator does not report changes on output pins, so the GPIO
+ * backend of the driver calls a hook after each trigger pulse. An emulated
+ * sensor answers it by driving the echo pin with gpio_emul_input_set().
+ */
+
+#ifndef HCSR04_EMUL_H
+#define HCSR04_EMUL_H
+
+#include <zephyr/device.h>
+
+/**
+ * @brief Called after each trigger pulse, from thread or interrupt context.
+ *
+ * @param dev HC-SR04 device which fired the trigger.
+ */
+typedef void (*hc_sr04_emul_trigger_cb_t)(const struct device *dev);
+
+/**
+ * @brief Install the trigger hook.
+ *
+ * @param dev HC-SR04 device.
+ * @param cb Hook, or NULL to remove it.
+ */
+void hc_sr04_emul_trigger_cb_set(const struct device *dev, hc_sr04_emul_trigger_cb_t cb);
+
+#endif /* HCSR04_EMUL_H */
@@ -0,0 +1,182 @@
+/**
+ * @file ultrasonic_hc-sr04_gpio.c
+ * @brief Source file for HC-SR04 proximity sensor driver, GPIO backend
+ *
+ * Portable backend for boards without the nRF TIMER, GPIOTE and DPPI
+ * peripherals, used by the native_posix build. The trigger pulse is driven
+ * and the echo edges are timestamped in software with the cycle counter, so
+ * the measurement depends on interrupt latency.
+ *
+ * The measurement cycle and the sensor API are shared with the nRF backend,
+ * see ultrasonic_hc-sr04_common.h. The measurement clock is the cycle count
+ * since the trigger and the gate a kernel timer.
+ */
+
+#define DT_DRV_COMPAT hc_sr04
+
+#include "ultrasonic_hc-sr04_common.h"
+#include "ultrasonic_hc-sr04_emul.h"
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_DECLARE(hc_sr04, CONFIG_SENSOR_LOG_LEVEL);
+
+#define TRIG_PULSE_US       10
+
+struct hc_sr04_config {
+	struct hc_sr04_common_config common;
+	struct gpio_dt_spec trig;
+	struct gpio_dt_spec echo;
+};
+
+struct hc_sr04_data {
+	struct hc_sr04_common_data common;
+	const struct device *dev;
+	uint32_t trigger_cycles;
+	struct k_timer gate_timer;
+	struct gpio_callback echo_cb;
+	hc_sr04_emul_trigger_cb_t emul_cb;
+};
+
+// Private function prototypes
+static void hc_sr04_trigger(const struct device *dev);
+static uint32_t hc_sr04_now(const struct device *dev);
+static void hc_sr04_gate_set(const struct device *dev, uint32_t at_us);
+static void hc_sr04_gate_stop(const struct device *dev);
+static bool hc_sr04_echo_get(const struct device *dev);
+static void hc_sr04_gate_timer_expired(struct k_timer *timer);
+static void hc_sr04_echo_handler(const struct device *port, struct gpio_callback *cb, gpio_port_pins_t pins);
+
+static const struct hc_sr04_backend hc_sr04_gpio_backend = {
+	.trigger = hc_sr04_trigger,
+	.now_us = hc_sr04_now,
+	.gate_set = hc_sr04_gate_set,
+	.gate_stop = hc_sr04_gate_stop,
+	.echo_get = hc_sr04_echo_get,
+};
+
+
+static void hc_sr04_trigger(const struct device *dev)
+{
+	const struct hc_sr04_config *cfg = dev->config;
+	struct hc_sr04_data *data = dev->data;
+
+	data->trigger_cycles = k_cycle_get_32();
+	gpio_pin_set_dt(&cfg->trig, 1);
+	k_busy_wait(TRIG_PULSE_US);
+	gpio_pin_set_dt(&cfg->trig, 0);
+
+	if (data->emul_cb)
+	{
+		data->emul_cb(dev);
+	}
+} /* hc_sr04_trigger */
+
+// Microseconds since the last trigger
+static uint32_t hc_sr04_now(const struct device *dev)
+{
+	struct hc_sr04_data *data = dev->data;
+
+	return k_cyc_to_us_floor32(k_cycle_get_32() - data->trigger_cycles);
+} /* hc_sr04_now */
+
+static void hc_sr04_gate_set(const struct device *dev, uint32_t at_us)
+{
+	struct hc_sr04_data *data = dev->data;
+	int32_t left_us = (int32_t)(at_us - hc_sr04_now(dev));
+
+	k_timer_start(&data->gate_timer, K_USEC(MAX(left_us, 0)), K_NO_WAIT);
+} /* hc_sr04_gate_set */
+
+static void hc_sr04_gate_stop(const struct device *dev)
+{
+	struct hc_sr04_data *data = dev->data;
+
+	k_timer_stop(&data->gate_timer);
+} /* hc_sr04_gate_stop */
+
+static bool hc_sr04_echo_get(const struct device *dev)
+{
+	const struct hc_sr04_config *cfg = dev->config;
+
+	return gpio_pin_get_dt(&cfg->echo) > 0;
+} /* hc_sr04_echo_get */
+
+// Range gate, or measurement timeout when no gate is set
+static void hc_sr04_gate_timer_expired(struct k_timer *timer)
+{
+	hc_sr04_gate_expired(k_timer_user_data_get(timer));
+} /* hc_sr04_gate_timer_expired */
+
+// Echo pin ISR, called on both edges
+static void hc_sr04_echo_handler(const struct device *port, struct gpio_callback *cb, gpio_port_pins_t pins)
+{
+	ARG_UNUSED(port);
+	ARG_UNUSED(pins);
+	struct hc_sr04_data *data = CONTAINER_OF(cb, struct hc_sr04_data, echo_cb);
+
+	hc_sr04_echo_edge(data->dev, hc_sr04_now(data->dev), hc_sr04_echo_get(data->dev));
+} /* hc_sr04_echo_handler */
+
+void hc_sr04_emul_trigger_cb_set(const struct device *dev, hc_sr04_emul_trigger_cb_t cb)
+{
+	struct hc_sr04_data *data = dev->data;
+
+	data->emul_cb = cb;
+} /* hc_sr04_emul_trigger_cb_set */
+
+static int hc_sr04_init(const struct device *dev)
+{
+	const struct hc_sr04_config *cfg = dev->config;
+	struct hc_sr04_data *data = dev->data;
+	int err;
+
+	hc_sr04_common_init(dev);
+	data->dev = dev;
+	k_timer_init(&data->gate_timer, hc_sr04_gate_timer_expired, NULL);
+	k_timer_user_data_set(&data->gate_timer, (void *)dev);
+
+	if (!device_is_ready(cfg->trig.port) || !device_is_ready(cfg->echo.port))
+	{
+		LOG_ERR("GPIO port not ready");
+		return -ENODEV;
+	}
+
+	err = gpio_pin_configure_dt(&cfg->trig, GPIO_OUTPUT_INACTIVE);
+	if (err)
+	{
+		LOG_ERR("Trigger pin config failed (err %d)", err);
+		return err;
+	}
+	err = gpio_pin_configure_dt(&cfg->echo, GPIO_INPUT);
+	if (err)
+	{
+		LOG_ERR("Echo pin config failed (err %d)", err);
+		return err;
+	}
+
+	gpio_init_callback(&data->echo_cb, hc_sr04_echo_handler, BIT(cfg->echo.pin));
+	err = gpio_add_callback(cfg->echo.port, &data->echo_cb);
+	if (err)
+	{
+		return err;
+	}
+	return gpio_pin_interrupt_configure_dt(&cfg->echo, GPIO_INT_EDGE_BOTH);
+} /* hc_sr04_init */
+
+#define HC_SR04_DEFINE(inst)							\
+	static struct hc_sr04_data hc_sr04_data_##inst;				\
+	static const struct hc_sr04_config hc_sr04_config_##inst = {		\
+		.common = {							\
+			.backend = &hc_sr04_gpio_backend,			\
+			.mount_deg = DT_INST_PROP(inst, mount_angle),		\
+		},								\
+		.trig = GPIO_DT_SPEC_INST_GET(inst, trig_gpios),		\
+		.echo = GPIO_DT_SPEC_INST_GET(inst, echo_gpios),		\
+	};									\
+	DEVICE_DT_INST_DEFINE(inst, hc_sr04_init, NULL,				\
+			      &hc_sr04_data_##inst, &hc_sr04_config_##inst,	\
+			      POST_KERNEL, CONFIG_SENSOR_INIT_PRIORITY,		\
+			      &hc_sr04_api);
+
+DT_INST_FOREACH_STATUS_OKAY(HC_SR04_DEFINE)
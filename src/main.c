@@ -8,12 +8,25 @@
 #include <dk_buttons_and_leds.h>
 #include <zephyr/device.h>
 #include <zephyr/drivers/pwm.h>
-#include <zephyr/drivers/display.h>
-#include <bluetooth/services/nus.h>
-#include <lvgl.h>
+#include <zephyr/drivers/sensor.h>
 #include "remote_service/remote.h"
+#include "remote_service/link.h"
 #include "libs/ultrasonic_hc-sr04.h"
 #include "helpers.h"
+#include "sweep.h"
+#include "motor.h"
+#include "drive.h"
+#include "safety.h"
+#include "stats.h"
+#include "periodic.h"
+#include "ranging_sched.h"
+#include "radar_bx.h"
+#include "radar_filter.h"
+#include "radar_frame.h"
+#include "oled.h"
+#include "dot_matrix/dot_matrix.h"
+#include "battery.h"
+#include "power.h"
 
 // Logging
 #define LOG_MODULE_NAME Benjamin_main
@@ -22,55 +35,123 @@ LOG_MODULE_REGISTER(LOG_MODULE_NAME);
 // GPIO
 #define RUN_STATUS_LED DK_LED1
 #define CONN_STATUS_LED DK_LED2
-#define RUN_LED_BLINK_INTERVAL 1000
-
-// Pin definitions
-#define ULTRASONIC_TRIG_PIN 25
-#define ULTRASONIC_ECHO_PIN 26
-
-// OLED Display
-#define MY_DISP_HOR_RES 128
-#define MY_DISP_VER_RES 64
 
 // Motors
-#define MOTOR_TIMEOUT_MS 120
+#define ROBOT_SPEED_US 350      // Max MOTOR_SPEED_MAX_US
+BUILD_ASSERT(DRIVE_PACKET_MAX_SETPOINTS <= MOTOR_BATCH_MAX, "Motor thread must take a whole drive packet");
+BUILD_ASSERT((1 + LINK_IDLE_LATENCY) * LINK_IDLE_INTERVAL_MAX * 5 / 4 < MOTOR_TIMEOUT_MS,
+             "A keep-alive must reach the motor watchdog while the link is still idle");
+
+// Radar
+#define RADAR_SETTLE_BASE_US 8000       // Mean PWM update latency plus servo ringing
+#define RADAR_SETTLE_PER_BIN_US 7000    // Servo travel time across one bin
+BUILD_ASSERT(HC_SR04_NO_RETURN_MM == RADAR_FRAME_NO_RETURN, "Ranging and radar frame must agree on no return value");
+BUILD_ASSERT(HC_SR04_NO_RETURN_MM == RADAR_FILTER_NO_RETURN, "Ranging and radar filter must agree on no return value");
+
+// Ultrasonic sensors, the one on the radar servo is always sensor 0
+#define RANGING_SENSOR_COUNT    DT_NUM_INST_STATUS_OKAY(hc_sr04)
+#define RANGING_SWEPT           0
+#define RANGING_SEPARATION_DEG  90      // Sensors fire together only if their fields of view are this far apart
+BUILD_ASSERT(RANGING_SENSOR_COUNT <= RANGING_SCHED_MAX_SENSORS, "Too many ultrasonic sensors for the scheduler");
+BUILD_ASSERT(RANGING_SENSOR_COUNT <= SAFETY_SENSORS_MAX, "Too many ultrasonic sensors for obstacle avoidance");
+BUILD_ASSERT(RANGING_SENSOR_COUNT - 1 <= REMOTE_RANGES_MAX, "Too many fixed sensors for the ranges notification");
+
+// Periodic tasks, priorities in rate monotonic order below the motor thread (2).
+// Ranging and sweep stepping share a period: the servo is stepped once the
+// sample is in and has the rest of the period to settle on the next bin.
+// The range gate reports open space early, but the sensor holds its echo for
+// the full 38 ms and ignores triggers until it drops. The period covers that
+// cycle, so each release finds the sensor ready and the deadline only has to
+// cover a measurement ended by the gate. A sensor which does not answer still
+// costs a deadline miss, counted in the task statistics
+#define RANGING_PERIOD_MS       DIV_ROUND_UP(HC_SR04_CYCLE_US, 1000)
+#define RANGING_DEADLINE_MS     10      // Trigger, echo from the range gate and readout
+#define RANGING_PRIORITY        3
+#define SWEEP_PERIOD_MS         RANGING_PERIOD_MS
+#define SWEEP_PHASE_MS          RANGING_DEADLINE_MS
+#define SWEEP_DEADLINE_MS       5
+#define SWEEP_PRIORITY          3
+#define RADAR_PERIOD_MS         50
+#define RADAR_DEADLINE_MS       50
+#define RADAR_PRIORITY          5
+#define DISPLAY_PERIOD_MS       100
+#define DISPLAY_DEADLINE_MS     100
+#define DISPLAY_PRIORITY        7
+#define TELEMETRY_PERIOD_MS     1000
+#define TELEMETRY_DEADLINE_MS   100
+#define TELEMETRY_PRIORITY      8
+#define LINK_PRIORITY           6       // Main thread once initialised, only woken by link changes
+BUILD_ASSERT(RADAR_SETTLE_BASE_US + RADAR_SETTLE_PER_BIN_US <= (RANGING_PERIOD_MS - SWEEP_PHASE_MS) * 1000,
+             "Servo must settle on the next bin before the next ranging release");
+BUILD_ASSERT(HC_SR04_ECHO_DELAY_US + HC_SR04_MM_TO_US(RADAR_RANGE_MM) <= RANGING_DEADLINE_MS * 1000,
+             "Ranging deadline must cover a measurement ended by the range gate");
+BUILD_ASSERT(2 * (RADAR_SCAN_BINS - 1) * RANGING_PERIOD_MS <= SAFETY_RANGE_MAX_AGE_MS,
+             "Obstacle avoidance must keep a bin's range until the sweep comes back to it");
 
 // Function prototypes
 static struct bt_conn *current_conn;
 static void on_connected(struct bt_conn *conn, uint8_t error);
 static void on_disconnected(struct bt_conn *conn, uint8_t reason);
 static void on_data_received(struct bt_conn *conn, const uint8_t *const data, uint16_t len);
-static void update_motors(uint8_t dir_ascii);
-static void reset_motors(struct k_timer *timer);
+static void on_drive_received(struct bt_conn *conn, const struct drive_packet *pkt);
+static void on_safety_config_received(struct bt_conn *conn, uint16_t stop_mm, uint16_t slow_mm);
+static void on_ranging_done(const struct device *dev, const struct sensor_trigger *trig);
+static void on_battery_changed(uint16_t mv);
+static void link_active(void);
+static void link_idle(void);
+static void measure_distances(uint8_t mask, uint16_t *mm);
 static void config_dk_leds(void);
-static void i2c_init(void);
-static void oled_init(void);
-
-// Timers
-K_TIMER_DEFINE(motor_timeout, reset_motors, NULL);  
+static void config_ranging(void);
+static void ranging_run(void);
+static void send_fixed_ranges(void);
+static void sweep_run(void);
+static void radar_run(void);
+static void display_run(void);
+static void telemetry_run(void);
+static void report_overruns(void);
+
+// Periodic tasks
+PERIODIC_TASK_DEFINE(ranging, ranging_run, RANGING_PERIOD_MS, RANGING_DEADLINE_MS, 0, RANGING_PRIORITY, 1024);
+PERIODIC_TASK_DEFINE(sweep, sweep_run, SWEEP_PERIOD_MS, SWEEP_DEADLINE_MS, SWEEP_PHASE_MS, SWEEP_PRIORITY, 512);
+PERIODIC_TASK_DEFINE(radar, radar_run, RADAR_PERIOD_MS, RADAR_DEADLINE_MS, 0, RADAR_PRIORITY, 1024);
+PERIODIC_TASK_DEFINE(display, display_run, DISPLAY_PERIOD_MS, DISPLAY_DEADLINE_MS, 0, DISPLAY_PRIORITY, 1024);
+PERIODIC_TASK_DEFINE(telemetry, telemetry_run, TELEMETRY_PERIOD_MS, TELEMETRY_DEADLINE_MS, 0, TELEMETRY_PRIORITY, 1024);
+
+// Measurement completion, bit i is sensor i
+static K_EVENT_DEFINE(ranging_done);
+
+// Sensors fired by each ranging release. Owned by the ranging task once started
+static struct ranging_sched ranging_sched;
+
+// Mounting angle of each sensor, fixed once configured
+static int16_t ranging_bearing_deg[RANGING_SENSOR_COUNT];
+
+// Latest distance of each fixed sensor, written by the ranging task and sent by the radar task with each sweep
+static atomic_t fixed_mm[RANGING_SENSOR_COUNT];
+
+// Cycle count of the last echo completion interrupt of the swept sensor, and of the one ending the last sweep
+static volatile uint32_t ranging_done_cycles;
+static volatile uint32_t sweep_end_cycles;
+
+// Scan state. The ranging task only reads it while bin_sampled is clear and
+// the sweep task only moves the servo while it is set
+static struct sweep scan;
+static bool scan_ready;
+static atomic_t bin_sampled;
+
+// Owned by the radar processing task
+static struct radar_filter filter;
 
 // Initialise devices
-static const struct device *gpio_dev = DEVICE_DT_GET(DT_NODELABEL(gpio0));
-static const struct pwm_dt_spec motors_l = PWM_DT_SPEC_GET(DT_NODELABEL(motors_l));
-static const struct pwm_dt_spec motors_r = PWM_DT_SPEC_GET(DT_NODELABEL(motors_r));
+#define RANGING_SENSOR(node_id) DEVICE_DT_GET(node_id),
+static const struct device *ranging_sensors[RANGING_SENSOR_COUNT] = {
+    DT_FOREACH_STATUS_OKAY(hc_sr04, RANGING_SENSOR)
+};
+static const struct device *ultrasonic_f = DEVICE_DT_GET(DT_NODELABEL(ultrasonic_f));
 static const struct pwm_dt_spec motor_f = PWM_DT_SPEC_GET(DT_NODELABEL(motor_f));
 static const uint32_t MIN_PULSE_F = DT_PROP(DT_NODELABEL(motor_f), min_pulse);
 static const uint32_t MAX_PULSE_F = DT_PROP(DT_NODELABEL(motor_f), max_pulse);
-static const struct device *oled_dev;
-
-// Variable declarations
-typedef enum
-{
-    NONE_E = 0,
-    NORTH_E = 1,
-    NORTHEAST_E = 2,
-    EAST_E = 3,
-    SOUTHEAST_E = 4,
-    SOUTH_E = 5,
-    SOUTHWEST_E = 6,
-    WEST_E = 7,
-    NORTHWEST_E = 8
-} robot_dir_t;
+static const struct device *oled_dev = DEVICE_DT_GET(DT_NODELABEL(ssd1306));
 
 struct bt_conn_cb bluetooth_callbacks = {
 	.connected 		= on_connected,
@@ -79,6 +160,8 @@ struct bt_conn_cb bluetooth_callbacks = {
 
 struct bt_remote_service_cb remote_callbacks = {
     .data_received = on_data_received,
+    .drive_received = on_drive_received,
+    .safety_config_received = on_safety_config_received,
 }; 
 
 /* Callbacks */
@@ -91,129 +174,149 @@ static void on_connected(struct bt_conn *conn, uint8_t error)
 	LOG_INF("Connected.");
 	current_conn = bt_conn_ref(conn);
 	dk_set_led_on(CONN_STATUS_LED);
+    power_link_set(true);
 } /* on_connected */
 
 static void on_disconnected(struct bt_conn *conn, uint8_t reason)
 {
 	LOG_INF("Disconnected (reason: %d)", reason);
 	dk_set_led_off(CONN_STATUS_LED);
+    power_link_set(false);
 	if(current_conn) {
 		bt_conn_unref(current_conn);
 		current_conn = NULL;
 	}
 } /* on_disconnected */
 
+// Runs in the Bluetooth RX context, so only queues the command for the motor thread
 static void on_data_received(struct bt_conn *conn, const uint8_t *const data, uint16_t len)
 {
-    uint8_t temp_str[len+1];
-    memcpy(temp_str, data, len);
-    temp_str[len] = 0x00;
+    struct motor_setpoint sp;
 
-    LOG_DBG("Received data on conn %p. Len: %d", (void *)conn, len);;
-    LOG_DBG("Data: %s", temp_str);
+    if (len < 1)
+    {
+        return;
+    }
 
-    update_motors(temp_str[0]); 
+    // Black magic convert to numeric
+    if (drive_dir_speeds((uint8_t)(data[0] - '0'), ROBOT_SPEED_US, &sp) != 0)
+    {
+        return;
+    }
 
-    // Start/reset timer. Call reset_motors if time elapses.
-    k_timer_start(&motor_timeout, K_MSEC(MOTOR_TIMEOUT_MS), K_NO_WAIT);
-    
+    motor_submit(sp.left_us, sp.right_us);
 } /* on_data_received */
 
-static void update_motors(uint8_t dir_ascii)
+// Runs in the Bluetooth RX context, so only queues the setpoints for the motor thread
+static void on_drive_received(struct bt_conn *conn, const struct drive_packet *pkt)
 {
-    uint16_t error;
-    robot_dir_t dir;
-    uint32_t motors_l_pwm_ns = 1500;
-    uint32_t motors_r_pwm_ns = 1500;
-    const uint32_t ROBOT_SPEED = 350;       // Max 500
-    
-    dir = (uint8_t)(dir_ascii - '0');       // Black magic convert to numeric
-    LOG_DBG("ASCII: %u", dir_ascii);
-    LOG_DBG("Int: %u", dir);
-
-    /* Motor PWM->Speed Reference:
-        Max foward = 2000 us
-        Max reverse = 1000 us
-        Stop = 1500 us. Dead band [1480-1520] us 
-    */
-    switch(dir)
-    {
-        case NONE_E:
-            motors_l_pwm_ns = PWM_USEC(1500);
-            motors_r_pwm_ns = PWM_USEC(1500);
-            break;
-        case NORTH_E: 
-            motors_l_pwm_ns = PWM_USEC(1500 + ROBOT_SPEED);
-            motors_r_pwm_ns = PWM_USEC(1500 + ROBOT_SPEED);
-            break;
-        case NORTHEAST_E:
-            motors_l_pwm_ns = PWM_USEC(1500 + ROBOT_SPEED);
-            motors_r_pwm_ns = PWM_USEC(1500 + ROBOT_SPEED/2);
-            break;
-        case EAST_E:
-            motors_l_pwm_ns = PWM_USEC(1500 + ROBOT_SPEED);
-            motors_r_pwm_ns = PWM_USEC(1500 - ROBOT_SPEED);
-            break;
-        case SOUTHEAST_E:
-            motors_l_pwm_ns = PWM_USEC(1500 - ROBOT_SPEED);
-            motors_r_pwm_ns = PWM_USEC(1500 - ROBOT_SPEED/2);
-            break;
-        case SOUTH_E:
-            motors_l_pwm_ns = PWM_USEC(1500 - ROBOT_SPEED);
-            motors_r_pwm_ns = PWM_USEC(1500 - ROBOT_SPEED);
-            break;
-        case SOUTHWEST_E:
-            motors_l_pwm_ns = PWM_USEC(1500 - ROBOT_SPEED/2);
-            motors_r_pwm_ns = PWM_USEC(1500 - ROBOT_SPEED);
-            break;
-        case WEST_E:
-            motors_l_pwm_ns = PWM_USEC(1500 - ROBOT_SPEED);
-            motors_r_pwm_ns = PWM_USEC(1500 + ROBOT_SPEED);
-            break;
-        case NORTHWEST_E:
-            motors_l_pwm_ns = PWM_USEC(1500 + ROBOT_SPEED/2);
-            motors_r_pwm_ns = PWM_USEC(1500 + ROBOT_SPEED);
-            break;
-        default:
-            LOG_INF("Controller incorrectly configured. See robot_dir_t enum definition.");
-            break;    
-    }   
+    struct motor_setpoint setpoints[DRIVE_PACKET_MAX_SETPOINTS];
 
-    // Set motor speeds
-    error = pwm_set_pulse_dt(&motors_l, motors_l_pwm_ns);
-    if (error < 0)
+    for (uint8_t i = 0; i < pkt->count; i++)
     {
-        LOG_ERR("Error %d: failed to set pulse width of left motors", error);
-        return;
+        setpoints[i].delay_ms = pkt->setpoints[i].delay_ms;
+        drive_mix(pkt->setpoints[i].throttle, pkt->setpoints[i].steering, &setpoints[i]);
     }
-    error = pwm_set_pulse_dt(&motors_r, motors_r_pwm_ns);
-    if (error < 0)
+
+    motor_submit_ramped(setpoints, pkt->count);
+} /* on_drive_received */
+
+static void on_safety_config_received(struct bt_conn *conn, uint16_t stop_mm, uint16_t slow_mm)
+{
+    if (safety_config_set(stop_mm, slow_mm) != 0)
     {
-        LOG_ERR("Error %d: failed to set pulse width of right motors", error);
-        return;
-	}
-    LOG_DBG("Left motor set to %u us", motors_l_pwm_ns/1000);
-    LOG_DBG("Right motor set to %u us", motors_r_pwm_ns/1000);
-    
-} /* update_motors */
+        LOG_WRN("Rejected safety distances %u mm, %u mm", stop_mm, slow_mm);
+    }
+} /* on_safety_config_received */
 
-static void reset_motors(struct k_timer *timer)
+static void on_ranging_done(const struct device *dev, const struct sensor_trigger *trig)
 {
-    ARG_UNUSED(timer);
-    uint16_t error;
-    error = pwm_set_pulse_dt(&motors_l, PWM_USEC(1500));
-     if (error < 0) {
-			LOG_ERR("Error %d: failed to reset left motors", error);
-			return;
-		}
-    error = pwm_set_pulse_dt(&motors_r, PWM_USEC(1500));
-    if (error < 0) {
-			LOG_ERR("Error %d: failed to reset right motors", error);
-			return;
-		}
-    LOG_INF("Motors turned off (1500 us)");
-
-} /* reset_motors */
+    ARG_UNUSED(trig);
+    for (uint8_t i = 0; i < RANGING_SENSOR_COUNT; i++)
+    {
+        if (ranging_sensors[i] != dev)
+        {
+            continue;
+        }
+        if (i == RANGING_SWEPT)
+        {
+            ranging_done_cycles = k_cycle_get_32();
+        }
+        k_event_post(&ranging_done, BIT(i));
+    }
+} /* on_ranging_done */
+
+// Runs in the system workqueue, only when the voltage moved past the hysteresis
+static void on_battery_changed(uint16_t mv)
+{
+    oled_battery_set(mv);
+    remote_battery_level_set(battery_level(mv));
+    // The display task only runs while connected
+    if (!power_link_is_up())
+    {
+        oled_refresh();
+    }
+} /* on_battery_changed */
+
+// Fire a slot of sensors together and collect their distances. A sensor which
+// found nothing within range reads HC_SR04_NO_RETURN_MM, one which failed to
+// measure reads HC_SR04_FAULT_MM
+static void measure_distances(uint8_t mask, uint16_t *mm)
+{
+    struct sensor_value val;
+    k_timeout_t deadline;
+    uint8_t started = 0;
+    int error;
+
+    // Measurements run in hardware, completion is signalled by on_ranging_done
+    k_event_set(&ranging_done, 0);
+    for (uint8_t i = 0; i < RANGING_SENSOR_COUNT; i++)
+    {
+        if (!(mask & BIT(i)))
+        {
+            continue;
+        }
+        stats_inc(STATS_SAMPLES);
+        mm[i] = HC_SR04_FAULT_MM;
+        error = sensor_sample_fetch(ranging_sensors[i]);
+        if (error)
+        {
+            LOG_DBG("Error %d: failed to start ranging on %s", error, ranging_sensors[i]->name);
+            stats_inc(STATS_ECHO_TIMEOUTS);
+            continue;
+        }
+        started |= BIT(i);
+    }
+
+    // The sensors measure in parallel, so the slot takes as long as the slowest one. That
+    // is well past the ranging deadline if a sensor never answers
+    deadline = K_TIMEOUT_ABS_TICKS(k_uptime_ticks() + k_us_to_ticks_ceil64(HC_SR04_CYCLE_MAX_US));
+    for (uint8_t i = 0; i < RANGING_SENSOR_COUNT; i++)
+    {
+        if (!(started & BIT(i)))
+        {
+            continue;
+        }
+        if (!(k_event_wait(&ranging_done, BIT(i), false, deadline) & BIT(i)))
+        {
+            stats_inc(STATS_ECHO_TIMEOUTS);
+            continue;
+        }
+        error = sensor_channel_get(ranging_sensors[i], SENSOR_CHAN_DISTANCE, &val);
+        if (error == -ENODATA)
+        {
+            mm[i] = HC_SR04_NO_RETURN_MM;
+            stats_inc(STATS_NO_RETURNS);
+            continue;
+        }
+        if (error)
+        {
+            stats_inc(STATS_ECHO_TIMEOUTS);
+            continue;
+        }
+        mm[i] = MIN(hc_sr04_value_to_mm(&val), HC_SR04_RANGE_MAX_MM);
+    }
+} /* measure_distances */
 
 static void config_dk_leds(void)
 {
@@ -225,133 +328,364 @@ static void config_dk_leds(void)
 
 } /* config_dk_leds */
 
-static void i2c_init(void)
+static void config_ranging(void)
 {
-    oled_dev = DEVICE_DT_GET(DT_NODELABEL(ssd1306));
-    if(!device_is_ready(oled_dev)) 
+    const struct sensor_trigger ranging_trig = {
+        .type = SENSOR_TRIG_DATA_READY,
+        .chan = SENSOR_CHAN_DISTANCE,
+    };
+    const struct sensor_value ranging_gate = {
+        .val1 = RADAR_RANGE_MM / 1000,
+        .val2 = (RADAR_RANGE_MM % 1000) * 1000,
+    };
+    struct ranging_sched_sensor sched_sensors[RANGING_SENSOR_COUNT];
+    const struct device *dev;
+    int error;
+
+    for (uint8_t i = 0; i < RANGING_SENSOR_COUNT; i++)
     {
-		LOG_ERR("SSD1306 display device not ready!\n");
-	}
-} /* i2c_init */
+        // The swept sensor goes first, so it gets the first slot
+        if (ranging_sensors[i] == ultrasonic_f)
+        {
+            ranging_sensors[i] = ranging_sensors[RANGING_SWEPT];
+            ranging_sensors[RANGING_SWEPT] = ultrasonic_f;
+        }
+    }
+    for (uint8_t i = 0; i < RANGING_SENSOR_COUNT; i++)
+    {
+        dev = ranging_sensors[i];
+        ranging_bearing_deg[i] = hc_sr04_mount_angle_get(dev);
+        atomic_set(&fixed_mm[i], HC_SR04_FAULT_MM);
+        sched_sensors[i].bearing_deg = ranging_bearing_deg[i];
+        sched_sensors[i].spread_deg = (i == RANGING_SWEPT) ? RADAR_FOV_DEG / 2 : 0;
+        if (!device_is_ready(dev))
+        {
+            LOG_ERR("Error: ultrasonic sensor %s is not ready", dev->name);
+            continue;
+        }
+        sensor_trigger_set(dev, &ranging_trig, on_ranging_done);
+        sensor_attr_set(dev, SENSOR_CHAN_DISTANCE, HC_SR04_ATTR_MAX_RANGE, &ranging_gate);
+    }
+
+    error = ranging_sched_init(&ranging_sched, sched_sensors, RANGING_SENSOR_COUNT, RANGING_SEPARATION_DEG);
+    if (error)
+    {
+        LOG_ERR("Error %d: failed to schedule ultrasonic sensors", error);
+        return;
+    }
+    LOG_INF("%u ultrasonic sensors fired in %u slots", RANGING_SENSOR_COUNT, ranging_sched.slot_count);
+} /* config_ranging */
+
+static void ranging_run(void)
+{
+    uint16_t mm[RANGING_SENSOR_COUNT];
+    struct radar_sample sample;
+    struct safety_event intervention;
+    uint32_t timestamp_ms;
+    uint8_t mask = ranging_sched_next(&ranging_sched);
+
+    // Sweep stepping overran and the servo is still on the bin already sampled
+    if (atomic_get(&bin_sampled))
+    {
+        mask &= ~BIT(RANGING_SWEPT);
+    }
+    if (mask == 0)
+    {
+        return;
+    }
+
+    // Take sensor readings once the servo has stopped on the bin
+    if (mask & BIT(RANGING_SWEPT))
+    {
+        sweep_wait_settled(&scan);
+    }
+    measure_distances(mask, mm);
+    timestamp_ms = k_uptime_get_32();
+
+    // Fixed sensors only feed obstacle avoidance and the ranges notification
+    for (uint8_t i = 0; i < RANGING_SENSOR_COUNT; i++)
+    {
+        if (i == RANGING_SWEPT || !(mask & BIT(i)))
+        {
+            continue;
+        }
+        LOG_DBG("Distance: %u mm, Bearing: %d deg", mm[i], ranging_bearing_deg[i]);
+        atomic_set(&fixed_mm[i], mm[i]);
+        if (safety_sensor_update(i, ranging_bearing_deg[i], mm[i], timestamp_ms, &intervention))
+        {
+            remote_safety_notify(intervention.action, intervention.bin, intervention.limit,
+                                 intervention.range_mm, intervention.closure_mm_s);
+        }
+    }
+
+    // The sweep only steps after a sample from the swept sensor
+    if (!(mask & BIT(RANGING_SWEPT)))
+    {
+        return;
+    }
+    sample.mm = mm[RANGING_SWEPT];
+    sample.bin = sweep_bin(&scan);
+    sample.timestamp_ms = timestamp_ms;
+    if (sample.bin == 0 || sample.bin == RADAR_SCAN_BINS - 1)
+    {
+        sweep_end_cycles = ranging_done_cycles;
+    }
+    atomic_set(&bin_sampled, 1);
+
+    // Obstacle avoidance acts on the raw sample before anything else, faults included
+    if (safety_range_update(sample.bin, sample.mm, sample.timestamp_ms, &intervention))
+    {
+        remote_safety_notify(intervention.action, intervention.bin, intervention.limit,
+                             intervention.range_mm, intervention.closure_mm_s);
+    }
 
-static void oled_init(void)
+    // A fault says nothing about the bin, so the grid and filter keep what they had
+    LOG_DBG("Distance: %u mm, Position: %u", sample.mm, sample.bin);
+    if (sample.mm == HC_SR04_FAULT_MM)
+    {
+        return;
+    }
+    if (radar_bx_submit(&sample) != 0)
+    {
+        LOG_DBG("Radar behaviour queue full, sample dropped");
+    }
+} /* ranging_run */
+
+// Send the latest distance of every fixed sensor, once per sweep alongside the radar frame
+static void send_fixed_ranges(void)
 {
-    // Create draw buffer
-	static lv_disp_draw_buf_t draw_buf;
-	static lv_color_t buf1[MY_DISP_HOR_RES * MY_DISP_VER_RES];
-	lv_disp_draw_buf_init(&draw_buf, buf1, NULL, MY_DISP_VER_RES * MY_DISP_VER_RES);
-
-    // Create text label
-    lv_obj_t *hello_label;
-    hello_label = lv_label_create(lv_scr_act());
-	lv_label_set_text(hello_label, "Battery Voltage:");
-	lv_obj_align(hello_label, LV_ALIGN_CENTER, 0, 24);
-
-    // Create voltage label
-    lv_obj_t *voltage_label;
-    voltage_label = lv_label_create(lv_scr_act());
-    char fake_voltage_status[] = "4148 mV";
-    lv_label_set_text(voltage_label, fake_voltage_status);
-    lv_obj_align(voltage_label, "LV_ALIGN_BOTTOM_MID", 32, 0);
-
-    display_blanking_off(oled_dev);
-    lv_task_handler();
-
-} /* oled_init */
-
-void ultrasonic_thread(void)
+    int16_t bearing_deg[RANGING_SENSOR_COUNT];
+    uint16_t mm[RANGING_SENSOR_COUNT];
+    uint8_t count = 0;
+    int error;
+
+    for (uint8_t i = 0; i < RANGING_SENSOR_COUNT; i++)
+    {
+        if (i == RANGING_SWEPT)
+        {
+            continue;
+        }
+        bearing_deg[count] = ranging_bearing_deg[i];
+        mm[count] = (uint16_t)atomic_get(&fixed_mm[i]);
+        count++;
+    }
+    if (count == 0)
+    {
+        return;
+    }
+    error = remote_ranges_notify(bearing_deg, mm, count);
+    if (0 != error)
+    {
+        LOG_DBG("Error %d: failed to send fixed sensor ranges", error);
+    }
+} /* send_fixed_ranges */
+
+static void sweep_run(void)
+{
+    bool sweep_done;
+    int error;
+
+    // Never move the servo under a measurement which overran
+    if (!atomic_get(&bin_sampled))
+    {
+        return;
+    }
+
+    error = sweep_advance(&scan, &sweep_done);
+    if (error < 0)
+    {
+        LOG_ERR("Error %d: failed to set pulse width of front motor", error);
+    }
+    atomic_clear(&bin_sampled);
+} /* sweep_run */
+
+static void radar_run(void)
 {
-    uint32_t dist_mm; 
-    int16_t motor_err;
-    int radar_err;
-    uint32_t motor_f_pwm_ns = PWM_USEC(1500);
-    bool b_dir = 0;
-    uint32_t scan_position = 0;
-    uint32_t prev_scan_position = 0;
-    uint8_t dist_display= 0;
-    uint8_t dist_mm_str[8 + 1] = {'&'};  // 8 digits for distance plus null char
-    
+    struct radar_sample sample;
+    int error;
+
     for (;;)
     {
-        if (NULL != current_conn)
-        {               
-            // Move proximity sensor to next position
-            motor_err = pwm_set_pulse_dt(&motor_f, motor_f_pwm_ns);
-            if (motor_err < 0) 
-            {
-                LOG_ERR("Error %d: failed to set pulse width of front motor", motor_err);
-                return;
-            }
-            LOG_DBG("Front motor set to %u us", motor_f_pwm_ns/1000);
-
-            // Take sensor reading
-            dist_mm = sense_distance();
-		    
-            // Map servo position to 1-8 value, invert so scan_position [0] is left, [19] is right
-            scan_position = 19 - map(motor_f_pwm_ns, MIN_PULSE_F, MAX_PULSE_F, 0, 19);
-            LOG_DBG("PWM: %u   Scan: %u", motor_f_pwm_ns/1000, scan_position);              // Motor PWM (1,000,000 to 2,000,000)
-            
-            if (scan_position != prev_scan_position)
-            {
-                // Process and transmit to NUS
-                LOG_INF("Distance: %u mm, Position: %u", dist_mm, scan_position);
-                LOG_DBG("PWM: %u   Scan: %u", motor_f_pwm_ns/1000, scan_position);
-                snprintf(dist_mm_str, sizeof(dist_mm_str), "%u&%d&&&&&&", scan_position, dist_mm);
-                radar_err = bt_nus_send(NULL, dist_mm_str, sizeof(dist_mm_str));
-                if(0 != radar_err)
-			    {
-                    LOG_ERR("Error %d: NUS failed to send data. Check that notfications are enabled.", radar_err);
-		        }
-                else
-                {
-                    LOG_DBG("Transmitted string: %s", dist_mm_str);
-                }
-            }
-            prev_scan_position = scan_position;
-   
-            // Update servo position values        // TODO: Tidy this up
-            if (b_dir == 0)
-            {
-                if (motor_f_pwm_ns <= MIN_PULSE_F) 
-                {
-            		motor_f_pwm_ns = MIN_PULSE_F;
-                    b_dir = 1;
-            	} 
-                else
-                {
-				    motor_f_pwm_ns -= PWM_USEC(10);                 // 30 is a nice speed
-		 	    }
-            } 
-            else
-            {
-            	motor_f_pwm_ns = motor_f_pwm_ns + PWM_USEC(10);     // 30 is a nice speed
-            	if (motor_f_pwm_ns >= MAX_PULSE_F) 
-                {
-            		motor_f_pwm_ns = MAX_PULSE_F;
-                    b_dir = 0;
-            	}
-            }
+        error = radar_bx_process(&sample);
+        if (error == -EAGAIN)
+        {
+            break;
+        }
+        if (error != 0)
+        {
+            continue;
+        }
+        radar_filter_update(&filter, sample.bin, sample.mm);
 
+        // Transmit the whole sweep as one radar frame each time the servo reverses
+        if (sample.bin != 0 && sample.bin != RADAR_SCAN_BINS - 1)
+        {
+            continue;
         }
-        k_sleep(K_MSEC(20));    // 40 ms is a proven value
+        stats_sweep_done();
+        oled_radar_set(filter.mm, RADAR_SCAN_BINS);
+        // Queued only, a frame still going out is caught up on the next sweep
+        dot_matrix_show_radar(filter.mm, RADAR_SCAN_BINS);
+        dot_matrix_flush(NULL);
+        error = remote_radar_send_sweep(filter.mm, filter.confidence, RADAR_SCAN_BINS);
+        if (0 != error)
+        {
+            LOG_DBG("Error %d: failed to send radar frame. Check that notifications are enabled.", error);
+        }
+        else
+        {
+            stats_hist_record(STATS_HIST_ECHO_TO_NOTIFY, k_cyc_to_us_floor32(k_cycle_get_32() - sweep_end_cycles));
+        }
+        send_fixed_ranges();
     }
-}
+} /* radar_run */
+
+static void display_run(void)
+{
+    oled_refresh();
+} /* display_run */
+
+static void telemetry_run(void)
+{
+    static bool run_led;
+
+    run_led = !run_led;
+    dk_set_led(RUN_STATUS_LED, run_led);
+    remote_stats_notify();
+    report_overruns();
+} /* telemetry_run */
+
+// Log each task which missed a deadline or skipped a release since the last report
+static void report_overruns(void)
+{
+    static uint32_t reported[PERIODIC_TASK_MAX];
+    struct periodic_task_stats task_stats;
+    struct periodic_task *task;
+    uint32_t overruns;
+
+    for (uint8_t i = 0; i < periodic_task_count(); i++)
+    {
+        task = periodic_task_get(i);
+        if (task == NULL)
+        {
+            continue;
+        }
+        periodic_task_stats_get(task, &task_stats);
+        overruns = task_stats.deadline_misses + task_stats.skipped;
+        if (overruns != reported[i])
+        {
+            LOG_WRN("Task %s: %u deadlines missed, %u releases skipped, jitter max %u us, exec max %u us",
+                    task->name, task_stats.deadline_misses, task_stats.skipped,
+                    task_stats.jitter_max_us, task_stats.exec_max_us);
+            reported[i] = overruns;
+        }
+    }
+} /* report_overruns */
+
+static void link_active(void)
+{
+    int error;
+
+    LOG_INF("Link up, leaving idle");
+    oled_link_set(true);
+
+    // Ranging only runs while there is someone to send the radar to
+    if (scan_ready)
+    {
+        error = sweep_resume(&scan);
+        if (error < 0)
+        {
+            LOG_ERR("Error %d: failed to set pulse width of front motor", error);
+        }
+        periodic_task_start(&ranging_task);
+        periodic_task_start(&sweep_task);
+    }
+    periodic_task_start(&radar_task);
+    periodic_task_start(&display_task);
+    periodic_task_start(&telemetry_task);
+} /* link_active */
+
+static void link_idle(void)
+{
+    LOG_INF("Link down, idling");
+    periodic_task_stop(&ranging_task);
+    periodic_task_stop(&sweep_task);
+    periodic_task_stop(&radar_task);
+    periodic_task_stop(&display_task);
+    periodic_task_stop(&telemetry_task);
+
+    // A run blocked part way may still be in progress, even in a task above this
+    // thread, and the state below belongs to the tasks until they are idle
+    periodic_task_wait_idle(&ranging_task);
+    periodic_task_wait_idle(&sweep_task);
+    periodic_task_wait_idle(&radar_task);
+    periodic_task_wait_idle(&display_task);
+    periodic_task_wait_idle(&telemetry_task);
+
+    // Ranging has stopped, so whatever limit it left is stale
+    safety_reset();
+
+    sweep_park(&scan);
+    dk_set_led_off(RUN_STATUS_LED);
+
+    // This thread draws in place of the radar task now. Blank the dot matrix
+    // rather than leave its LEDs lit. A frame still going out ends within a millisecond
+    for (uint8_t row = 0; row < DOT_MATRIX_ROWS; row++)
+    {
+        dot_matrix_row_set(row, 0);
+    }
+    while (dot_matrix_flush(NULL) == -EBUSY)
+    {
+        k_sleep(K_MSEC(1));
+    }
+
+    oled_link_set(false);
+    oled_refresh();
+} /* link_idle */
 
 void main(void)
 {
     int16_t error;
-    int16_t blink_status = 0;
 	LOG_INF("Hello World! %s\n", CONFIG_BOARD);
 
+    const struct sweep_config scan_cfg = {
+        .servo = &motor_f,
+        .min_pulse_ns = MIN_PULSE_F,
+        .max_pulse_ns = MAX_PULSE_F,
+        .bins = RADAR_SCAN_BINS,
+        .settle_base_us = RADAR_SETTLE_BASE_US,
+        .settle_per_bin_us = RADAR_SETTLE_PER_BIN_US,
+    };
+
+    stats_thread_watch(STATS_THREAD_RANGING, ranging_thread);
+    stats_thread_watch(STATS_THREAD_MAIN, k_current_get());
+
+    // Before any driver takes a reference on a suspendable controller
+    power_init();
     config_dk_leds();
-    error = ultrasonic_init(gpio_dev, ULTRASONIC_TRIG_PIN, ULTRASONIC_ECHO_PIN);
-	if (!error)
-	{
-		LOG_DBG("Ultrasonic sensor initialisation failed");
-	}
+    config_ranging();
 
-    i2c_init();
-    oled_init();
+    radar_bx_init();
+    radar_filter_init(&filter, RADAR_SCAN_BINS);
+    safety_init();
+    error = sweep_init(&scan, &scan_cfg);
+    if (error < 0)
+    {
+        LOG_ERR("Error %d: failed to initialise front motor sweep", error);
+    }
+    scan_ready = (error == 0);
+
+    error = oled_init(oled_dev);
+    if (error)
+    {
+        LOG_ERR("Error %d: failed to initialise SSD1306 display", error);
+    }
+    error = dot_matrix_init();
+    if (error)
+    {
+        LOG_ERR("Error %d: failed to initialise dot matrix", error);
+    }
+    battery_init(on_battery_changed);
 
     error = bluetooth_init(&bluetooth_callbacks, &remote_callbacks);
     if (error) 
@@ -359,24 +693,15 @@ void main(void)
         LOG_INF("Couldn't initialize Bluetooth. error %d", error);
     }
 
-    if (!device_is_ready(motors_l.dev))
-    {
-		LOG_ERR("Error: PWM device %s is not ready\n", motors_l.dev->name);
-		return;
-	}
-	if (!device_is_ready(motors_r.dev))
-    {
-		LOG_ERR("Error: PWM device %s is not ready\n", motors_r.dev->name);
-		return;
-	}
-
     LOG_INF("Running...");
-    for (;;) {
-        dk_set_led(RUN_STATUS_LED, (blink_status++)%2);
-        k_sleep(K_MSEC(RUN_LED_BLINK_INTERVAL));
-    }
 
+    // All periodic work is started and stopped here as the link comes and goes
+    k_thread_priority_set(k_current_get(), LINK_PRIORITY);
+    for (;;)
+    {
+        link_idle();
+        power_link_wait(true, K_FOREVER);
+        link_active();
+        power_link_wait(false, K_FOREVER);
+    }
 } /* main */
-
-// Threads
-K_THREAD_DEFINE(ultrasonic_thread_id, 1024, ultrasonic_thread, NULL, NULL, NULL, 4, 0, 0);
@@ -0,0 +1,410 @@
+/**
+ * @file motor.c
+ * @brief Source file for the drive motor control thread
+ */
+
+#include "motor.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/pm/device_runtime.h>
+#include <zephyr/logging/log.h>
+#include "stats.h"
+
+#define LOG_MODULE_NAME motor
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+#define QUEUE_MASK (MOTOR_QUEUE_LEN - 1)
+BUILD_ASSERT((MOTOR_QUEUE_LEN & QUEUE_MASK) == 0, "Motor queue length must be a power of two");
+BUILD_ASSERT(MOTOR_BATCH_MAX <= MOTOR_QUEUE_LEN, "A whole batch must fit in the motor queue");
+
+// Command flags
+#define CMD_FIRST   BIT(0)      // First setpoint of a command, replaces pending setpoints
+#define CMD_RAMP    BIT(1)      // Ramp to the setpoint rather than stepping
+
+struct motor_cmd {
+    int64_t submitted_ticks;
+    int64_t due_ticks;
+    int16_t left_us;
+    int16_t right_us;
+    uint8_t flags;
+};
+
+struct motor_state {
+    struct motor_cmd pending[MOTOR_BATCH_MAX];     // Setpoints of the current command not yet due
+    uint8_t pending_count;
+    uint8_t pending_next;
+    bool ramp;
+    int16_t target_l;
+    int16_t target_r;
+    int16_t output_l;           // Commanded output after ramping
+    int16_t output_r;
+    int16_t applied_l;          // Output after the forward limit, as set on the PWM
+    int16_t applied_r;
+    int64_t ramp_ticks;         // Time of the last ramp step
+    int64_t deadline_ticks;     // Watchdog deadline, 0 when stopped
+};
+
+static bool motor_init(void);
+static int queue_push(const struct motor_cmd *cmds, uint8_t count);
+static bool queue_pop(struct motor_cmd *cmd);
+static void drain_queue(struct motor_state *st, int64_t now);
+static void apply_due(struct motor_state *st, int64_t now);
+static int16_t ramp_towards(int16_t output, int16_t target, uint32_t max_step);
+static void limit_forward(int16_t *left_us, int16_t *right_us, uint16_t limit);
+static k_timeout_t next_event(const struct motor_state *st);
+static int motor_set(int16_t left_us, int16_t right_us);
+static void motor_park(void);
+static void motor_thread(void);
+
+K_SEM_DEFINE(cmd_ready, 0, MOTOR_QUEUE_LEN);
+
+static const struct pwm_dt_spec motors_l = PWM_DT_SPEC_GET(DT_NODELABEL(motors_l));
+static const struct pwm_dt_spec motors_r = PWM_DT_SPEC_GET(DT_NODELABEL(motors_r));
+
+// Command ring. head is only written by the producer and tail only by the consumer
+static struct motor_cmd queue[MOTOR_QUEUE_LEN];
+static atomic_t queue_head;
+static atomic_t queue_tail;
+
+// Forward speed limit set by the safety layer
+static atomic_t forward_limit = ATOMIC_INIT(MOTOR_FORWARD_LIMIT_NONE);
+
+// Owned by the motor thread. Parked motors get no pulses and hold no PWM reference
+static bool parked;
+
+static struct {
+    atomic_t commands;
+    atomic_t dropped;
+    atomic_t stale;
+    atomic_t superseded;
+    atomic_t watchdog_stops;
+    atomic_t latency_last_us;
+    atomic_t latency_max_us;
+} stats;
+
+static int queue_push(const struct motor_cmd *cmds, uint8_t count)
+{
+    atomic_val_t head = atomic_get(&queue_head);
+
+    if ((atomic_val_t)(head - atomic_get(&queue_tail)) > MOTOR_QUEUE_LEN - count)
+    {
+        atomic_inc(&stats.dropped);
+        return -ENOBUFS;
+    }
+    for (uint8_t i = 0; i < count; i++)
+    {
+        queue[(head + i) & QUEUE_MASK] = cmds[i];
+    }
+
+    // Publish the entries only once they are complete
+    atomic_set(&queue_head, head + count);
+    k_sem_give(&cmd_ready);
+
+    return 0;
+} /* queue_push */
+
+static bool queue_pop(struct motor_cmd *cmd)
+{
+    atomic_val_t tail = atomic_get(&queue_tail);
+
+    if (tail == atomic_get(&queue_head))
+    {
+        return false;
+    }
+    *cmd = queue[tail & QUEUE_MASK];
+    atomic_set(&queue_tail, tail + 1);
+
+    return true;
+} /* queue_pop */
+
+int motor_submit(int16_t left_us, int16_t right_us)
+{
+    struct motor_cmd cmd = {
+        .submitted_ticks = k_uptime_ticks(),
+        .left_us = CLAMP(left_us, -MOTOR_SPEED_MAX_US, MOTOR_SPEED_MAX_US),
+        .right_us = CLAMP(right_us, -MOTOR_SPEED_MAX_US, MOTOR_SPEED_MAX_US),
+        .flags = CMD_FIRST,
+    };
+
+    cmd.due_ticks = cmd.submitted_ticks;
+    return queue_push(&cmd, 1);
+} /* motor_submit */
+
+int motor_submit_ramped(const struct motor_setpoint *setpoints, uint8_t count)
+{
+    struct motor_cmd cmds[MOTOR_BATCH_MAX];
+    int64_t now = k_uptime_ticks();
+
+    if (count == 0 || count > MOTOR_BATCH_MAX)
+    {
+        return -EINVAL;
+    }
+    for (uint8_t i = 0; i < count; i++)
+    {
+        cmds[i].submitted_ticks = now;
+        cmds[i].due_ticks = now + k_ms_to_ticks_ceil64(setpoints[i].delay_ms);
+        cmds[i].left_us = CLAMP(setpoints[i].left_us, -MOTOR_SPEED_MAX_US, MOTOR_SPEED_MAX_US);
+        cmds[i].right_us = CLAMP(setpoints[i].right_us, -MOTOR_SPEED_MAX_US, MOTOR_SPEED_MAX_US);
+        cmds[i].flags = CMD_RAMP;
+    }
+    cmds[0].flags |= CMD_FIRST;
+
+    return queue_push(cmds, count);
+} /* motor_submit_ramped */
+
+void motor_forward_limit_set(uint16_t limit)
+{
+    limit = MIN(limit, MOTOR_FORWARD_LIMIT_NONE);
+    if (atomic_set(&forward_limit, limit) != limit)
+    {
+        k_sem_give(&cmd_ready);
+    }
+} /* motor_forward_limit_set */
+
+void motor_stats_get(struct motor_stats *out)
+{
+    out->commands = atomic_get(&stats.commands);
+    out->dropped = atomic_get(&stats.dropped);
+    out->stale = atomic_get(&stats.stale);
+    out->superseded = atomic_get(&stats.superseded);
+    out->watchdog_stops = atomic_get(&stats.watchdog_stops);
+    out->latency_last_us = atomic_get(&stats.latency_last_us);
+    out->latency_max_us = atomic_get(&stats.latency_max_us);
+} /* motor_stats_get */
+
+static int motor_set(int16_t left_us, int16_t right_us)
+{
+    int error;
+
+    if (parked)
+    {
+        pm_device_runtime_get(motors_l.dev);
+        pm_device_runtime_get(motors_r.dev);
+        parked = false;
+    }
+
+    error = pwm_set_pulse_dt(&motors_l, PWM_USEC(MOTOR_STOP_US + left_us));
+    if (error < 0)
+    {
+        LOG_ERR("Error %d: failed to set pulse width of left motors", error);
+        return error;
+    }
+    error = pwm_set_pulse_dt(&motors_r, PWM_USEC(MOTOR_STOP_US + right_us));
+    if (error < 0)
+    {
+        LOG_ERR("Error %d: failed to set pulse width of right motors", error);
+        return error;
+    }
+    LOG_DBG("Motors set to %d us, %d us", MOTOR_STOP_US + left_us, MOTOR_STOP_US + right_us);
+
+    return 0;
+} /* motor_set */
+
+static void motor_park(void)
+{
+    if (parked)
+    {
+        return;
+    }
+    // No pulses rather than the stop pulse, so the servos are not driven in their dead band
+    pwm_set_pulse_dt(&motors_l, 0);
+    pwm_set_pulse_dt(&motors_r, 0);
+    pm_device_runtime_put(motors_l.dev);
+    pm_device_runtime_put(motors_r.dev);
+    parked = true;
+    LOG_DBG("Motors parked");
+} /* motor_park */
+
+static bool motor_init(void)
+{
+    if (!device_is_ready(motors_l.dev))
+    {
+        LOG_ERR("Error: PWM device %s is not ready", motors_l.dev->name);
+        return false;
+    }
+    if (!device_is_ready(motors_r.dev))
+    {
+        LOG_ERR("Error: PWM device %s is not ready", motors_r.dev->name);
+        return false;
+    }
+
+    // Not pulsed until the first command
+    parked = true;
+
+    return true;
+} /* motor_init */
+
+// Move queued commands into the pending setpoints, newer commands replace older ones
+static void drain_queue(struct motor_state *st, int64_t now)
+{
+    const int64_t timeout_ticks = k_ms_to_ticks_ceil64(MOTOR_TIMEOUT_MS);
+    struct motor_cmd cmd;
+    uint32_t latency_us;
+
+    while (queue_pop(&cmd))
+    {
+        if (cmd.flags & CMD_FIRST)
+        {
+            atomic_add(&stats.superseded, st->pending_count - st->pending_next);
+            st->pending_count = 0;
+            st->pending_next = 0;
+
+            latency_us = k_ticks_to_us_ceil32(now - cmd.submitted_ticks);
+            atomic_set(&stats.latency_last_us, latency_us);
+            stats_hist_record(STATS_HIST_CMD_TO_PWM, latency_us);
+            if (latency_us > (uint32_t)atomic_get(&stats.latency_max_us))
+            {
+                atomic_set(&stats.latency_max_us, latency_us);
+            }
+            atomic_inc(&stats.commands);
+        }
+        if (now - cmd.due_ticks >= timeout_ticks)
+        {
+            atomic_inc(&stats.stale);
+            continue;
+        }
+        if (st->pending_count < MOTOR_BATCH_MAX)
+        {
+            st->pending[st->pending_count++] = cmd;
+        }
+
+        // Keep running until the last setpoint of the command has timed out
+        if (cmd.flags & CMD_FIRST)
+        {
+            st->deadline_ticks = cmd.due_ticks + timeout_ticks;
+        }
+        else
+        {
+            st->deadline_ticks = MAX(st->deadline_ticks, cmd.due_ticks + timeout_ticks);
+        }
+    }
+} /* drain_queue */
+
+// Make due setpoints the motor target
+static void apply_due(struct motor_state *st, int64_t now)
+{
+    const struct motor_cmd *cmd;
+    bool settled = (st->output_l == st->target_l) && (st->output_r == st->target_r);
+
+    while (st->pending_next < st->pending_count && st->pending[st->pending_next].due_ticks <= now)
+    {
+        cmd = &st->pending[st->pending_next++];
+        st->target_l = cmd->left_us;
+        st->target_r = cmd->right_us;
+        st->ramp = (cmd->flags & CMD_RAMP) != 0;
+    }
+
+    // Take the first ramp step straight away when starting from rest
+    if (settled)
+    {
+        st->ramp_ticks = now - k_ms_to_ticks_ceil64(MOTOR_RAMP_PERIOD_MS);
+    }
+} /* apply_due */
+
+static int16_t ramp_towards(int16_t output, int16_t target, uint32_t max_step)
+{
+    if ((uint32_t)abs(target - output) <= max_step)
+    {
+        return target;
+    }
+    return (target > output) ? output + max_step : output - max_step;
+} /* ramp_towards */
+
+// Scale down the forward part of the drive, leaving turning and reversing alone
+static void limit_forward(int16_t *left_us, int16_t *right_us, uint16_t limit)
+{
+    int32_t forward = (*left_us + *right_us) / 2;
+    int32_t cut;
+
+    if (forward <= 0 || limit >= MOTOR_FORWARD_LIMIT_NONE)
+    {
+        return;
+    }
+    cut = forward - (forward * limit) / MOTOR_FORWARD_LIMIT_NONE;
+    *left_us -= cut;
+    *right_us -= cut;
+} /* limit_forward */
+
+static k_timeout_t next_event(const struct motor_state *st)
+{
+    int64_t next = INT64_MAX;
+
+    if (st->deadline_ticks != 0)
+    {
+        next = st->deadline_ticks;
+    }
+    if (st->pending_next < st->pending_count)
+    {
+        next = MIN(next, st->pending[st->pending_next].due_ticks);
+    }
+    if (st->output_l != st->target_l || st->output_r != st->target_r)
+    {
+        next = MIN(next, st->ramp_ticks + k_ms_to_ticks_ceil64(MOTOR_RAMP_PERIOD_MS));
+    }
+
+    return (next == INT64_MAX) ? K_FOREVER : K_TIMEOUT_ABS_TICKS(next);
+} /* next_event */
+
+static void motor_thread(void)
+{
+    const int64_t period_ticks = k_ms_to_ticks_ceil64(MOTOR_RAMP_PERIOD_MS);
+    struct motor_state st = {0};
+    int16_t applied_l;
+    int16_t applied_r;
+    int64_t now;
+    int64_t steps;
+
+    if (!motor_init())
+    {
+        return;
+    }
+
+    for (;;)
+    {
+        k_sem_take(&cmd_ready, next_event(&st));
+        now = k_uptime_ticks();
+
+        drain_queue(&st, now);
+        apply_due(&st, now);
+
+        if (st.deadline_ticks != 0 && now >= st.deadline_ticks)
+        {
+            // Stop at once rather than ramp down, the link may be gone
+            st = (struct motor_state){0};
+            motor_park();
+            atomic_inc(&stats.watchdog_stops);
+            stats_inc(STATS_WATCHDOG_STOPS);
+            LOG_INF("Motors turned off");
+            continue;
+        }
+
+        if (!st.ramp)
+        {
+            st.output_l = st.target_l;
+            st.output_r = st.target_r;
+        }
+        else
+        {
+            steps = (now - st.ramp_ticks) / period_ticks;
+            st.ramp_ticks += steps * period_ticks;
+            st.output_l = ramp_towards(st.output_l, st.target_l, MIN(steps * MOTOR_RAMP_STEP_US, UINT16_MAX));
+            st.output_r = ramp_towards(st.output_r, st.target_r, MIN(steps * MOTOR_RAMP_STEP_US, UINT16_MAX));
+        }
+
+        // The limit is applied after ramping so a veto takes effect at once
+        applied_l = st.output_l;
+        applied_r = st.output_r;
+        limit_forward(&applied_l, &applied_r, atomic_get(&forward_limit));
+        if (applied_l != st.applied_l || applied_r != st.applied_r)
+        {
+            st.applied_l = applied_l;
+            st.applied_r = applied_r;
+            motor_set(applied_l, applied_r);
+        }
+    }
+} /* motor_thread */
+
+// Pre-empts everything but the Bluetooth stack so motor latency does not depend on ranging or display work
+K_THREAD_DEFINE(motor_thread_id, 1024, motor_thread, NULL, NULL, NULL, 2, 0, 0);
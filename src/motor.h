@@ -0,0 +1,105 @@
+/**
+ * @file motor.h
+ * @brief Header file for the drive motor control thread
+ *
+ * Motor commands are timestamped and pushed onto a single-producer,
+ * single-consumer lock-free ring by the Bluetooth RX path, which returns
+ * straight away. A high priority motor thread drains the ring, sets the
+ * motor PWM and runs the command watchdog: if no new command arrives before
+ * the deadline of the last one, the motors are stopped.
+ *
+ * Ramped commands are batches of time-tagged setpoints. Each setpoint becomes
+ * the motor target at its due time, and the PWM output moves towards the
+ * target at no more than MOTOR_RAMP_STEP_US every MOTOR_RAMP_PERIOD_MS. A new
+ * batch replaces any setpoints of the previous one which are not yet due.
+ * The watchdog deadline runs from the last setpoint of the batch.
+ *
+ * A forward speed limit can be imposed independently of the commands, for
+ * example by the obstacle avoidance layer. It scales down the forward part of
+ * the output without ramping, and leaves turning and reversing alone.
+ */
+
+#ifndef MOTOR_H
+#define MOTOR_H
+
+#include <stdint.h>
+#include <zephyr/drivers/pwm.h>
+
+#define MOTOR_QUEUE_LEN         16      // Power of two
+#define MOTOR_BATCH_MAX         8       // Setpoints per ramped command
+#define MOTOR_TIMEOUT_MS        120     // Motors are stopped if no command arrives within this time
+
+/* Motor PWM->Speed Reference:
+    Max foward = 2000 us
+    Max reverse = 1000 us
+    Stop = 1500 us. Dead band [1480-1520] us
+*/
+#define MOTOR_STOP_US           1500
+#define MOTOR_SPEED_MAX_US      500
+
+#define MOTOR_RAMP_PERIOD_MS    5
+#define MOTOR_RAMP_STEP_US      20      // Stop to full speed in 125 ms
+
+#define MOTOR_FORWARD_LIMIT_NONE    1000    // Forward limit in per mille of commanded speed
+
+struct motor_setpoint {
+    uint16_t delay_ms;          // Time after submission at which the setpoint applies
+    int16_t left_us;            // Offset from MOTOR_STOP_US, positive is forwards
+    int16_t right_us;
+};
+
+struct motor_stats {
+    uint32_t commands;          // Commands applied
+    uint32_t dropped;           // Commands lost because the queue was full
+    uint32_t stale;             // Commands discarded because they were older than the timeout
+    uint32_t superseded;        // Setpoints replaced by a newer command before they were due
+    uint32_t watchdog_stops;    // Times the watchdog stopped the motors
+    uint32_t latency_last_us;   // Time from submit to the motor thread taking up the last command
+    uint32_t latency_max_us;
+};
+
+/**
+ * @brief Queue a motor command.
+ *
+ * Does not block and does not call into the PWM driver. Only one context may
+ * submit commands.
+ *
+ * @param left_us Left motor speed as an offset from MOTOR_STOP_US, positive is forwards.
+ * @param right_us Right motor speed as an offset from MOTOR_STOP_US, positive is forwards.
+ * @retval 0 if successful.
+ * @retval -ENOBUFS if the queue is full and the command was dropped.
+ */
+int motor_submit(int16_t left_us, int16_t right_us);
+
+/**
+ * @brief Queue a batch of ramped setpoints.
+ *
+ * Does not block and does not call into the PWM driver. Only one context may
+ * submit commands.
+ *
+ * @param setpoints Setpoints in order of non-decreasing delay.
+ * @param count Number of setpoints. Max MOTOR_BATCH_MAX.
+ * @retval 0 if successful.
+ * @retval -EINVAL if the batch is empty or too long.
+ * @retval -ENOBUFS if the queue is full and the command was dropped.
+ */
+int motor_submit_ramped(const struct motor_setpoint *setpoints, uint8_t count);
+
+/**
+ * @brief Limit forward motion.
+ *
+ * Takes effect immediately, including on the command already running.
+ *
+ * @param limit Fraction of the commanded forward speed allowed, per mille.
+ *              0 vetoes forward motion, MOTOR_FORWARD_LIMIT_NONE lifts the limit.
+ */
+void motor_forward_limit_set(uint16_t limit);
+
+/**
+ * @brief Get motor control statistics.
+ *
+ * @param[out] stats Statistics.
+ */
+void motor_stats_get(struct motor_stats *stats);
+
+#endif /* MOTOR_H */
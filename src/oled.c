@@ -0,0 +1,349 @@
+/**
+ * @file oled.c
+ * @brief Source file for the status display
+ *
+ * The left half of the panel holds text lines on even pages, so glyphs are
+ * copied straight into a page without shifting. The right half is a mini
+ * radar with the sensor at the bottom centre and one dot per bin.
+ */
+
+#include "oled.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/drivers/display.h>
+#include <zephyr/pm/device_runtime.h>
+#include <zephyr/logging/log.h>
+#include "radar_bx.h"
+
+#define LOG_MODULE_NAME oled
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+BUILD_ASSERT((OLED_HEIGHT % 8) == 0, "Panel height must be a whole number of pages");
+
+// 5x7 glyphs from ' ' to 'Z', one byte per column, bit 0 at the top
+#define FONT_FIRST              ' '
+#define FONT_LAST               'Z'
+#define FONT_WIDTH              5
+#define FONT_ADVANCE            (FONT_WIDTH + 1)
+
+#define TEXT_COLUMNS            (OLED_WIDTH / 2)
+#define TEXT_CHARS              (TEXT_COLUMNS / FONT_ADVANCE)
+
+#define RADAR_LEFT              (OLED_WIDTH / 2)
+#define RADAR_ORIGIN_X          (RADAR_LEFT + (OLED_WIDTH - RADAR_LEFT) / 2)
+#define RADAR_ORIGIN_Y          (OLED_HEIGHT - 1)
+// Largest radius which keeps the 45 degree edges of the scan on the panel
+#define RADAR_RADIUS            MIN(OLED_HEIGHT - 2, ((OLED_WIDTH - RADAR_LEFT) / 2 - 2) * 10 / 7)
+
+static const uint8_t font[FONT_LAST - FONT_FIRST + 1][FONT_WIDTH] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+    {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+    {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00},
+    {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x08, 0x2A, 0x1C, 0x2A, 0x08}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+    {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00},
+    {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+    {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31}, {0x18, 0x14, 0x12, 0x7F, 0x10},
+    {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00},
+    {0x00, 0x56, 0x36, 0x00, 0x00}, {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14},
+    {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06}, {0x32, 0x49, 0x79, 0x41, 0x3E},
+    {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+    {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x01, 0x01},
+    {0x3E, 0x41, 0x41, 0x51, 0x32}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40},
+    {0x7F, 0x02, 0x04, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46},
+    {0x46, 0x49, 0x49, 0x49, 0x31}, {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x7F, 0x20, 0x18, 0x20, 0x7F}, {0x63, 0x14, 0x08, 0x14, 0x63},
+    {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x51, 0x49, 0x45, 0x43},
+};
+
+struct oled_model {
+    bool connected;
+    uint16_t battery_mv;
+    uint16_t radar_mm[RADAR_SCAN_BINS];
+};
+
+static void draw_text(uint8_t page, const char *text);
+static void draw_pixel(int x, int y);
+static void draw_dot(int x, int y);
+static void draw_radar(const uint16_t *radar_mm);
+static void render(const struct oled_model *m);
+static int write_page_span(uint8_t page, uint8_t first, uint8_t last);
+static void bus_get(void);
+static void bus_put(void);
+
+static const struct device *oled_dev;
+
+#if defined(CONFIG_PM_DEVICE_RUNTIME)
+// Suspended between refreshes
+static const struct device *const oled_bus = DEVICE_DT_GET(DT_BUS(DT_NODELABEL(ssd1306)));
+#endif
+
+// Set from any thread, guarded by model_lock
+static struct k_spinlock model_lock;
+static struct oled_model model;
+static atomic_t changed;
+
+// Guarded by refresh_lock
+static K_MUTEX_DEFINE(refresh_lock);
+static uint8_t frame[OLED_PAGES][OLED_WIDTH];
+static uint8_t shown[OLED_PAGES][OLED_WIDTH];
+
+int oled_init(const struct device *dev)
+{
+    struct display_capabilities caps;
+    int error = 0;
+
+    if (!device_is_ready(dev))
+    {
+        return -ENODEV;
+    }
+    oled_dev = dev;
+
+    display_get_capabilities(dev, &caps);
+    if (!(caps.screen_info & SCREEN_INFO_MONO_VTILED))
+    {
+        LOG_WRN("%s is not a page tiled monochrome panel", dev->name);
+    }
+
+    for (uint16_t i = 0; i < RADAR_SCAN_BINS; i++)
+    {
+        model.radar_mm[i] = UINT16_MAX;
+    }
+
+    // Panel RAM is undefined at power up, so the shadow starts true by clearing it all
+    memset(shown, 0xFF, sizeof(shown));
+    memset(frame, 0, sizeof(frame));
+    bus_get();
+    for (uint8_t page = 0; page < OLED_PAGES && !error; page++)
+    {
+        error = write_page_span(page, 0, OLED_WIDTH - 1);
+    }
+    error = error ? error : display_blanking_off(dev);
+    bus_put();
+
+    atomic_set(&changed, 1);
+    return error;
+} /* oled_init */
+
+void oled_link_set(bool connected)
+{
+    k_spinlock_key_t key = k_spin_lock(&model_lock);
+
+    model.connected = connected;
+    k_spin_unlock(&model_lock, key);
+    atomic_set(&changed, 1);
+} /* oled_link_set */
+
+void oled_battery_set(uint16_t mv)
+{
+    k_spinlock_key_t key = k_spin_lock(&model_lock);
+
+    model.battery_mv = mv;
+    k_spin_unlock(&model_lock, key);
+    atomic_set(&changed, 1);
+} /* oled_battery_set */
+
+void oled_radar_set(const uint16_t *bins_mm, uint8_t bin_count)
+{
+    k_spinlock_key_t key = k_spin_lock(&model_lock);
+
+    memcpy(model.radar_mm, bins_mm, MIN(bin_count, RADAR_SCAN_BINS) * sizeof(uint16_t));
+    k_spin_unlock(&model_lock, key);
+    atomic_set(&changed, 1);
+} /* oled_radar_set */
+
+static void draw_text(uint8_t page, const char *text)
+{
+    uint8_t *column = frame[page];
+    char c;
+
+    for (uint8_t i = 0; i < TEXT_CHARS && text[i] != '\0'; i++)
+    {
+        c = text[i];
+        if (c >= 'a' && c <= 'z')
+        {
+            c -= 'a' - 'A';
+        }
+        if (c < FONT_FIRST || c > FONT_LAST)
+        {
+            c = '?';
+        }
+        memcpy(column, font[c - FONT_FIRST], FONT_WIDTH);
+        column += FONT_ADVANCE;
+    }
+} /* draw_text */
+
+// Clipped to the radar half of the panel
+static void draw_pixel(int x, int y)
+{
+    if (x >= RADAR_LEFT && x < OLED_WIDTH && y >= 0 && y < OLED_HEIGHT)
+    {
+        frame[y >> 3][x] |= BIT(y & 7);
+    }
+} /* draw_pixel */
+
+static void draw_dot(int x, int y)
+{
+    draw_pixel(x, y);
+    draw_pixel(x + 1, y);
+    draw_pixel(x, y - 1);
+    draw_pixel(x + 1, y - 1);
+} /* draw_dot */
+
+static void draw_radar(const uint16_t *radar_mm)
+{
+    int16_t sin_q15;
+    int16_t cos_q15;
+    int32_t r;
+
+    // Sensor position, and dotted lines along the outermost bins
+    draw_dot(RADAR_ORIGIN_X, RADAR_ORIGIN_Y);
+    for (uint8_t edge = 0; edge < 2; edge++)
+    {
+        radar_bx_bin_bearing(edge ? RADAR_SCAN_BINS - 1 : 0, &sin_q15, &cos_q15);
+        for (r = RADAR_RADIUS / 4; r <= RADAR_RADIUS; r += RADAR_RADIUS / 4)
+        {
+            draw_pixel(RADAR_ORIGIN_X - ((sin_q15 * r) >> 15), RADAR_ORIGIN_Y - ((cos_q15 * r) >> 15));
+        }
+    }
+
+    for (uint8_t bin = 0; bin < RADAR_SCAN_BINS; bin++)
+    {
+        if (radar_mm[bin] >= RADAR_RANGE_MM)
+        {
+            continue;
+        }
+        r = ((int32_t)radar_mm[bin] * RADAR_RADIUS) / RADAR_RANGE_MM;
+        radar_bx_bin_bearing(bin, &sin_q15, &cos_q15);
+        // Positive sine is left, so it moves the dot towards lower columns
+        draw_dot(RADAR_ORIGIN_X - ((sin_q15 * r) >> 15), RADAR_ORIGIN_Y - ((cos_q15 * r) >> 15));
+    }
+} /* draw_radar */
+
+static void render(const struct oled_model *m)
+{
+    char line[TEXT_CHARS + 1];
+    uint16_t nearest_mm = UINT16_MAX;
+
+    memset(frame, 0, sizeof(frame));
+
+    draw_text(0, m->connected ? "LINK UP" : "LINK DOWN");
+
+    if (m->battery_mv == OLED_BATTERY_UNKNOWN)
+    {
+        draw_text(2, "BAT --");
+    }
+    else
+    {
+        snprintf(line, sizeof(line), "BAT %u.%02uV", m->battery_mv / 1000, (m->battery_mv % 1000) / 10);
+        draw_text(2, line);
+    }
+
+    for (uint8_t bin = 0; bin < RADAR_SCAN_BINS; bin++)
+    {
+        nearest_mm = MIN(nearest_mm, m->radar_mm[bin]);
+    }
+    if (nearest_mm >= RADAR_RANGE_MM)
+    {
+        draw_text(4, "NEAR --");
+    }
+    else
+    {
+        snprintf(line, sizeof(line), "NEAR %uMM", nearest_mm);
+        draw_text(4, line);
+    }
+
+    draw_radar(m->radar_mm);
+} /* render */
+
+static void bus_get(void)
+{
+#if defined(CONFIG_PM_DEVICE_RUNTIME)
+    pm_device_runtime_get(oled_bus);
+#endif
+} /* bus_get */
+
+static void bus_put(void)
+{
+#if defined(CONFIG_PM_DEVICE_RUNTIME)
+    pm_device_runtime_put(oled_bus);
+#endif
+} /* bus_put */
+
+static int write_page_span(uint8_t page, uint8_t first, uint8_t last)
+{
+    const struct display_buffer_descriptor desc = {
+        .buf_size = last - first + 1,
+        .width = last - first + 1,
+        .height = 8,
+        .pitch = last - first + 1,
+    };
+    int error;
+
+    // The panel's column and page addressing takes any page aligned rectangle
+    error = display_write(oled_dev, first, page * 8, &desc, &frame[page][first]);
+    if (error)
+    {
+        LOG_DBG("Error %d: failed to write page %u", error, page);
+        return error;
+    }
+    memcpy(&shown[page][first], &frame[page][first], desc.width);
+
+    return 0;
+} /* write_page_span */
+
+void oled_refresh(void)
+{
+    struct oled_model m;
+    k_spinlock_key_t key;
+    bool bus_held = false;
+    int first;
+    int last;
+
+    if (oled_dev == NULL || !atomic_cas(&changed, 1, 0))
+    {
+        return;
+    }
+
+    k_mutex_lock(&refresh_lock, K_FOREVER);
+    key = k_spin_lock(&model_lock);
+    m = model;
+    k_spin_unlock(&model_lock, key);
+
+    render(&m);
+
+    for (uint8_t page = 0; page < OLED_PAGES; page++)
+    {
+        for (first = 0; first < OLED_WIDTH && frame[page][first] == shown[page][first]; first++)
+        {
+        }
+        if (first == OLED_WIDTH)
+        {
+            continue;
+        }
+        for (last = OLED_WIDTH - 1; frame[page][last] == shown[page][last]; last--)
+        {
+        }
+        if (!bus_held)
+        {
+            bus_get();
+            bus_held = true;
+        }
+        if (write_page_span(page, first, last) != 0)
+        {
+            // Try again on the next release
+            atomic_set(&changed, 1);
+        }
+    }
+    if (bus_held)
+    {
+        bus_put();
+    }
+    k_mutex_unlock(&refresh_lock);
+} /* oled_refresh */
@@ -0,0 +1,70 @@
+/**
+ * @file oled.h
+ * @brief Header file for the status display
+ *
+ * The SSD1306 is drawn into a 1 bit per pixel framebuffer in the panel's
+ * own page layout: 8 pages of OLED_WIDTH bytes, each byte a column of 8
+ * pixels with bit 0 at the top. A shadow copy holds what the panel shows,
+ * so a refresh only writes the span of columns that changed in each page.
+ *
+ * Values are set from any thread and only mark the display as changed. The
+ * display task redraws on its next release if anything changed, so an idle
+ * screen costs neither CPU nor I2C bus time, and the bus is only powered
+ * while a refresh writes to it.
+ */
+
+#ifndef OLED_H
+#define OLED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+
+#define OLED_WIDTH              DT_PROP(DT_NODELABEL(ssd1306), width)
+#define OLED_HEIGHT             DT_PROP(DT_NODELABEL(ssd1306), height)
+#define OLED_PAGES              (OLED_HEIGHT / 8)
+#define OLED_BATTERY_UNKNOWN    0
+
+/**
+ * @brief Initialise the display and clear the panel.
+ *
+ * @param dev SSD1306 display device.
+ * @retval 0 if successful.
+ * @retval -ENODEV if the device is not ready.
+ * @retval Negative error code from the display API otherwise.
+ */
+int oled_init(const struct device *dev);
+
+/**
+ * @brief Show the link state.
+ *
+ * @param connected True if a controller is connected.
+ */
+void oled_link_set(bool connected);
+
+/**
+ * @brief Show the battery voltage.
+ *
+ * @param mv Battery voltage in millivolts, or OLED_BATTERY_UNKNOWN.
+ */
+void oled_battery_set(uint16_t mv);
+
+/**
+ * @brief Show a radar sweep.
+ *
+ * @param bins_mm Distance of each bin in millimetres, bin 0 is left.
+ * @param bin_count Number of bins. Bins beyond RADAR_SCAN_BINS are ignored.
+ */
+void oled_radar_set(const uint16_t *bins_mm, uint8_t bin_count);
+
+/**
+ * @brief Redraw and write the changed parts of each page to the panel.
+ *
+ * Does nothing if no value changed since the last refresh. Refreshes from
+ * different threads are serialised, so the display can be refreshed outside
+ * the display task while that is stopped.
+ */
+void oled_refresh(void);
+
+#endif /* OLED_H */
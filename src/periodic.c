@@ -0,0 +1,149 @@
+/**
+ * @file periodic.c
+ * @brief Source file for the periodic task framework
+ */
+
+#include "periodic.h"
+#include <zephyr/logging/log.h>
+
+#define LOG_MODULE_NAME periodic
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+static struct periodic_task *tasks[PERIODIC_TASK_MAX];
+static atomic_t task_count;
+
+static void record_max(atomic_t *max, uint32_t value);
+
+// Timer expiry, runs in interrupt context
+void periodic_task_release(struct k_timer *timer)
+{
+    struct periodic_task *task = CONTAINER_OF(timer, struct periodic_task, timer);
+
+    if (!atomic_cas(&task->busy, 0, 1))
+    {
+        atomic_inc(&task->skipped);
+        return;
+    }
+    task->released_ticks = k_uptime_ticks();
+    k_sem_give(&task->release);
+} /* periodic_task_release */
+
+static void record_max(atomic_t *max, uint32_t value)
+{
+    // Only the task thread raises the maximum, a reset may race and be lost
+    if (value > (uint32_t)atomic_get(max))
+    {
+        atomic_set(max, value);
+    }
+} /* record_max */
+
+void periodic_task_run(void *p1, void *p2, void *p3)
+{
+    struct periodic_task *task = p1;
+    const int64_t deadline_ticks = k_ms_to_ticks_ceil64(task->deadline_ms);
+    int64_t released;
+    int64_t start;
+    int64_t end;
+    atomic_val_t index;
+
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    index = atomic_inc(&task_count);
+    if (index < PERIODIC_TASK_MAX)
+    {
+        tasks[index] = task;
+    }
+    else
+    {
+        LOG_WRN("Task %s not listed, raise PERIODIC_TASK_MAX", task->name);
+    }
+
+    for (;;)
+    {
+        k_sem_take(&task->release, K_FOREVER);
+        released = task->released_ticks;
+        start = k_uptime_ticks();
+
+        task->fn();
+
+        end = k_uptime_ticks();
+        atomic_clear(&task->busy);
+
+        task->jitter_last_us = k_ticks_to_us_floor32(start - released);
+        task->exec_last_us = k_ticks_to_us_floor32(end - start);
+        record_max(&task->jitter_max_us, task->jitter_last_us);
+        record_max(&task->exec_max_us, task->exec_last_us);
+        if (end - released > deadline_ticks)
+        {
+            atomic_inc(&task->deadline_misses);
+        }
+        atomic_inc(&task->runs);
+    }
+} /* periodic_task_run */
+
+void periodic_task_start(struct periodic_task *task)
+{
+    k_timer_start(&task->timer, K_MSEC(task->phase_ms), K_MSEC(task->period_ms));
+} /* periodic_task_start */
+
+void periodic_task_stop(struct periodic_task *task)
+{
+    k_timer_stop(&task->timer);
+
+    // A release still waiting for the thread will never run, so it must not keep the task busy
+    if (k_sem_take(&task->release, K_NO_WAIT) == 0)
+    {
+        atomic_clear(&task->busy);
+    }
+} /* periodic_task_stop */
+
+void periodic_task_wait_idle(struct periodic_task *task)
+{
+    // Once stopped, only a run in progress keeps the task busy
+    while (atomic_get(&task->busy))
+    {
+        k_sleep(K_MSEC(1));
+    }
+} /* periodic_task_wait_idle */
+
+void periodic_task_stats_get(struct periodic_task *task, struct periodic_task_stats *stats)
+{
+    stats->runs = atomic_get(&task->runs);
+    stats->deadline_misses = atomic_get(&task->deadline_misses);
+    stats->skipped = atomic_get(&task->skipped);
+    stats->jitter_last_us = task->jitter_last_us;
+    stats->jitter_max_us = atomic_get(&task->jitter_max_us);
+    stats->exec_last_us = task->exec_last_us;
+    stats->exec_max_us = atomic_get(&task->exec_max_us);
+} /* periodic_task_stats_get */
+
+void periodic_task_stats_reset(void)
+{
+    struct periodic_task *task;
+
+    for (uint8_t i = 0; i < periodic_task_count(); i++)
+    {
+        task = periodic_task_get(i);
+        if (task == NULL)
+        {
+            continue;
+        }
+        atomic_clear(&task->runs);
+        atomic_clear(&task->deadline_misses);
+        atomic_clear(&task->skipped);
+        atomic_clear(&task->jitter_max_us);
+        atomic_clear(&task->exec_max_us);
+    }
+} /* periodic_task_stats_reset */
+
+uint8_t periodic_task_count(void)
+{
+    return MIN((uint32_t)atomic_get(&task_count), PERIODIC_TASK_MAX);
+} /* periodic_task_count */
+
+struct periodic_task *periodic_task_get(uint8_t index)
+{
+    // The slot of a task thread which is just starting may still be empty
+    return (index < periodic_task_count()) ? tasks[index] : NULL;
+} /* periodic_task_get */
@@ -0,0 +1,148 @@
+/**
+ * @file periodic.h
+ * @brief Header file for the periodic task framework
+ *
+ * A periodic task is a thread released by a k_timer. Each task declares its
+ * period, its deadline relative to the release and its priority. Priorities
+ * are given in rate monotonic order, the shorter the period the higher the
+ * priority, so the fast ranging tasks are never held up by the slow ones.
+ *
+ * The timer handler timestamps every release. The task thread records how
+ * late each run started (release jitter), how long it ran and whether it
+ * finished after its deadline. A release which finds the previous run still
+ * going is skipped and counted, so an overrunning task sheds load instead of
+ * queueing up behind itself.
+ */
+
+#ifndef PERIODIC_H
+#define PERIODIC_H
+
+#include <stdint.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+
+#define PERIODIC_TASK_MAX       8
+
+struct periodic_task {
+    const char *name;
+    void (*fn)(void);
+    uint32_t period_ms;
+    uint32_t deadline_ms;       // Relative to the release, at most period_ms
+    uint32_t phase_ms;          // Delay of the first release after the task is started
+    struct k_timer timer;
+    struct k_sem release;
+    int64_t released_ticks;     // Written by the timer handler while busy is clear
+    atomic_t busy;              // Set on release, cleared at the end of the run
+    atomic_t runs;
+    atomic_t deadline_misses;
+    atomic_t skipped;
+    atomic_t jitter_max_us;
+    atomic_t exec_max_us;
+    uint32_t jitter_last_us;
+    uint32_t exec_last_us;
+};
+
+struct periodic_task_stats {
+    uint32_t runs;
+    uint32_t deadline_misses;   // Runs which finished after their deadline
+    uint32_t skipped;           // Releases dropped because the previous run had not finished
+    uint32_t jitter_last_us;    // Release to start of the run
+    uint32_t jitter_max_us;
+    uint32_t exec_last_us;      // Start to end of the run
+    uint32_t exec_max_us;
+};
+
+/**
+ * @brief Declare a periodic task and its thread.
+ *
+ * Defines struct periodic_task _name##_task and the thread _name##_thread.
+ * The task is idle until periodic_task_start() is called.
+ *
+ * @param _name Task name.
+ * @param _fn Function to run on each release, void fn(void).
+ * @param _period_ms Release period.
+ * @param _deadline_ms Deadline relative to the release.
+ * @param _phase_ms Delay of the first release after the task is started.
+ * @param _prio Thread priority.
+ * @param _stack_size Thread stack size.
+ */
+#define PERIODIC_TASK_DEFINE(_name, _fn, _period_ms, _deadline_ms, _phase_ms, _prio, _stack_size)   \
+    BUILD_ASSERT((_deadline_ms) > 0 && (_deadline_ms) <= (_period_ms),                             \
+                 "Deadline of " #_name " must be within its period");                               \
+    struct periodic_task _name##_task = {                                                           \
+        .name = #_name,                                                                             \
+        .fn = _fn,                                                                                  \
+        .period_ms = _period_ms,                                                                    \
+        .deadline_ms = _deadline_ms,                                                                \
+        .phase_ms = _phase_ms,                                                                      \
+        .timer = Z_TIMER_INITIALIZER(_name##_task.timer, periodic_task_release, NULL),              \
+        .release = Z_SEM_INITIALIZER(_name##_task.release, 0, 1),                                   \
+    };                                                                                              \
+    K_THREAD_DEFINE(_name##_thread, _stack_size, periodic_task_run, &_name##_task, NULL, NULL,      \
+                    _prio, 0, 0)
+
+/**
+ * @brief Start releasing a task.
+ *
+ * The first release comes after the phase of the task, then one every
+ * period. Safe from any context.
+ *
+ * @param task Task.
+ */
+void periodic_task_start(struct periodic_task *task);
+
+/**
+ * @brief Stop releasing a task.
+ *
+ * A run in progress is completed, a release not yet taken up is dropped.
+ * Safe from any context.
+ *
+ * @param task Task.
+ */
+void periodic_task_stop(struct periodic_task *task);
+
+/**
+ * @brief Wait for the run in progress of a stopped task to complete.
+ *
+ * A run may be in progress even in a task of higher priority than the
+ * caller, if it blocked part way. Once this returns the task function does
+ * not run again until the task is started. Call from a thread other than the
+ * task's own, after periodic_task_stop().
+ *
+ * @param task Task.
+ */
+void periodic_task_wait_idle(struct periodic_task *task);
+
+/**
+ * @brief Get timing statistics of a task.
+ *
+ * @param task Task.
+ * @param[out] stats Statistics.
+ */
+void periodic_task_stats_get(struct periodic_task *task, struct periodic_task_stats *stats);
+
+/**
+ * @brief Clear the timing statistics of all tasks.
+ */
+void periodic_task_stats_reset(void);
+
+/**
+ * @brief Get the number of tasks whose threads have started.
+ *
+ * @returns Number of tasks.
+ */
+uint8_t periodic_task_count(void);
+
+/**
+ * @brief Get a task by index.
+ *
+ * @param index Index, less than periodic_task_count().
+ * @returns Task, or NULL if the index is out of range.
+ */
+struct periodic_task *periodic_task_get(uint8_t index);
+
+/* Used by PERIODIC_TASK_DEFINE only */
+void periodic_task_release(struct k_timer *timer);
+void periodic_task_run(void *p1, void *p2, void *p3);
+
+#endif /* PERIODIC_H */
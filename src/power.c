@@ -0,0 +1,57 @@
+/**
+ * @file power.c
+ * @brief Source file for connection aware power management
+ */
+
+#include "power.h"
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/pm/device_runtime.h>
+#include <zephyr/logging/log.h>
+
+#define LOG_MODULE_NAME power
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+#if defined(CONFIG_PM_DEVICE_RUNTIME)
+// PWM of the servos, SPIM of the dot matrix and TWIM of the status display
+static const struct device *const idle_devices[] = {
+    DEVICE_DT_GET(DT_PWMS_CTLR(DT_NODELABEL(motors_l))),
+    DEVICE_DT_GET(DT_BUS(DT_NODELABEL(dot_matrix))),
+    DEVICE_DT_GET(DT_BUS(DT_NODELABEL(ssd1306))),
+};
+#endif
+
+// Exactly one of POWER_LINK_UP and POWER_LINK_DOWN is set once the state is first published
+static K_EVENT_DEFINE(link_event);
+
+void power_init(void)
+{
+#if defined(CONFIG_PM_DEVICE_RUNTIME)
+    int error;
+
+    for (size_t i = 0; i < ARRAY_SIZE(idle_devices); i++)
+    {
+        error = pm_device_runtime_enable(idle_devices[i]);
+        if (error)
+        {
+            LOG_WRN("Error %d: %s stays powered while idle", error, idle_devices[i]->name);
+        }
+    }
+#endif
+    power_link_set(false);
+} /* power_init */
+
+void power_link_set(bool connected)
+{
+    k_event_set(&link_event, connected ? POWER_LINK_UP : POWER_LINK_DOWN);
+} /* power_link_set */
+
+bool power_link_is_up(void)
+{
+    return k_event_wait(&link_event, POWER_LINK_UP, false, K_NO_WAIT) != 0;
+} /* power_link_is_up */
+
+bool power_link_wait(bool connected, k_timeout_t timeout)
+{
+    return k_event_wait(&link_event, connected ? POWER_LINK_UP : POWER_LINK_DOWN, false, timeout) != 0;
+} /* power_link_wait */
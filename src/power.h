@@ -0,0 +1,63 @@
+/**
+ * @file power.h
+ * @brief Header file for connection aware power management
+ *
+ * The robot only has work to do while a controller is connected. The link
+ * state is published as a kernel event, and threads which only run while
+ * connected block on it rather than polling the connection.
+ *
+ * While idle, the peripherals are suspended through device runtime PM.
+ * Each user takes a reference around its active period:
+ *   PWM  - the motor thread while the motors run, the sweep while scanning
+ *   SPIM - the dot matrix for each frame
+ *   TWIM - the status display for each refresh
+ * so a bus is powered down as soon as its last user is done with it. Servos
+ * are parked with a pulse width of 0, which stops them without holding
+ * torque against the PWM.
+ */
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+
+#define POWER_LINK_UP       BIT(0)
+#define POWER_LINK_DOWN     BIT(1)
+
+/**
+ * @brief Enable runtime PM on the suspendable controllers and publish the link as down.
+ *
+ * Must be called before any user takes a reference. Controllers without
+ * runtime PM support, and all controllers of the simulation build, are left
+ * powered.
+ */
+void power_init(void);
+
+/**
+ * @brief Publish the link state. Safe from any context.
+ *
+ * @param connected True if a controller is connected.
+ */
+void power_link_set(bool connected);
+
+/**
+ * @brief Check the link state without blocking.
+ *
+ * @returns True if a controller is connected.
+ */
+bool power_link_is_up(void);
+
+/**
+ * @brief Block until the link is in the given state.
+ *
+ * Returns at once if it already is.
+ *
+ * @param connected State to wait for.
+ * @param timeout Longest time to wait.
+ * @retval True if the link is in the state.
+ * @retval False on timeout.
+ */
+bool power_link_wait(bool connected, k_timeout_t timeout);
+
+#endif /* POWER_H */
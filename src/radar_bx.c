@@ -1,34 +1,161 @@
 /**
  * @file radar_bx.c
  * @brief Radar behaviour
+ *
+ * Samples are applied to the polar occupancy grid with the usual sonar ray
+ * model: the ultrasonic echo comes from the nearest reflector anywhere in the
+ * beam, so every cell closer than the echo is evidence of free space across
+ * the whole beam, while the cell at the echo is evidence of an obstacle
+ * weighted towards the bin the sensor was pointing at.
  */
 #include "radar_bx.h"
+#include <errno.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
 
-static bool radar_bx_init(void);
-static void radar_process(void);
+#define LOG_MODULE_NAME radar_bx
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
 
-void radar_bx_start(void)
+// Log-odds increments in Q4
+#define LOGODDS_OCCUPIED        14      // ~0.85, p(occupied | echo) = 0.7
+#define LOGODDS_FREE            (-6)    // ~-0.4, p(occupied | no echo) = 0.4
+
+// Beam weights are Q8, full weight on the bin the sensor points at
+#define BEAM_WEIGHT_FULL        256
+#define BEAM_HALF_BINS          ((RADAR_BEAM_DEG * RADAR_SCAN_BINS) / (2 * RADAR_FOV_DEG))
+
+#define SAMPLE_QUEUE_LEN        32
+
+BUILD_ASSERT(RADAR_CELL_MM > 0, "Radar range must be at least one millimetre per cell");
+
+struct bin_geometry {
+    int16_t sin_q15;            // Bearing of the bin centre, positive is left
+    int16_t cos_q15;
+    uint8_t beam_first;         // Bins covered by the beam when pointing at this bin
+    uint8_t beam_last;
+};
+
+static int16_t sin_q15_mdeg(int32_t mdeg);
+static void apply_sample(const struct radar_sample *sample);
+
+K_MSGQ_DEFINE(radar_samples, sizeof(struct radar_sample), SAMPLE_QUEUE_LEN, 4);
+K_MUTEX_DEFINE(grid_lock);
+
+// Precomputed per-bin geometry
+static struct bin_geometry geometry[RADAR_SCAN_BINS];
+static uint16_t beam_weight[BEAM_HALF_BINS + 1];
+
+// Occupancy grid, guarded by grid_lock
+static int8_t grid[RADAR_SCAN_BINS][RADAR_CELLS];
+static uint32_t grid_updates;
+static uint32_t grid_timestamp_ms;
+
+// Bhaskara I approximation of sine, accurate to 0.2% over -180 to 180 degrees
+static int16_t sin_q15_mdeg(int32_t mdeg)
 {
-    bool success;
-    success = radar_bx_init();
+    bool negative = mdeg < 0;
+    int64_t p;
+    int32_t s;
 
-    for(;;)
+    if (negative)
     {
-        radar_process();
+        mdeg = -mdeg;
     }
+    p = (int64_t)mdeg * (180000 - mdeg);
+    s = (int32_t)((4 * p * INT16_MAX) / (40500000000LL - p));
+
+    return negative ? -s : s;
 }
 
-static bool radar_bx_init(void)
+void radar_bx_init(void)
 {
-    return true;
+    const int32_t fov_mdeg = RADAR_FOV_DEG * 1000;
+
+    for (uint8_t d = 0; d <= BEAM_HALF_BINS; d++)
+    {
+        beam_weight[d] = BEAM_WEIGHT_FULL - (d * BEAM_WEIGHT_FULL) / (BEAM_HALF_BINS + 1);
+    }
+
+    for (int i = 0; i < RADAR_SCAN_BINS; i++)
+    {
+        int32_t bearing_mdeg = fov_mdeg / 2 - ((2 * i + 1) * fov_mdeg) / (2 * RADAR_SCAN_BINS);
+
+        geometry[i].sin_q15 = sin_q15_mdeg(bearing_mdeg);
+        geometry[i].cos_q15 = sin_q15_mdeg(bearing_mdeg + 90000);
+        geometry[i].beam_first = MAX(i - BEAM_HALF_BINS, 0);
+        geometry[i].beam_last = MIN(i + BEAM_HALF_BINS, RADAR_SCAN_BINS - 1);
+    }
 }
 
+static void apply_sample(const struct radar_sample *sample)
+{
+    const struct bin_geometry *geom = &geometry[sample->bin];
+    uint8_t hit_cell = RADAR_CELLS;
 
-static void radar_process(void)
+    if (sample->mm < RADAR_RANGE_MM)
+    {
+        hit_cell = sample->mm / RADAR_CELL_MM;
+    }
+
+    for (uint8_t bin = geom->beam_first; bin <= geom->beam_last; bin++)
+    {
+        uint16_t weight = beam_weight[abs(bin - sample->bin)];
+        int8_t *ray = grid[bin];
+        int16_t free_step = (LOGODDS_FREE * weight) / BEAM_WEIGHT_FULL;
+        int16_t occupied_step = (LOGODDS_OCCUPIED * weight) / BEAM_WEIGHT_FULL;
+
+        for (uint8_t cell = 0; cell < hit_cell; cell++)
+        {
+            ray[cell] = MAX(ray[cell] + free_step, RADAR_LOGODDS_MIN);
+        }
+        if (hit_cell < RADAR_CELLS)
+        {
+            ray[hit_cell] = MIN(ray[hit_cell] + occupied_step, RADAR_LOGODDS_MAX);
+        }
+    }
+}
+
+int radar_bx_process(struct radar_sample *sample)
 {
-    return;
+    if (k_msgq_get(&radar_samples, sample, K_NO_WAIT) != 0)
+    {
+        return -EAGAIN;
+    }
+    if (sample->bin >= RADAR_SCAN_BINS)
+    {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&grid_lock, K_FOREVER);
+    apply_sample(sample);
+    grid_updates++;
+    grid_timestamp_ms = sample->timestamp_ms;
+    k_mutex_unlock(&grid_lock);
+
+    return 0;
 }
 
+int radar_bx_submit(const struct radar_sample *sample)
+{
+    return k_msgq_put(&radar_samples, sample, K_NO_WAIT);
+}
 
+void radar_bx_snapshot(struct radar_snapshot *snapshot)
+{
+    k_mutex_lock(&grid_lock, K_FOREVER);
+    memcpy(snapshot->logodds, grid, sizeof(grid));
+    snapshot->updates = grid_updates;
+    snapshot->timestamp_ms = grid_timestamp_ms;
+    k_mutex_unlock(&grid_lock);
+}
+
+void radar_bx_bin_bearing(uint8_t bin, int16_t *sin_q15, int16_t *cos_q15)
+{
+    bin = MIN(bin, RADAR_SCAN_BINS - 1);
+    *sin_q15 = geometry[bin].sin_q15;
+    *cos_q15 = geometry[bin].cos_q15;
+}
@@ -1,16 +1,91 @@
 /**
  * @file radar_bx.h
  * @brief Header for radar behaviour file
+ *
+ * The radar behaviour accumulates ranging samples into a polar
+ * occupancy grid of RADAR_SCAN_BINS bearings by RADAR_CELLS range cells.
+ * Each cell holds a fixed-point log-odds value: positive means occupied,
+ * negative means free and zero means unknown.
+ *
+ * Samples are queued from the ranging path and applied in batches by the
+ * radar processing task, so ranging never waits for a grid update.
  */
 
 #ifndef RADAR_BX_H
 #define RADAR_BX_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Scan geometry */
+#define RADAR_SCAN_BINS         20      // Bearings per sweep, bin 0 is left
+#define RADAR_FOV_DEG           90      // Angle covered by the sweep
+#define RADAR_RANGE_MM          1000    // Range of interest, echoes beyond are gated off
+#define RADAR_CELLS             25      // Range cells per bearing
+#define RADAR_CELL_MM           (RADAR_RANGE_MM / RADAR_CELLS)
+#define RADAR_BEAM_DEG          15      // Width of the ultrasonic beam
+
+/* Log-odds are stored in Q4 fixed point */
+#define RADAR_LOGODDS_SHIFT     4
+#define RADAR_LOGODDS_MAX       64
+#define RADAR_LOGODDS_MIN       (-64)
+
+struct radar_sample {
+    uint8_t bin;
+    uint16_t mm;                // HC_SR04_NO_RETURN_MM if nothing within range
+    uint32_t timestamp_ms;
+};
+
+struct radar_snapshot {
+    uint32_t updates;           // Number of samples applied so far
+    uint32_t timestamp_ms;      // Time of the latest sample applied
+    int8_t logodds[RADAR_SCAN_BINS][RADAR_CELLS];
+};
+
+/**
+ * @brief Initialise radar behaviour.
+ *
+ * Must be called before any sample is processed.
+ */
+void radar_bx_init(void);
+
+/**
+ * @brief Queue a ranging sample for the occupancy grid.
+ *
+ * Does not block. Safe to call from interrupt context.
+ *
+ * @param sample Ranging sample.
+ * @retval 0 if successful.
+ * @retval -ENOMSG if the queue is full and the sample was dropped.
+ */
+int radar_bx_submit(const struct radar_sample *sample);
+
+/**
+ * @brief Apply the oldest queued sample to the occupancy grid.
+ *
+ * Does not block. Must be called from one thread only.
+ *
+ * @param[out] sample Sample applied.
+ * @retval 0 if successful.
+ * @retval -EAGAIN if the queue is empty.
+ * @retval -EINVAL if the sample was out of range and discarded.
+ */
+int radar_bx_process(struct radar_sample *sample);
+
+/**
+ * @brief Copy the current occupancy grid.
+ *
+ * @param snapshot Destination for the copy.
+ */
+void radar_bx_snapshot(struct radar_snapshot *snapshot);
+
 /**
- * @brief Start radar thread.
+ * @brief Get bearing of a scan bin.
  *
- * Intialise radar behaviour and fall into infinite loop.
+ * @param bin Scan bin.
+ * @param[out] sin_q15 Sine of the bearing, Q15. Positive is left.
+ * @param[out] cos_q15 Cosine of the bearing, Q15. Positive is forwards.
  */
-void radar_bx_start(void);
+void radar_bx_bin_bearing(uint8_t bin, int16_t *sin_q15, int16_t *cos_q15);
 
 #endif /* RADAR_BX_H */
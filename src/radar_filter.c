@@ -0,0 +1,117 @@
+/**
+ * @file radar_filter.c
+ * @brief Source file for the per-bin radar distance filter
+ */
+
+#include "radar_filter.h"
+#include <string.h>
+#include <zephyr/sys/util.h>
+
+BUILD_ASSERT((RADAR_FILTER_WINDOW % 2) == 1, "Median window must be odd");
+
+static uint8_t sorted_returns(const struct radar_filter_bin *fb, uint16_t *sorted);
+static uint8_t count_agreeing(const uint16_t *sorted, uint8_t n, uint16_t median);
+static uint16_t smooth(struct radar_filter_bin *fb, uint16_t prev_mm, uint16_t median);
+
+void radar_filter_init(struct radar_filter *filter, uint8_t bin_count)
+{
+    memset(filter, 0, sizeof(*filter));
+    filter->bin_count = MIN(bin_count, RADAR_FILTER_MAX_BINS);
+    for (uint8_t i = 0; i < RADAR_FILTER_MAX_BINS; i++)
+    {
+        filter->mm[i] = RADAR_FILTER_NO_RETURN;
+    }
+} /* radar_filter_init */
+
+// Insertion sort the samples of the window which have a return, returns how many there are
+static uint8_t sorted_returns(const struct radar_filter_bin *fb, uint16_t *sorted)
+{
+    uint8_t n = 0;
+
+    for (uint8_t i = 0; i < fb->count; i++)
+    {
+        uint16_t mm = fb->window[i];
+        uint8_t j = n;
+
+        if (mm == RADAR_FILTER_NO_RETURN)
+        {
+            continue;
+        }
+        while (j > 0 && sorted[j - 1] > mm)
+        {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = mm;
+        n++;
+    }
+    return n;
+} /* sorted_returns */
+
+static uint8_t count_agreeing(const uint16_t *sorted, uint8_t n, uint16_t median)
+{
+    uint8_t agree = 0;
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+        uint16_t diff = (sorted[i] > median) ? (sorted[i] - median) : (median - sorted[i]);
+
+        if (diff <= RADAR_FILTER_AGREE_MM)
+        {
+            agree++;
+        }
+    }
+    return agree;
+} /* count_agreeing */
+
+static uint16_t smooth(struct radar_filter_bin *fb, uint16_t prev_mm, uint16_t median)
+{
+    uint16_t step = (median > prev_mm) ? (median - prev_mm) : (prev_mm - median);
+
+    if (prev_mm == RADAR_FILTER_NO_RETURN || step > RADAR_FILTER_STEP_MM)
+    {
+        // Restart smoothing on a new reflector
+        fb->smoothed = (uint32_t)median << RADAR_FILTER_EMA_SHIFT;
+    }
+    else
+    {
+        fb->smoothed -= fb->smoothed >> RADAR_FILTER_EMA_SHIFT;
+        fb->smoothed += median;
+    }
+
+    return (fb->smoothed + BIT(RADAR_FILTER_EMA_SHIFT - 1)) >> RADAR_FILTER_EMA_SHIFT;
+} /* smooth */
+
+uint16_t radar_filter_update(struct radar_filter *filter, uint8_t bin, uint16_t raw_mm)
+{
+    struct radar_filter_bin *fb;
+    uint16_t sorted[RADAR_FILTER_WINDOW];
+    uint8_t returns;
+    uint16_t median;
+
+    if (bin >= filter->bin_count)
+    {
+        return RADAR_FILTER_NO_RETURN;
+    }
+    fb = &filter->bins[bin];
+
+    fb->window[fb->head] = raw_mm;
+    fb->head = (fb->head + 1) % RADAR_FILTER_WINDOW;
+    fb->count = MIN(fb->count + 1, RADAR_FILTER_WINDOW);
+
+    // Report no return only when most of the window agrees there is nothing there
+    returns = sorted_returns(fb, sorted);
+    if (2 * returns <= fb->count)
+    {
+        filter->mm[bin] = RADAR_FILTER_NO_RETURN;
+        filter->confidence[bin] = ((fb->count - returns) * RADAR_FILTER_CONFIDENCE_MAX) / RADAR_FILTER_WINDOW;
+        return filter->mm[bin];
+    }
+
+    // With an even number of returns take the nearer of the middle two
+    median = sorted[(returns - 1) / 2];
+    filter->mm[bin] = smooth(fb, filter->mm[bin], median);
+    filter->confidence[bin] = (count_agreeing(sorted, returns, median) * RADAR_FILTER_CONFIDENCE_MAX) /
+                              RADAR_FILTER_WINDOW;
+    return filter->mm[bin];
+} /* radar_filter_update */
@@ -0,0 +1,69 @@
+/**
+ * @file radar_filter.h
+ * @brief Header file for the per-bin radar distance filter
+ *
+ * Each scan bin keeps a short ring buffer of raw distances. A new sample
+ * updates the bin with the median of the window, which rejects single-shot
+ * outliers and dropouts, followed by exponential smoothing. Steps larger than
+ * RADAR_FILTER_STEP_MM are taken immediately rather than smoothed, so a new
+ * obstacle is not hidden behind the smoothing lag.
+ *
+ * Each bin also carries a confidence from 0 to RADAR_FILTER_CONFIDENCE_MAX:
+ * the fraction of the window agreeing with the median to within
+ * RADAR_FILTER_AGREE_MM, or for a no return bin, the fraction of the window
+ * without a return.
+ *
+ * All arithmetic is integer.
+ */
+
+#ifndef RADAR_FILTER_H
+#define RADAR_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RADAR_FILTER_MAX_BINS           64
+#define RADAR_FILTER_WINDOW             3       // Samples per bin in the median window, odd
+#define RADAR_FILTER_EMA_SHIFT          2       // Smoothing factor of 1 / 2^shift
+#define RADAR_FILTER_STEP_MM            150     // Median changes larger than this bypass smoothing
+#define RADAR_FILTER_AGREE_MM           40      // Samples within this of the median support it
+#define RADAR_FILTER_CONFIDENCE_MAX     UINT8_MAX
+
+/* Distance value of bins with no echo inside the sensing range */
+#define RADAR_FILTER_NO_RETURN          UINT16_MAX
+
+struct radar_filter_bin {
+    uint16_t window[RADAR_FILTER_WINDOW];
+    uint8_t head;
+    uint8_t count;
+    uint32_t smoothed;          // Smoothed distance, scaled by 2^RADAR_FILTER_EMA_SHIFT
+};
+
+struct radar_filter {
+    uint8_t bin_count;
+    struct radar_filter_bin bins[RADAR_FILTER_MAX_BINS];
+    uint16_t mm[RADAR_FILTER_MAX_BINS];             // Filtered distance of each bin
+    uint8_t confidence[RADAR_FILTER_MAX_BINS];      // Confidence of each bin
+};
+
+/**
+ * @brief Initialise radar filter.
+ *
+ * Every bin starts as no return with zero confidence.
+ *
+ * @param filter Filter state.
+ * @param bin_count Number of scan bins. Max RADAR_FILTER_MAX_BINS.
+ */
+void radar_filter_init(struct radar_filter *filter, uint8_t bin_count);
+
+/**
+ * @brief Add a raw sample to a bin and update its filtered output.
+ *
+ * @param filter Filter state.
+ * @param bin Scan bin. Samples for bins outside the filter are ignored.
+ * @param raw_mm Measured distance, or RADAR_FILTER_NO_RETURN.
+ * @returns Filtered distance of the bin.
+ */
+uint16_t radar_filter_update(struct radar_filter *filter, uint8_t bin, uint16_t raw_mm);
+
+#endif /* RADAR_FILTER_H */
@@ -0,0 +1,81 @@
+/**
+ * @file ranging_sched.c
+ * @brief Source file for the multi-sensor ultrasonic firing scheduler
+ */
+
+#include "ranging_sched.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/util.h>
+
+static bool fires_with(const struct ranging_sched_sensor *sensors, uint8_t mask, uint8_t candidate,
+                       uint16_t separation_deg);
+
+uint16_t ranging_sched_angle_between(int16_t a_deg, int16_t b_deg)
+{
+    int32_t diff = ((int32_t)a_deg - b_deg) % 360;
+
+    if (diff < 0)
+    {
+        diff += 360;
+    }
+    return (diff > 180) ? 360 - diff : diff;
+} /* ranging_sched_angle_between */
+
+// Whether the candidate is clear of every sensor already in the slot
+static bool fires_with(const struct ranging_sched_sensor *sensors, uint8_t mask, uint8_t candidate,
+                       uint16_t separation_deg)
+{
+    const struct ranging_sched_sensor *c = &sensors[candidate];
+
+    for (uint8_t i = 0; mask != 0; i++, mask >>= 1)
+    {
+        const struct ranging_sched_sensor *s = &sensors[i];
+        int32_t gap_deg;
+
+        if (!(mask & 1))
+        {
+            continue;
+        }
+        gap_deg = (int32_t)ranging_sched_angle_between(s->bearing_deg, c->bearing_deg) - s->spread_deg - c->spread_deg;
+        if (gap_deg < separation_deg)
+        {
+            return false;
+        }
+    }
+    return true;
+} /* fires_with */
+
+int ranging_sched_init(struct ranging_sched *sched, const struct ranging_sched_sensor *sensors, uint8_t count,
+                       uint16_t separation_deg)
+{
+    uint8_t slot;
+
+    if (count == 0 || count > RANGING_SCHED_MAX_SENSORS)
+    {
+        return -EINVAL;
+    }
+    memset(sched, 0, sizeof(*sched));
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        for (slot = 0; slot < sched->slot_count; slot++)
+        {
+            if (fires_with(sensors, sched->slot_mask[slot], i, separation_deg))
+            {
+                break;
+            }
+        }
+        sched->slot_mask[slot] |= BIT(i);
+        sched->slot_count = MAX(sched->slot_count, slot + 1);
+    }
+    return 0;
+} /* ranging_sched_init */
+
+uint8_t ranging_sched_next(struct ranging_sched *sched)
+{
+    uint8_t mask = sched->slot_mask[sched->next];
+
+    sched->next = (sched->next + 1 < sched->slot_count) ? sched->next + 1 : 0;
+    return mask;
+} /* ranging_sched_next */
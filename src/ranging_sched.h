@@ -0,0 +1,71 @@
+/**
+ * @file ranging_sched.h
+ * @brief Header file for the multi-sensor ultrasonic firing scheduler
+ *
+ * Ultrasonic sensors hear each other: a burst from one sensor which reaches
+ * another, directly or off an obstacle, reads as a false close return. The
+ * scheduler packs the sensors into firing slots. Sensors fire together only if
+ * the edges of their fields of view are at least the separation angle apart.
+ * The slots are then fired in turn.
+ *
+ * Each slot costs the time of one measurement however many sensors it holds,
+ * so opposed or well spread sensors add samples without slowing the others.
+ * Only sensors which would cross talk are interleaved.
+ *
+ * A sensor's field of view is its bearing plus or minus its spread. A fixed
+ * sensor has a spread of 0. A sensor on the radar servo has a spread of half
+ * the sweep angle.
+ */
+
+#ifndef RANGING_SCHED_H
+#define RANGING_SCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RANGING_SCHED_MAX_SENSORS   8       // Slot masks are eight bits
+
+struct ranging_sched_sensor {
+    int16_t bearing_deg;        // Counter-clockwise from straight ahead
+    uint16_t spread_deg;        // Half width of the field of view around the bearing
+};
+
+struct ranging_sched {
+    uint8_t slot_mask[RANGING_SCHED_MAX_SENSORS];   // Sensors fired together, bit i is sensor i
+    uint8_t slot_count;
+    uint8_t next;
+};
+
+/**
+ * @brief Pack sensors into firing slots.
+ *
+ * Sensors are placed first fit, in the order given, so list the sensor which
+ * should be sampled most often first.
+ *
+ * @param sched Scheduler state.
+ * @param sensors Bearing and spread of each sensor.
+ * @param count Number of sensors. Max RANGING_SCHED_MAX_SENSORS.
+ * @param separation_deg Minimum angle between the fields of view of sensors
+ *                       which fire together.
+ * @retval 0 if successful.
+ * @retval -EINVAL if there are no sensors or too many.
+ */
+int ranging_sched_init(struct ranging_sched *sched, const struct ranging_sched_sensor *sensors, uint8_t count,
+                       uint16_t separation_deg);
+
+/**
+ * @brief Get the sensors to fire next.
+ *
+ * @param sched Scheduler state.
+ * @returns Mask of the sensors in the next slot, bit i is sensor i.
+ */
+uint8_t ranging_sched_next(struct ranging_sched *sched);
+
+/**
+ * @brief Angle between two bearings.
+ *
+ * @returns Angle in degrees, 0 to 180.
+ */
+uint16_t ranging_sched_angle_between(int16_t a_deg, int16_t b_deg);
+
+#endif /* RANGING_SCHED_H */
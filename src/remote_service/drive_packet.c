@@ -0,0 +1,74 @@
+/**
+ * @file drive_packet.c
+ * @brief Source file for the binary drive command packet decoder
+ */
+
+#include "drive_packet.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/sys/byteorder.h>
+
+static int16_t get_scaled(const uint8_t *src);
+
+void drive_rx_reset(struct drive_rx *rx)
+{
+    memset(rx, 0, sizeof(*rx));
+} /* drive_rx_reset */
+
+static int16_t get_scaled(const uint8_t *src)
+{
+    int16_t val = (int16_t)sys_get_le16(src);
+
+    return CLAMP(val, -DRIVE_FULL_SCALE, DRIVE_FULL_SCALE);
+} /* get_scaled */
+
+int drive_packet_decode(struct drive_rx *rx, const uint8_t *buf, uint16_t len, struct drive_packet *pkt)
+{
+    int16_t seq_diff;
+
+    if (len < DRIVE_PACKET_MIN_LEN || len > DRIVE_PACKET_MAX_LEN ||
+        ((len - DRIVE_PACKET_MIN_LEN) % DRIVE_PACKET_SETPOINT_LEN) != 0)
+    {
+        rx->stats.malformed++;
+        return -EINVAL;
+    }
+
+    pkt->seq = sys_get_le16(&buf[0]);
+    pkt->count = 1 + (len - DRIVE_PACKET_MIN_LEN) / DRIVE_PACKET_SETPOINT_LEN;
+    pkt->setpoints[0].delay_ms = 0;
+    pkt->setpoints[0].throttle = get_scaled(&buf[2]);
+    pkt->setpoints[0].steering = get_scaled(&buf[4]);
+
+    buf += DRIVE_PACKET_MIN_LEN;
+    for (uint8_t i = 1; i < pkt->count; i++)
+    {
+        pkt->setpoints[i].delay_ms = sys_get_le16(&buf[0]);
+        pkt->setpoints[i].throttle = get_scaled(&buf[2]);
+        pkt->setpoints[i].steering = get_scaled(&buf[4]);
+        buf += DRIVE_PACKET_SETPOINT_LEN;
+
+        if (pkt->setpoints[i].delay_ms < pkt->setpoints[i - 1].delay_ms)
+        {
+            rx->stats.malformed++;
+            return -EINVAL;
+        }
+    }
+
+    // Sequence numbers wrap, so compare by signed distance
+    seq_diff = (int16_t)(pkt->seq - rx->last_seq);
+    if (rx->synced && seq_diff <= 0)
+    {
+        rx->stats.out_of_order++;
+        return -EALREADY;
+    }
+    if (rx->synced)
+    {
+        rx->stats.lost += seq_diff - 1;
+    }
+    rx->synced = true;
+    rx->last_seq = pkt->seq;
+    rx->stats.received++;
+
+    return 0;
+} /* drive_packet_decode */
@@ -0,0 +1,82 @@
+/**
+ * @file drive_packet.h
+ * @brief Header file for the binary drive command packet decoder
+ *
+ * Packet layout (little-endian, packed):
+ *
+ *   | seq | throttle | steering | delay_ms | throttle | steering | ...
+ *   | u16 |   i16    |   i16    |   u16    |   i16    |   i16    |
+ *
+ * The first setpoint applies on receipt. It may be followed by a batch of
+ * time-tagged setpoints which apply @p delay_ms after receipt, in order of
+ * non-decreasing delay. Throttle and steering run from -DRIVE_FULL_SCALE to
+ * DRIVE_FULL_SCALE; positive throttle is forwards and positive steering is
+ * to the right.
+ *
+ * The sequence number increments by one per packet. Gaps are counted as lost
+ * packets, and packets older than the newest one received are dropped.
+ */
+
+#ifndef DRIVE_PACKET_H
+#define DRIVE_PACKET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DRIVE_PACKET_MIN_LEN            6
+#define DRIVE_PACKET_SETPOINT_LEN       6
+#define DRIVE_PACKET_MAX_SETPOINTS      8
+#define DRIVE_PACKET_MAX_LEN            (DRIVE_PACKET_MIN_LEN + (DRIVE_PACKET_MAX_SETPOINTS - 1) * DRIVE_PACKET_SETPOINT_LEN)
+
+#define DRIVE_FULL_SCALE                1000
+
+struct drive_setpoint {
+    uint16_t delay_ms;
+    int16_t throttle;
+    int16_t steering;
+};
+
+struct drive_packet {
+    uint16_t seq;
+    uint8_t count;
+    struct drive_setpoint setpoints[DRIVE_PACKET_MAX_SETPOINTS];
+};
+
+struct drive_rx_stats {
+    uint32_t received;          // Packets accepted
+    uint32_t lost;              // Packets missing from the sequence
+    uint32_t out_of_order;      // Late or duplicate packets dropped
+    uint32_t malformed;         // Packets with a bad length or setpoint order
+};
+
+struct drive_rx {
+    bool synced;
+    uint16_t last_seq;
+    struct drive_rx_stats stats;
+};
+
+/**
+ * @brief Reset the receive sequence state and statistics.
+ *
+ * The next packet is accepted whatever its sequence number.
+ *
+ * @param rx Receive state.
+ */
+void drive_rx_reset(struct drive_rx *rx);
+
+/**
+ * @brief Check and decode a drive packet.
+ *
+ * Throttle and steering are clamped to DRIVE_FULL_SCALE.
+ *
+ * @param rx Receive state.
+ * @param buf Packet.
+ * @param len Length of packet.
+ * @param[out] pkt Decoded packet.
+ * @retval 0 if successful.
+ * @retval -EINVAL if the packet is malformed.
+ * @retval -EALREADY if the packet is older than the newest one received.
+ */
+int drive_packet_decode(struct drive_rx *rx, const uint8_t *buf, uint16_t len, struct drive_packet *pkt);
+
+#endif /* DRIVE_PACKET_H */
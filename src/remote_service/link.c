@@ -0,0 +1,228 @@
+/**
+ * @file link.c
+ * @brief Source file for the BLE link manager
+ */
+
+#include "link.h"
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/logging/log.h>
+
+#define LOG_MODULE_NAME link
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+BUILD_ASSERT(LINK_IDLE_TIMEOUT * 10 > (1 + LINK_IDLE_LATENCY) * LINK_IDLE_INTERVAL_MAX * 5 / 4 * 2,
+             "Idle supervision timeout must cover twice the effective interval");
+
+static void mode_work_handler(struct k_work *work);
+static void idle_work_handler(struct k_work *work);
+static void on_connected(struct bt_conn *conn, uint8_t err);
+static void on_disconnected(struct bt_conn *conn, uint8_t reason);
+static void on_le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency, uint16_t timeout);
+static void on_le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *param);
+static void on_le_data_len_updated(struct bt_conn *conn, struct bt_conn_le_data_len_info *info);
+static void on_mtu_exchanged(struct bt_conn *conn, uint8_t err, struct bt_gatt_exchange_params *params);
+
+static const struct bt_le_conn_param active_param =
+    BT_LE_CONN_PARAM_INIT(LINK_ACTIVE_INTERVAL_MIN, LINK_ACTIVE_INTERVAL_MAX, LINK_ACTIVE_LATENCY, LINK_ACTIVE_TIMEOUT);
+static const struct bt_le_conn_param idle_param =
+    BT_LE_CONN_PARAM_INIT(LINK_IDLE_INTERVAL_MIN, LINK_IDLE_INTERVAL_MAX, LINK_IDLE_LATENCY, LINK_IDLE_TIMEOUT);
+
+static K_WORK_DEFINE(mode_work, mode_work_handler);
+static K_WORK_DELAYABLE_DEFINE(idle_work, idle_work_handler);
+static struct bt_gatt_exchange_params mtu_exchange_params;
+
+// Set from the Bluetooth callbacks, read from anywhere, guarded by lock
+static struct k_spinlock lock;
+static struct bt_conn *link_conn;
+static struct link_info info;
+
+// Mode the link should be in, set by link_activity() and the idle check
+static atomic_t active;
+static atomic_t last_activity_ms;
+
+BT_CONN_CB_DEFINE(link_conn_callbacks) = {
+    .connected          = on_connected,
+    .disconnected       = on_disconnected,
+    .le_param_updated   = on_le_param_updated,
+    .le_phy_updated     = on_le_phy_updated,
+    .le_data_len_updated = on_le_data_len_updated,
+};
+
+void link_activity(void)
+{
+    atomic_set(&last_activity_ms, k_uptime_get_32());
+    if (atomic_cas(&active, 0, 1)) {
+        k_work_submit(&mode_work);
+    }
+} /* link_activity */
+
+void link_info_get(struct link_info *out)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    *out = info;
+    k_spin_unlock(&lock, key);
+    out->active = (out->interval != 0) && atomic_get(&active);
+} /* link_info_get */
+
+static struct bt_conn *conn_get(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    struct bt_conn *conn = (link_conn != NULL) ? bt_conn_ref(link_conn) : NULL;
+
+    k_spin_unlock(&lock, key);
+    return conn;
+} /* conn_get */
+
+// Runs in the system workqueue, parameter requests can wait for buffers there
+static void mode_work_handler(struct k_work *work)
+{
+    bool want_active = atomic_get(&active);
+    struct bt_conn *conn = conn_get();
+    int err;
+
+    ARG_UNUSED(work);
+    if (conn == NULL) {
+        return;
+    }
+    err = bt_conn_le_param_update(conn, want_active ? &active_param : &idle_param);
+    bt_conn_unref(conn);
+    if (err && err != -EALREADY) {
+        // Back to the previous mode, so the next command or idle check tries again
+        LOG_WRN("%s parameter request failed (err %d)", want_active ? "Active" : "Idle", err);
+        atomic_set(&active, !want_active);
+    } else {
+        LOG_DBG("Requested %s parameters", want_active ? "active" : "idle");
+    }
+    if (atomic_get(&active)) {
+        k_work_reschedule(&idle_work, K_MSEC(LINK_IDLE_AFTER_MS));
+    }
+} /* mode_work_handler */
+
+static void idle_work_handler(struct k_work *work)
+{
+    uint32_t quiet_ms = k_uptime_get_32() - (uint32_t)atomic_get(&last_activity_ms);
+
+    ARG_UNUSED(work);
+    if (quiet_ms < LINK_IDLE_AFTER_MS) {
+        k_work_reschedule(&idle_work, K_MSEC(LINK_IDLE_AFTER_MS - quiet_ms));
+        return;
+    }
+    if (atomic_cas(&active, 1, 0)) {
+        mode_work_handler(NULL);
+    }
+} /* idle_work_handler */
+
+static void on_connected(struct bt_conn *conn, uint8_t err)
+{
+    struct bt_conn_info conn_info;
+    k_spinlock_key_t key;
+    int ret;
+
+    if (err) {
+        return;
+    }
+    bt_conn_get_info(conn, &conn_info);
+
+    key = k_spin_lock(&lock);
+    link_conn = bt_conn_ref(conn);
+    info = (struct link_info){
+        .interval = conn_info.le.interval,
+        .latency = conn_info.le.latency,
+        .timeout = conn_info.le.timeout,
+        .tx_phy = conn_info.le.phy->tx_phy,
+        .rx_phy = conn_info.le.phy->rx_phy,
+        .tx_max_len = conn_info.le.data_len->tx_max_len,
+        .rx_max_len = conn_info.le.data_len->rx_max_len,
+        .mtu = bt_gatt_get_mtu(conn),
+    };
+    k_spin_unlock(&lock, key);
+    LOG_INF("Connected: interval %u x 1.25 ms, latency %u, timeout %u0 ms",
+            conn_info.le.interval, conn_info.le.latency, conn_info.le.timeout);
+
+    // Fast PHY, long packets and a MTU large enough to carry a whole sweep in one notification
+    ret = bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_2M);
+    if (ret) {
+        LOG_WRN("PHY update failed (err %d)", ret);
+    }
+    ret = bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX);
+    if (ret) {
+        LOG_WRN("Data length update failed (err %d)", ret);
+    }
+    mtu_exchange_params.func = on_mtu_exchanged;
+    ret = bt_gatt_exchange_mtu(conn, &mtu_exchange_params);
+    if (ret) {
+        LOG_WRN("MTU exchange failed (err %d)", ret);
+    }
+
+    // Start in active mode, which also speeds up discovery. Idle follows if no command arrives
+    atomic_set(&last_activity_ms, k_uptime_get_32());
+    atomic_set(&active, 1);
+    k_work_submit(&mode_work);
+} /* on_connected */
+
+static void on_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    k_spinlock_key_t key;
+
+    ARG_UNUSED(reason);
+    key = k_spin_lock(&lock);
+    if (link_conn == conn) {
+        bt_conn_unref(link_conn);
+        link_conn = NULL;
+        info = (struct link_info){0};
+    }
+    k_spin_unlock(&lock, key);
+    atomic_clear(&active);
+    k_work_cancel_delayable(&idle_work);
+} /* on_disconnected */
+
+static void on_le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency, uint16_t timeout)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    info.interval = interval;
+    info.latency = latency;
+    info.timeout = timeout;
+    k_spin_unlock(&lock, key);
+    LOG_INF("Connection parameters: interval %u x 1.25 ms, latency %u, timeout %u0 ms", interval, latency, timeout);
+} /* on_le_param_updated */
+
+static void on_le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *param)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    info.tx_phy = param->tx_phy;
+    info.rx_phy = param->rx_phy;
+    k_spin_unlock(&lock, key);
+    LOG_INF("PHY: tx %u, rx %u", param->tx_phy, param->rx_phy);
+} /* on_le_phy_updated */
+
+static void on_le_data_len_updated(struct bt_conn *conn, struct bt_conn_le_data_len_info *len_info)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    info.tx_max_len = len_info->tx_max_len;
+    info.rx_max_len = len_info->rx_max_len;
+    k_spin_unlock(&lock, key);
+    LOG_INF("Data length: tx %u octets, rx %u octets", len_info->tx_max_len, len_info->rx_max_len);
+} /* on_le_data_len_updated */
+
+static void on_mtu_exchanged(struct bt_conn *conn, uint8_t err, struct bt_gatt_exchange_params *params)
+{
+    k_spinlock_key_t key;
+
+    ARG_UNUSED(params);
+    if (err) {
+        LOG_WRN("MTU exchange returned %d", err);
+        return;
+    }
+    key = k_spin_lock(&lock);
+    info.mtu = bt_gatt_get_mtu(conn);
+    k_spin_unlock(&lock, key);
+    LOG_INF("ATT MTU negotiated: %u", bt_gatt_get_mtu(conn));
+} /* on_mtu_exchanged */
@@ -0,0 +1,69 @@
+/**
+ * @file link.h
+ * @brief Header file for the BLE link manager
+ *
+ * Tunes the connection for what the robot is doing. On connection it asks
+ * for the 2M PHY, the maximum data length and a large ATT MTU, so a whole
+ * radar sweep or stats payload goes out in one short packet.
+ *
+ * While drive commands are flowing the link is held in active mode, with a
+ * short connection interval and no peripheral latency, so a command waits at
+ * most one interval for its connection event. That keeps the command period
+ * plus the interval well inside the motor watchdog. After LINK_IDLE_AFTER_MS
+ * without a command the link drops to idle mode, with a relaxed interval.
+ * The next command switches back to active mode, but the switch only takes
+ * effect several idle events later, and the keep-alives in between must still
+ * reach the motor watchdog. Idle mode therefore has no peripheral latency, as
+ * each skipped event would add a whole interval to their wait.
+ *
+ * Parameter requests run from the system workqueue, never from the Bluetooth
+ * RX context. The negotiated parameters are logged and kept for the stats.
+ */
+
+#ifndef LINK_H
+#define LINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Active mode: 7.5 ms to 15 ms interval, no latency, 400 ms supervision timeout
+#define LINK_ACTIVE_INTERVAL_MIN    6       // 1.25 ms units
+#define LINK_ACTIVE_INTERVAL_MAX    12
+#define LINK_ACTIVE_LATENCY         0
+#define LINK_ACTIVE_TIMEOUT         40      // 10 ms units
+
+// Idle mode: 45 ms to 60 ms interval, no latency, 4 s supervision timeout
+#define LINK_IDLE_INTERVAL_MIN      36
+#define LINK_IDLE_INTERVAL_MAX      48
+#define LINK_IDLE_LATENCY           0
+#define LINK_IDLE_TIMEOUT           400
+
+#define LINK_IDLE_AFTER_MS          2000    // Time without a drive command before going idle
+
+struct link_info {
+    uint16_t interval;          // Connection interval in 1.25 ms units, 0 when not connected
+    uint16_t latency;           // Peripheral latency in connection events
+    uint16_t timeout;           // Supervision timeout in 10 ms units
+    uint8_t tx_phy;             // BT_GAP_LE_PHY_1M, BT_GAP_LE_PHY_2M or BT_GAP_LE_PHY_CODED
+    uint8_t rx_phy;
+    uint16_t tx_max_len;        // Negotiated data length in octets
+    uint16_t rx_max_len;
+    uint16_t mtu;               // ATT MTU
+    bool active;                // Active mode requested
+};
+
+/**
+ * @brief Note drive command traffic.
+ *
+ * Cheap enough for every packet. Safe from the Bluetooth RX context.
+ */
+void link_activity(void);
+
+/**
+ * @brief Get the negotiated link parameters.
+ *
+ * @param[out] info Link parameters, all zero when not connected.
+ */
+void link_info_get(struct link_info *info);
+
+#endif /* LINK_H */
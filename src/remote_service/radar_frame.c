@@ -0,0 +1,141 @@
+/**
+ * @file radar_frame.c
+ * @brief Source file for the binary radar sweep frame encoder
+ */
+
+#include "radar_frame.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+
+static bool bin_changed(const struct radar_frame_encoder *enc, uint8_t bin, uint16_t mm,
+                        const uint8_t *confidence);
+static uint8_t count_changed_bins(const struct radar_frame_encoder *enc, const uint16_t *bins_mm,
+                                  const uint8_t *confidence);
+static uint8_t *put_entry(struct radar_frame_encoder *enc, uint8_t *entry, uint8_t bin,
+                          const uint16_t *bins_mm, const uint8_t *confidence);
+static void put_header(uint8_t *buf, const struct radar_frame_encoder *enc, uint8_t flags,
+                       uint32_t timestamp_ms, uint8_t entries);
+
+void radar_frame_encoder_init(struct radar_frame_encoder *enc, uint8_t bin_count)
+{
+    memset(enc, 0, sizeof(*enc));
+    enc->bin_count = MIN(bin_count, RADAR_FRAME_MAX_BINS);
+    enc->keyframe_pending = true;
+} /* radar_frame_encoder_init */
+
+void radar_frame_encoder_request_keyframe(struct radar_frame_encoder *enc)
+{
+    enc->keyframe_pending = true;
+} /* radar_frame_encoder_request_keyframe */
+
+static bool bin_changed(const struct radar_frame_encoder *enc, uint8_t bin, uint16_t mm,
+                        const uint8_t *confidence)
+{
+    uint16_t sent = enc->sent_mm[bin];
+    uint16_t diff = (mm > sent) ? (mm - sent) : (sent - mm);
+
+    if (diff >= RADAR_FRAME_DELTA_THRESHOLD_MM)
+    {
+        return true;
+    }
+    if (NULL != confidence)
+    {
+        uint8_t sent_conf = enc->sent_confidence[bin];
+
+        diff = (confidence[bin] > sent_conf) ? (confidence[bin] - sent_conf) : (sent_conf - confidence[bin]);
+        return diff >= RADAR_FRAME_DELTA_THRESHOLD_CONFIDENCE;
+    }
+    return false;
+} /* bin_changed */
+
+static uint8_t count_changed_bins(const struct radar_frame_encoder *enc, const uint16_t *bins_mm,
+                                  const uint8_t *confidence)
+{
+    uint8_t changed = 0;
+
+    for (uint8_t i = 0; i < enc->bin_count; i++)
+    {
+        if (bin_changed(enc, i, bins_mm[i], confidence))
+        {
+            changed++;
+        }
+    }
+    return changed;
+} /* count_changed_bins */
+
+static void put_header(uint8_t *buf, const struct radar_frame_encoder *enc, uint8_t flags,
+                       uint32_t timestamp_ms, uint8_t entries)
+{
+    buf[0] = RADAR_FRAME_VERSION;
+    buf[1] = flags;
+    sys_put_le16(enc->seq, &buf[2]);
+    sys_put_le32(timestamp_ms, &buf[4]);
+    buf[8] = enc->bin_count;
+    buf[9] = entries;
+} /* put_header */
+
+// Write the distance and confidence of a bin, returns the position of the next entry
+static uint8_t *put_entry(struct radar_frame_encoder *enc, uint8_t *entry, uint8_t bin,
+                          const uint16_t *bins_mm, const uint8_t *confidence)
+{
+    sys_put_le16(bins_mm[bin], entry);
+    entry += sizeof(uint16_t);
+    enc->sent_mm[bin] = bins_mm[bin];
+    if (NULL != confidence)
+    {
+        *entry++ = confidence[bin];
+        enc->sent_confidence[bin] = confidence[bin];
+    }
+    return entry;
+} /* put_entry */
+
+int radar_frame_encode(struct radar_frame_encoder *enc, const uint16_t *bins_mm,
+                       const uint8_t *confidence, uint32_t timestamp_ms, bool delta,
+                       uint8_t *buf, size_t size)
+{
+    bool keyframe = !delta || enc->keyframe_pending ||
+                    (enc->frames_since_key >= RADAR_FRAME_KEYFRAME_INTERVAL);
+    uint8_t changed = keyframe ? enc->bin_count : count_changed_bins(enc, bins_mm, confidence);
+    size_t confidence_len = (NULL != confidence) ? RADAR_FRAME_CONFIDENCE_LEN : 0;
+    size_t dense_len = RADAR_FRAME_HDR_LEN + enc->bin_count * (RADAR_FRAME_DENSE_ENTRY_LEN + confidence_len);
+    size_t sparse_len = RADAR_FRAME_HDR_LEN + changed * (RADAR_FRAME_SPARSE_ENTRY_LEN + confidence_len);
+    uint8_t flags = (NULL != confidence) ? RADAR_FRAME_FLAG_CONFIDENCE : 0;
+    uint8_t *entry = &buf[RADAR_FRAME_HDR_LEN];
+
+    // A delta covering most of the sweep costs more than sending every bin
+    if (!keyframe && sparse_len >= dense_len)
+    {
+        keyframe = true;
+    }
+
+    if (size < (keyframe ? dense_len : sparse_len))
+    {
+        return -ENOSPC;
+    }
+
+    enc->seq++;
+    if (keyframe)
+    {
+        put_header(buf, enc, flags | RADAR_FRAME_FLAG_KEYFRAME, timestamp_ms, enc->bin_count);
+        for (uint8_t i = 0; i < enc->bin_count; i++)
+        {
+            entry = put_entry(enc, entry, i, bins_mm, confidence);
+        }
+        enc->keyframe_pending = false;
+        enc->frames_since_key = 0;
+        return dense_len;
+    }
+
+    put_header(buf, enc, flags | RADAR_FRAME_FLAG_SPARSE, timestamp_ms, changed);
+    for (uint8_t i = 0; i < enc->bin_count; i++)
+    {
+        if (bin_changed(enc, i, bins_mm[i], confidence))
+        {
+            *entry++ = i;
+            entry = put_entry(enc, entry, i, bins_mm, confidence);
+        }
+    }
+    enc->frames_since_key++;
+    return sparse_len;
+} /* radar_frame_encode */
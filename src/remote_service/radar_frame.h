@@ -0,0 +1,98 @@
+/**
+ * @file radar_frame.h
+ * @brief Header file for the binary radar sweep frame encoder
+ *
+ * Frame layout (little-endian, packed):
+ *
+ *   | version | flags | seq | timestamp_ms | bin_count | entries | payload |
+ *   |   u8    |  u8   | u16 |     u32      |    u8     |   u8    |   ...   |
+ *
+ * Dense frames carry @p entries uint16 distances, one per bin starting at
+ * bin 0. Sparse frames (RADAR_FRAME_FLAG_SPARSE) carry @p entries pairs of
+ * uint8 bin index and uint16 distance, and are used for delta-only updates.
+ * With RADAR_FRAME_FLAG_CONFIDENCE every entry is followed by a uint8
+ * confidence, 0 to 255.
+ */
+
+#ifndef RADAR_FRAME_H
+#define RADAR_FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <zephyr/sys/util.h>
+
+#define RADAR_FRAME_VERSION             1
+#define RADAR_FRAME_MAX_BINS            64
+#define RADAR_FRAME_HDR_LEN             10
+#define RADAR_FRAME_DENSE_ENTRY_LEN     2
+#define RADAR_FRAME_SPARSE_ENTRY_LEN    3
+#define RADAR_FRAME_CONFIDENCE_LEN      1
+#define RADAR_FRAME_MAX_LEN             (RADAR_FRAME_HDR_LEN + RADAR_FRAME_MAX_BINS * \
+                                         (RADAR_FRAME_SPARSE_ENTRY_LEN + RADAR_FRAME_CONFIDENCE_LEN))
+
+/* Frame flags */
+#define RADAR_FRAME_FLAG_SPARSE         BIT(0)  // Payload is (bin, mm) pairs
+#define RADAR_FRAME_FLAG_KEYFRAME       BIT(1)  // Frame carries every bin
+#define RADAR_FRAME_FLAG_CONFIDENCE     BIT(2)  // Each entry is followed by a confidence byte
+
+/* Distance value used for bins with no echo inside the sensing range */
+#define RADAR_FRAME_NO_RETURN           UINT16_MAX
+
+/* Bins closer than this to their last transmitted value are left out of delta frames */
+#define RADAR_FRAME_DELTA_THRESHOLD_MM  10
+/* Bins whose confidence moved by this much are included in delta frames regardless of distance */
+#define RADAR_FRAME_DELTA_THRESHOLD_CONFIDENCE 64
+/* A full frame is forced after this many delta frames */
+#define RADAR_FRAME_KEYFRAME_INTERVAL   10
+
+struct radar_frame_encoder {
+    uint16_t seq;
+    uint8_t bin_count;
+    uint8_t frames_since_key;
+    bool keyframe_pending;
+    uint16_t sent_mm[RADAR_FRAME_MAX_BINS];
+    uint8_t sent_confidence[RADAR_FRAME_MAX_BINS];
+};
+
+/**
+ * @brief Initialise radar frame encoder.
+ *
+ * The first frame produced after initialisation is always a keyframe.
+ *
+ * @param enc Encoder state.
+ * @param bin_count Number of bins in one sweep. Max RADAR_FRAME_MAX_BINS.
+ */
+void radar_frame_encoder_init(struct radar_frame_encoder *enc, uint8_t bin_count);
+
+/**
+ * @brief Force the next encoded frame to be a keyframe.
+ *
+ * Should be called whenever a client (re)subscribes, as it has no baseline
+ * to apply delta frames to.
+ *
+ * @param enc Encoder state.
+ */
+void radar_frame_encoder_request_keyframe(struct radar_frame_encoder *enc);
+
+/**
+ * @brief Encode one sweep into a frame.
+ *
+ * Advances the sweep sequence number. If @p delta is set and no keyframe is
+ * due, only bins which moved by at least RADAR_FRAME_DELTA_THRESHOLD_MM are
+ * encoded, unless a dense frame would be smaller.
+ *
+ * @param enc Encoder state.
+ * @param bins_mm Distance of each bin in millimetres. Length enc->bin_count.
+ * @param confidence Confidence of each bin, or NULL to leave confidence out
+ *                   of the frame. Length enc->bin_count.
+ * @param timestamp_ms Time at which the sweep completed.
+ * @param delta Allow delta-only frames.
+ * @param buf Output buffer.
+ * @param size Size of output buffer.
+ * @returns Encoded frame length, or -ENOSPC if the frame does not fit.
+ */
+int radar_frame_encode(struct radar_frame_encoder *enc, const uint16_t *bins_mm,
+                       const uint8_t *confidence, uint32_t timestamp_ms, bool delta, uint8_t *buf, size_t size);
+
+#endif /* RADAR_FRAME_H */
@@ -1,5 +1,11 @@
 #include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/services/bas.h>
 #include "remote.h"
+#include "radar_frame.h"
+#include "stats.h"
+#include "link.h"
 
 #define LOG_MODULE_NAME remote
 LOG_MODULE_REGISTER(LOG_MODULE_NAME);
@@ -11,9 +17,24 @@ static K_SEM_DEFINE(bt_init_ok, 0, 1);
 
 static struct bt_remote_service_cb remote_service_callbacks;
 
+// Drive command state
+static struct drive_rx drive_rx;
+
+// Radar service state. The encoder is owned by the thread sending the sweeps
+static struct bt_conn *radar_conn;
+static struct radar_frame_encoder radar_encoder;
+static uint8_t radar_frame_buf[RADAR_FRAME_MAX_LEN];
+static volatile uint8_t radar_cfg;
+static atomic_t radar_keyframe_wanted;      // Set from the Bluetooth RX context, taken up by the sender
+
+// Stats service state
+static uint8_t stats_buf[STATS_PAYLOAD_LEN];
+BUILD_ASSERT(STATS_PAYLOAD_LEN <= CONFIG_BT_L2CAP_TX_MTU - 3, "Stats must fit in one notification");
+
 static const struct bt_data ad[] = {
     BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
-    BT_DATA(BT_DATA_NAME_COMPLETE, DEVICE_NAME, DEVICE_NAME_LEN)
+    BT_DATA(BT_DATA_NAME_COMPLETE, DEVICE_NAME, DEVICE_NAME_LEN),
+    BT_DATA_BYTES(BT_DATA_UUID16_ALL, BT_UUID_16_ENCODE(BT_UUID_BAS_VAL)),
 };
 
 static const struct bt_data sd[] = {
@@ -22,6 +43,14 @@ static const struct bt_data sd[] = {
 
 /* Declarations */
 static ssize_t on_write(struct bt_conn *conn, const struct bt_gatt_attr *attr, const void *buf, uint16_t len, uint16_t offset, uint8_t flags);
+static ssize_t on_drive_write(struct bt_conn *conn, const struct bt_gatt_attr *attr, const void *buf, uint16_t len, uint16_t offset, uint8_t flags);
+static ssize_t on_safety_write(struct bt_conn *conn, const struct bt_gatt_attr *attr, const void *buf, uint16_t len, uint16_t offset, uint8_t flags);
+static ssize_t on_radar_write(struct bt_conn *conn, const struct bt_gatt_attr *attr, const void *buf, uint16_t len, uint16_t offset, uint8_t flags);
+static ssize_t on_stats_read(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf, uint16_t len, uint16_t offset);
+static ssize_t on_stats_write(struct bt_conn *conn, const struct bt_gatt_attr *attr, const void *buf, uint16_t len, uint16_t offset, uint8_t flags);
+static void on_radar_ccc_changed(const struct bt_gatt_attr *attr, uint16_t value);
+static void on_connected(struct bt_conn *conn, uint8_t err);
+static void on_disconnected(struct bt_conn *conn, uint8_t reason);
 
 // Robot control service
 BT_GATT_SERVICE_DEFINE(remote_srv,
@@ -30,16 +59,51 @@ BT_GATT_SERVICE_DEFINE(remote_srv,
     BT_GATT_CHRC_WRITE_WITHOUT_RESP,
     BT_GATT_PERM_WRITE,
     NULL, on_write, NULL),
+    BT_GATT_CHARACTERISTIC(BT_UUID_REMOTE_DRIVE_CHRC,
+    BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+    BT_GATT_PERM_WRITE,
+    NULL, on_drive_write, NULL),
+    BT_GATT_CHARACTERISTIC(BT_UUID_REMOTE_SAFETY_CHRC,
+    BT_GATT_CHRC_NOTIFY | BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+    BT_GATT_PERM_WRITE,
+    NULL, on_safety_write, NULL),
+    BT_GATT_CCC(NULL, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+    BT_GATT_CHARACTERISTIC(BT_UUID_REMOTE_STATS_CHRC,
+    BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY | BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+    BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+    on_stats_read, on_stats_write, NULL),
+    BT_GATT_CCC(NULL, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
 );
 
+// Safety characteristic value attribute, used for notifications
+#define SAFETY_ATTR (&remote_srv.attrs[6])
+// Stats characteristic value attribute, used for notifications
+#define STATS_ATTR (&remote_srv.attrs[9])
+
 // Radar data service
-// BT_GATT_SERVICE_DEFINE(remote_srv,
-//     BT_GATT_PRIMARY_SERVICE(BT_UUID_DATA_SERVICE),
-//     BT_GATT_CHARACTERISTIC(BT_UUID_REMOTE_RADAR_CHRC,
-//     BT_GATT_CHRC_READ,
-//     BT_GATT_PERM_READ,
-//     NULL, on_read, NULL),
-// );
+BT_GATT_SERVICE_DEFINE(radar_srv,
+    BT_GATT_PRIMARY_SERVICE(BT_UUID_DATA_SERVICE),
+    BT_GATT_CHARACTERISTIC(BT_UUID_REMOTE_RADAR_CHRC,
+    BT_GATT_CHRC_NOTIFY | BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+    BT_GATT_PERM_WRITE,
+    NULL, on_radar_write, NULL),
+    BT_GATT_CCC(on_radar_ccc_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+    BT_GATT_CHARACTERISTIC(BT_UUID_REMOTE_RANGES_CHRC,
+    BT_GATT_CHRC_NOTIFY,
+    BT_GATT_PERM_NONE,
+    NULL, NULL, NULL),
+    BT_GATT_CCC(NULL, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+);
+
+// Radar characteristic value attribute, used for notifications
+#define RADAR_ATTR (&radar_srv.attrs[2])
+// Ranges characteristic value attribute, used for notifications
+#define RANGES_ATTR (&radar_srv.attrs[5])
+
+BT_CONN_CB_DEFINE(remote_conn_callbacks) = {
+    .connected      = on_connected,
+    .disconnected   = on_disconnected,
+};
 
 /* Callbacks */
 void bt_ready(int err)
@@ -66,6 +130,249 @@ static ssize_t on_write(struct bt_conn *conn,
     return len;
 } /* on_write */
 
+static ssize_t on_drive_write(struct bt_conn *conn,
+                              const struct bt_gatt_attr *attr,
+                              const void *buf,
+                              uint16_t len,
+                              uint16_t offset,
+                              uint8_t flags)
+{
+    struct drive_packet pkt;
+    int ret;
+
+    if (offset != 0) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+    ret = drive_packet_decode(&drive_rx, buf, len, &pkt);
+    if (ret == -EINVAL) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+    // Late packets still show the controller is driving, keep the short interval
+    link_activity();
+    // Late packets are acknowledged but ignored, a newer command has already been applied
+    if (ret == 0 && remote_service_callbacks.drive_received) {
+        remote_service_callbacks.drive_received(conn, &pkt);
+    }
+    return len;
+} /* on_drive_write */
+
+static ssize_t on_safety_write(struct bt_conn *conn,
+                               const struct bt_gatt_attr *attr,
+                               const void *buf,
+                               uint16_t len,
+                               uint16_t offset,
+                               uint8_t flags)
+{
+    const uint8_t *data = buf;
+
+    if (offset != 0 || len != 2 * sizeof(uint16_t)) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+    if (remote_service_callbacks.safety_config_received) {
+        remote_service_callbacks.safety_config_received(conn, sys_get_le16(&data[0]), sys_get_le16(&data[2]));
+    }
+    return len;
+} /* on_safety_write */
+
+static ssize_t on_radar_write(struct bt_conn *conn,
+                              const struct bt_gatt_attr *attr,
+                              const void *buf,
+                              uint16_t len,
+                              uint16_t offset,
+                              uint8_t flags)
+{
+    if (offset != 0 || len != 1) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+    radar_cfg = ((const uint8_t *)buf)[0];
+    atomic_set(&radar_keyframe_wanted, 1);
+    LOG_INF("Radar config set to 0x%02x", radar_cfg);
+
+    return len;
+} /* on_radar_write */
+
+static ssize_t on_stats_read(struct bt_conn *conn,
+                             const struct bt_gatt_attr *attr,
+                             void *buf,
+                             uint16_t len,
+                             uint16_t offset)
+{
+    uint8_t payload[STATS_PAYLOAD_LEN];
+    int payload_len = stats_encode(payload, sizeof(payload));
+
+    if (payload_len < 0) {
+        return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+    }
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, payload, payload_len);
+} /* on_stats_read */
+
+static ssize_t on_stats_write(struct bt_conn *conn,
+                              const struct bt_gatt_attr *attr,
+                              const void *buf,
+                              uint16_t len,
+                              uint16_t offset,
+                              uint8_t flags)
+{
+    if (offset != 0 || len != 1) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+    if (((const uint8_t *)buf)[0] != REMOTE_STATS_CMD_RESET) {
+        return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+    stats_reset();
+    LOG_INF("Stats reset");
+
+    return len;
+} /* on_stats_write */
+
+int remote_stats_notify(void)
+{
+    struct bt_conn *conn = radar_conn;
+    int len;
+    int ret;
+
+    if (conn == NULL || !bt_gatt_is_subscribed(conn, STATS_ATTR, BT_GATT_CCC_NOTIFY)) {
+        return -ENOTCONN;
+    }
+
+    len = stats_encode(stats_buf, sizeof(stats_buf));
+    if (len < 0) {
+        return len;
+    }
+    // Clients with a small MTU read the characteristic instead
+    if (len > bt_gatt_get_mtu(conn) - 3) {
+        return -EMSGSIZE;
+    }
+    ret = bt_gatt_notify(conn, STATS_ATTR, stats_buf, len);
+    if (ret) {
+        stats_inc(STATS_NOTIFY_FAILURES);
+    }
+    return ret;
+} /* remote_stats_notify */
+
+static void on_radar_ccc_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    ARG_UNUSED(attr);
+    if (value == BT_GATT_CCC_NOTIFY) {
+        // New subscriber has no baseline to apply delta frames to
+        atomic_set(&radar_keyframe_wanted, 1);
+    }
+    LOG_INF("Radar notifications %s", (value == BT_GATT_CCC_NOTIFY) ? "enabled" : "disabled");
+} /* on_radar_ccc_changed */
+
+// PHY, data length, MTU and connection parameters are negotiated by the link manager
+static void on_connected(struct bt_conn *conn, uint8_t err)
+{
+    if (err) {
+        return;
+    }
+    radar_conn = bt_conn_ref(conn);
+    radar_cfg = 0;
+    drive_rx_reset(&drive_rx);
+} /* on_connected */
+
+static void on_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    ARG_UNUSED(reason);
+    if (radar_conn == conn) {
+        bt_conn_unref(radar_conn);
+        radar_conn = NULL;
+    }
+} /* on_disconnected */
+
+int remote_radar_send_sweep(const uint16_t *bins_mm, const uint8_t *confidence, uint8_t bin_count)
+{
+    struct bt_conn *conn = radar_conn;
+    int len;
+    int ret;
+
+    if (conn == NULL || !bt_gatt_is_subscribed(conn, RADAR_ATTR, BT_GATT_CCC_NOTIFY)) {
+        return -ENOTCONN;
+    }
+    if (radar_encoder.bin_count != bin_count) {
+        radar_frame_encoder_init(&radar_encoder, bin_count);
+    }
+    if (atomic_clear(&radar_keyframe_wanted)) {
+        radar_frame_encoder_request_keyframe(&radar_encoder);
+    }
+
+    // ATT notification header takes 3 bytes of the MTU
+    len = radar_frame_encode(&radar_encoder, bins_mm, confidence, k_uptime_get_32(),
+                             (radar_cfg & REMOTE_RADAR_CFG_DELTA) != 0,
+                             radar_frame_buf, MIN(sizeof(radar_frame_buf), bt_gatt_get_mtu(conn) - 3));
+    if (len < 0) {
+        return -EMSGSIZE;
+    }
+
+    ret = bt_gatt_notify(conn, RADAR_ATTR, radar_frame_buf, len);
+    if (ret) {
+        stats_inc(STATS_NOTIFY_FAILURES);
+    }
+    return ret;
+} /* remote_radar_send_sweep */
+
+int remote_ranges_notify(const int16_t *bearing_deg, const uint16_t *mm, uint8_t count)
+{
+    struct bt_conn *conn = radar_conn;
+    uint8_t buf[5 + 4 * REMOTE_RANGES_MAX];
+    int ret;
+
+    if (count > REMOTE_RANGES_MAX) {
+        return -EINVAL;
+    }
+    if (conn == NULL || !bt_gatt_is_subscribed(conn, RANGES_ATTR, BT_GATT_CCC_NOTIFY)) {
+        return -ENOTCONN;
+    }
+
+    sys_put_le32(k_uptime_get_32(), &buf[0]);
+    buf[4] = count;
+    for (uint8_t i = 0; i < count; i++) {
+        sys_put_le16((uint16_t)bearing_deg[i], &buf[5 + 4 * i]);
+        sys_put_le16(mm[i], &buf[7 + 4 * i]);
+    }
+
+    ret = bt_gatt_notify(conn, RANGES_ATTR, buf, 5 + 4 * count);
+    if (ret) {
+        stats_inc(STATS_NOTIFY_FAILURES);
+    }
+    return ret;
+} /* remote_ranges_notify */
+
+int remote_safety_notify(uint8_t action, uint8_t bin, uint16_t limit, uint16_t range_mm, uint16_t closure_mm_s)
+{
+    struct bt_conn *conn = radar_conn;
+    uint8_t buf[12];
+    int ret;
+
+    if (conn == NULL || !bt_gatt_is_subscribed(conn, SAFETY_ATTR, BT_GATT_CCC_NOTIFY)) {
+        return -ENOTCONN;
+    }
+
+    buf[0] = action;
+    buf[1] = bin;
+    sys_put_le16(limit, &buf[2]);
+    sys_put_le16(range_mm, &buf[4]);
+    sys_put_le16(closure_mm_s, &buf[6]);
+    sys_put_le32(k_uptime_get_32(), &buf[8]);
+
+    ret = bt_gatt_notify(conn, SAFETY_ATTR, buf, sizeof(buf));
+    if (ret) {
+        stats_inc(STATS_NOTIFY_FAILURES);
+    }
+    return ret;
+} /* remote_safety_notify */
+
+int remote_battery_level_set(uint8_t level)
+{
+    // Notifies subscribed clients itself, only when the level changed
+    return bt_bas_set_battery_level(level);
+} /* remote_battery_level_set */
+
+void remote_drive_stats_get(struct drive_rx_stats *stats)
+{
+    *stats = drive_rx.stats;
+} /* remote_drive_stats_get */
+
 
 int bluetooth_init(struct bt_conn_cb *bt_cb, struct bt_remote_service_cb *remote_cb)
 {
@@ -77,6 +384,8 @@ int bluetooth_init(struct bt_conn_cb *bt_cb, struct bt_remote_service_cb *remote
     }
     bt_conn_cb_register(bt_cb);
     remote_service_callbacks.data_received = remote_cb->data_received;
+    remote_service_callbacks.drive_received = remote_cb->drive_received;
+    remote_service_callbacks.safety_config_received = remote_cb->safety_config_received;
 
     err = bt_enable(bt_ready);
     if (err) {
@@ -7,6 +7,8 @@
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/bluetooth/hci.h>
 
+#include "drive_packet.h"
+
 /** @brief UUID of the Remote Service. **/
 #define BT_UUID_REMOTE_SERV_VAL \
 	BT_UUID_128_ENCODE(0xe9ea0001, 0xe19b, 0x482d, 0x9293, 0xc7907585fc48)
@@ -15,22 +17,153 @@
 #define BT_UUID_REMOTE_MESSAGE_CHRC_VAL \
 	BT_UUID_128_ENCODE(0xe9ea0003, 0xe19b, 0x482d, 0x9293, 0xc7907585fc48)
 
-/** @brief UUID of the Radar Characteristic. **/
+/** @brief UUID of the Drive Characteristic. **/
+#define BT_UUID_REMOTE_DRIVE_CHRC_VAL \
+	BT_UUID_128_ENCODE(0xe9ea0004, 0xe19b, 0x482d, 0x9293, 0xc7907585fc48)
+
+/** @brief UUID of the Safety Characteristic. **/
+#define BT_UUID_REMOTE_SAFETY_CHRC_VAL \
+	BT_UUID_128_ENCODE(0xe9ea0005, 0xe19b, 0x482d, 0x9293, 0xc7907585fc48)
+
+/** @brief UUID of the Stats Characteristic. **/
+#define BT_UUID_REMOTE_STATS_CHRC_VAL \
+	BT_UUID_128_ENCODE(0xe9ea0006, 0xe19b, 0x482d, 0x9293, 0xc7907585fc48)
+
+/** @brief UUID of the Radar Service. **/
 #define BT_UUID_REMOTE_RADAR_SERV_VAL \
 	BT_UUID_128_ENCODE(0xe9ea0011, 0xe19b, 0x482d, 0x9293, 0xc7907585fc48)
 
 /** @brief UUID of the Radar Characteristic. **/
 #define BT_UUID_REMOTE_RADAR_CHRC_VAL \
-	BT_UUID_128_ENCODE(0xe9ea00012, 0xe19b, 0x482d, 0x9293, 0xc7907585fc48)
+	BT_UUID_128_ENCODE(0xe9ea0012, 0xe19b, 0x482d, 0x9293, 0xc7907585fc48)
+
+/** @brief UUID of the Ranges Characteristic. **/
+#define BT_UUID_REMOTE_RANGES_CHRC_VAL \
+	BT_UUID_128_ENCODE(0xe9ea0013, 0xe19b, 0x482d, 0x9293, 0xc7907585fc48)
 
 #define BT_UUID_REMOTE_SERVICE          BT_UUID_DECLARE_128(BT_UUID_REMOTE_SERV_VAL)
 #define BT_UUID_REMOTE_MESSAGE_CHRC 	BT_UUID_DECLARE_128(BT_UUID_REMOTE_MESSAGE_CHRC_VAL)
+#define BT_UUID_REMOTE_DRIVE_CHRC       BT_UUID_DECLARE_128(BT_UUID_REMOTE_DRIVE_CHRC_VAL)
+#define BT_UUID_REMOTE_SAFETY_CHRC      BT_UUID_DECLARE_128(BT_UUID_REMOTE_SAFETY_CHRC_VAL)
+#define BT_UUID_REMOTE_STATS_CHRC       BT_UUID_DECLARE_128(BT_UUID_REMOTE_STATS_CHRC_VAL)
 
 #define BT_UUID_DATA_SERVICE			BT_UUID_DECLARE_128(BT_UUID_REMOTE_RADAR_SERV_VAL)
 #define BT_UUID_REMOTE_RADAR_CHRC		BT_UUID_DECLARE_128(BT_UUID_REMOTE_RADAR_CHRC_VAL)
+#define BT_UUID_REMOTE_RANGES_CHRC		BT_UUID_DECLARE_128(BT_UUID_REMOTE_RANGES_CHRC_VAL)
+
+/** @brief Radar client configuration bit: allow delta-only frames. **/
+#define REMOTE_RADAR_CFG_DELTA          BIT(0)
+
+/** @brief Most fixed sensors in one ranges notification. **/
+#define REMOTE_RANGES_MAX               8
+
+/** @brief Stats command: clear all counters and histograms. **/
+#define REMOTE_STATS_CMD_RESET          0x01
+
 
 struct bt_remote_service_cb {
     void (*data_received)(struct bt_conn *conn, const uint8_t *const data, uint16_t len);
+    void (*drive_received)(struct bt_conn *conn, const struct drive_packet *pkt);
+    void (*safety_config_received)(struct bt_conn *conn, uint16_t stop_mm, uint16_t slow_mm);
 };
 
 int bluetooth_init(struct bt_conn_cb *bt_cb, struct bt_remote_service_cb *remote_cb);
+
+/**
+ * @brief Notify a completed radar sweep to the subscribed client.
+ *
+ * The sweep is packed into a single binary frame (see radar_frame.h). Delta-only
+ * frames are sent if the client enabled them by writing REMOTE_RADAR_CFG_DELTA
+ * to the radar characteristic.
+ * Must be called from one thread only, which owns the frame encoder.
+ *
+ * @param bins_mm Distance of each bin in millimetres.
+ * @param confidence Confidence of each bin, 0 to 255, or NULL if not known.
+ * @param bin_count Number of bins in the sweep.
+ * @retval 0 if successful.
+ * @retval -ENOTCONN if no client is subscribed.
+ * @retval -EMSGSIZE if the frame does not fit in the negotiated ATT MTU.
+ */
+int remote_radar_send_sweep(const uint16_t *bins_mm, const uint8_t *confidence, uint8_t bin_count);
+
+/**
+ * @brief Notify the latest readings of the fixed sensors to the subscribed client.
+ *
+ * Notification layout (little-endian, packed):
+ *
+ *   | timestamp_ms | count | sensor * count |
+ *   |     u32      |  u8   |                |
+ *
+ * with each sensor as
+ *
+ *   | bearing_deg | mm  |
+ *   |     i16     | u16 |
+ *
+ * The bearing is counter-clockwise from straight ahead. The distance is
+ * 0xFFFF for no return within range and 0xFFFE for a failed measurement.
+ *
+ * @param bearing_deg Bearing of each sensor.
+ * @param mm Latest distance of each sensor.
+ * @param count Number of sensors. Max REMOTE_RANGES_MAX.
+ * @retval 0 if successful.
+ * @retval -ENOTCONN if no client is subscribed.
+ * @retval -EINVAL if there are too many sensors.
+ */
+int remote_ranges_notify(const int16_t *bearing_deg, const uint16_t *mm, uint8_t count);
+
+/**
+ * @brief Get drive packet receive statistics for the current connection.
+ *
+ * @param[out] stats Statistics.
+ */
+void remote_drive_stats_get(struct drive_rx_stats *stats);
+
+/**
+ * @brief Notify an obstacle avoidance intervention to the subscribed client.
+ *
+ * Notification layout (little-endian, packed):
+ *
+ *   | action | bin | limit | range_mm | closure_mm_s | timestamp_ms |
+ *   |   u8   | u8  |  u16  |   u16    |     u16      |     u32      |
+ *
+ * A bin below the bin_count of the radar frames is the scan bin the swept
+ * sensor saw the obstacle in. A bin of bin_count or more comes from fixed
+ * sensor bin - bin_count instead, see SAFETY_SENSOR_BIN(). The swept sensor
+ * is sensor 0, so that is entry bin - bin_count - 1 of the ranges
+ * notification. Such a bin is not a radar bin and must not index them.
+ *
+ * The client sets the stop and slow down distances by writing u16 stop_mm
+ * and u16 slow_mm to the same characteristic.
+ *
+ * @param action Intervention, 0 for clear, 1 for slow down, 2 for stop.
+ * @param bin Scan bin of the obstacle, or SAFETY_SENSOR_BIN() of the fixed sensor which saw it.
+ * @param limit Forward limit in per mille of commanded speed.
+ * @param range_mm Range of the obstacle.
+ * @param closure_mm_s Rate of closure with the obstacle.
+ * @retval 0 if successful.
+ * @retval -ENOTCONN if no client is subscribed.
+ */
+int remote_safety_notify(uint8_t action, uint8_t bin, uint16_t limit, uint16_t range_mm, uint16_t closure_mm_s);
+
+/**
+ * @brief Set the level of the standard Battery Service.
+ *
+ * Subscribed clients are notified if the level changed.
+ *
+ * @param level State of charge in percent.
+ * @retval 0 if successful.
+ * @retval Negative error code from the Battery Service otherwise.
+ */
+int remote_battery_level_set(uint8_t level);
+
+/**
+ * @brief Notify the runtime statistics to the subscribed client.
+ *
+ * The payload layout is described in stats.h. Called once per telemetry
+ * period.
+ *
+ * @retval 0 if successful.
+ * @retval -ENOTCONN if no client is subscribed.
+ * @retval -EMSGSIZE if the payload does not fit in the negotiated ATT MTU.
+ */
+int remote_stats_notify(void);
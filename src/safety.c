@@ -0,0 +1,222 @@
+/**
+ * @file safety.c
+ * @brief Source file for the obstacle avoidance reflex
+ */
+
+#include "safety.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/logging/log.h>
+#include "radar_bx.h"
+#include "motor.h"
+#include "libs/ultrasonic_hc-sr04.h"
+
+#define LOG_MODULE_NAME safety
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+// Stop and slow down distances packed into one word so they always change together
+#define CONFIG_PACK(stop_mm, slow_mm)   (((uint32_t)(stop_mm) << 16) | (slow_mm))
+#define CONFIG_STOP_MM(cfg)             ((uint16_t)((uint32_t)(cfg) >> 16))
+#define CONFIG_SLOW_MM(cfg)             ((uint16_t)(cfg))
+
+struct bin_range {
+    uint32_t timestamp_ms;
+    uint16_t mm;
+    uint16_t closure_mm_s;
+    bool valid;
+    bool faulted;               // Latest sample failed, the range is from the last good one
+};
+
+static uint16_t project(const struct bin_range *range);
+static uint16_t limit_for(uint16_t projected_mm, uint32_t cfg);
+static void range_update(struct bin_range *range, uint16_t mm, uint32_t timestamp_ms);
+static bool limit_update(uint8_t updated, uint32_t timestamp_ms, struct safety_event *event);
+
+static atomic_t config = ATOMIC_INIT(CONFIG_PACK(SAFETY_STOP_MM_DEFAULT, SAFETY_SLOW_MM_DEFAULT));
+
+// Owned by the ranging task. The scan bins, then one slot per fixed sensor
+static struct bin_range ranges[RADAR_SCAN_BINS + SAFETY_SENSORS_MAX];
+static uint8_t sector_first;
+static uint8_t sector_last;
+static enum safety_action action;
+
+void safety_init(void)
+{
+    const int32_t fov_mdeg = RADAR_FOV_DEG * 1000;
+    int32_t bearing_mdeg;
+
+    // Bins are ordered left to right, so the sector is a contiguous run
+    sector_first = RADAR_SCAN_BINS;
+    sector_last = 0;
+    for (uint8_t i = 0; i < RADAR_SCAN_BINS; i++)
+    {
+        bearing_mdeg = fov_mdeg / 2 - ((2 * i + 1) * fov_mdeg) / (2 * RADAR_SCAN_BINS);
+        if (bearing_mdeg <= SAFETY_SECTOR_DEG * 1000 && bearing_mdeg >= -SAFETY_SECTOR_DEG * 1000)
+        {
+            sector_first = MIN(sector_first, i);
+            sector_last = MAX(sector_last, i);
+        }
+    }
+
+    safety_reset();
+} /* safety_init */
+
+void safety_reset(void)
+{
+    memset(ranges, 0, sizeof(ranges));
+    action = SAFETY_CLEAR;
+    motor_forward_limit_set(MOTOR_FORWARD_LIMIT_NONE);
+} /* safety_reset */
+
+int safety_config_set(uint16_t stop_mm, uint16_t slow_mm)
+{
+    if (slow_mm <= stop_mm)
+    {
+        return -EINVAL;
+    }
+    atomic_set(&config, CONFIG_PACK(stop_mm, slow_mm));
+    LOG_INF("Stop at %u mm, slow down from %u mm", stop_mm, slow_mm);
+
+    return 0;
+} /* safety_config_set */
+
+// Range expected after SAFETY_LOOKAHEAD_MS at the current rate of closure. Only
+// a real no return projects clear, a fault never gets this far
+static uint16_t project(const struct bin_range *range)
+{
+    uint32_t travel_mm = ((uint32_t)range->closure_mm_s * SAFETY_LOOKAHEAD_MS) / 1000U;
+
+    if (range->mm == HC_SR04_NO_RETURN_MM)
+    {
+        return HC_SR04_NO_RETURN_MM;
+    }
+    return (range->mm > travel_mm) ? (range->mm - travel_mm) : 0;
+} /* project */
+
+static uint16_t limit_for(uint16_t projected_mm, uint32_t cfg)
+{
+    uint16_t stop_mm = CONFIG_STOP_MM(cfg);
+    uint16_t slow_mm = CONFIG_SLOW_MM(cfg);
+
+    if (projected_mm <= stop_mm)
+    {
+        return 0;
+    }
+    if (projected_mm >= slow_mm)
+    {
+        return MOTOR_FORWARD_LIMIT_NONE;
+    }
+    return ((uint32_t)(projected_mm - stop_mm) * MOTOR_FORWARD_LIMIT_NONE) / (slow_mm - stop_mm);
+} /* limit_for */
+
+// Record a sample in its slot. A fault says nothing about the range, so the slot keeps its last good range and closure
+static void range_update(struct bin_range *range, uint16_t mm, uint32_t timestamp_ms)
+{
+    uint32_t dt_ms;
+
+    if (mm == HC_SR04_FAULT_MM)
+    {
+        range->faulted = true;
+        return;
+    }
+
+    // Rate of closure against the previous sample in this slot
+    dt_ms = timestamp_ms - range->timestamp_ms;
+    range->closure_mm_s = 0;
+    if (range->valid && dt_ms > 0 && dt_ms <= SAFETY_RANGE_MAX_AGE_MS &&
+        range->mm != HC_SR04_NO_RETURN_MM && mm != HC_SR04_NO_RETURN_MM && mm < range->mm)
+    {
+        range->closure_mm_s = MIN(((uint32_t)(range->mm - mm) * 1000U) / dt_ms, SAFETY_CLOSURE_MAX_MM_S);
+    }
+    range->mm = mm;
+    range->timestamp_ms = timestamp_ms;
+    range->valid = true;
+    range->faulted = false;
+} /* range_update */
+
+// Set the forward limit from the nearest projected range of the forward bins and sensors
+static bool limit_update(uint8_t updated, uint32_t timestamp_ms, struct safety_event *event)
+{
+    uint32_t cfg = atomic_get(&config);
+    uint16_t nearest_mm = HC_SR04_NO_RETURN_MM;
+    uint8_t nearest = updated;
+    bool nearest_faulted = false;
+    enum safety_action new_action;
+    uint16_t projected;
+    uint16_t limit;
+    bool stale;
+
+    // The forward bins, then the sensor slots. Sensors facing elsewhere are never updated
+    for (uint8_t i = sector_first; i < ARRAY_SIZE(ranges); i = (i == sector_last) ? RADAR_SCAN_BINS : i + 1)
+    {
+        stale = !ranges[i].valid || (timestamp_ms - ranges[i].timestamp_ms) > SAFETY_RANGE_MAX_AGE_MS;
+        if (stale && !ranges[i].faulted)
+        {
+            continue;
+        }
+        // Nothing but faults from this slot for too long, assume an obstacle right ahead
+        projected = stale ? 0 : project(&ranges[i]);
+        if (projected < nearest_mm)
+        {
+            nearest_mm = projected;
+            nearest = i;
+            nearest_faulted = stale;
+        }
+    }
+
+    limit = limit_for(nearest_mm, cfg);
+    motor_forward_limit_set(limit);
+
+    if (limit == 0)
+    {
+        new_action = SAFETY_STOP;
+    }
+    else if (limit < MOTOR_FORWARD_LIMIT_NONE)
+    {
+        new_action = SAFETY_SLOW;
+    }
+    else
+    {
+        new_action = SAFETY_CLEAR;
+    }
+    if (new_action == action)
+    {
+        return false;
+    }
+
+    action = new_action;
+    event->action = action;
+    event->bin = nearest;
+    event->limit = limit;
+    event->range_mm = nearest_faulted ? HC_SR04_FAULT_MM : ranges[nearest].mm;
+    event->closure_mm_s = ranges[nearest].closure_mm_s;
+    LOG_INF("Forward limit %u/%u, %u mm closing at %u mm/s in bin %u", limit, MOTOR_FORWARD_LIMIT_NONE,
+            event->range_mm, event->closure_mm_s, nearest);
+
+    return true;
+} /* limit_update */
+
+bool safety_range_update(uint8_t bin, uint16_t mm, uint32_t timestamp_ms, struct safety_event *event)
+{
+    if (bin < sector_first || bin > sector_last)
+    {
+        return false;
+    }
+    range_update(&ranges[bin], mm, timestamp_ms);
+
+    return limit_update(bin, timestamp_ms, event);
+} /* safety_range_update */
+
+bool safety_sensor_update(uint8_t sensor, int16_t bearing_deg, uint16_t mm, uint32_t timestamp_ms,
+                          struct safety_event *event)
+{
+    if (sensor >= SAFETY_SENSORS_MAX || bearing_deg > SAFETY_SECTOR_DEG || bearing_deg < -SAFETY_SECTOR_DEG)
+    {
+        return false;
+    }
+    range_update(&ranges[SAFETY_SENSOR_BIN(sensor)], mm, timestamp_ms);
+
+    return limit_update(SAFETY_SENSOR_BIN(sensor), timestamp_ms, event);
+} /* safety_sensor_update */
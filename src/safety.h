@@ -0,0 +1,110 @@
+/**
+ * @file safety.h
+ * @brief Header file for the obstacle avoidance reflex
+ *
+ * Every ranging sample from the forward sector of the scan updates the
+ * forward speed limit of the motor thread directly, so the reaction to an
+ * obstacle takes one ranging cycle rather than a round trip through the
+ * controller app and its operator.
+ *
+ * Each forward bin projects its latest range SAFETY_LOOKAHEAD_MS ahead using
+ * its rate of closure since the previous sweep. The nearest projected range
+ * sets the limit: full speed beyond the slow down distance, no forward motion
+ * inside the stop distance, and a linear ramp in between.
+ *
+ * Fixed sensors facing within SAFETY_SECTOR_DEG of straight ahead count
+ * alongside the forward bins, each as a slot of its own. Sensors facing
+ * elsewhere are ignored, as only forward motion is limited.
+ *
+ * Only a real no return counts as clear. A failed measurement keeps the last
+ * good range of its bin, and a bin with nothing but failures for
+ * SAFETY_RANGE_MAX_AGE_MS vetoes forward motion.
+ */
+
+#ifndef SAFETY_H
+#define SAFETY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "radar_bx.h"
+
+#define SAFETY_STOP_MM_DEFAULT      200
+#define SAFETY_SLOW_MM_DEFAULT      600
+#define SAFETY_SECTOR_DEG           20      // Bins within this angle either side of straight ahead are checked
+#define SAFETY_LOOKAHEAD_MS         300     // Time to project closure over, about one sweep plus stopping time
+#define SAFETY_RANGE_MAX_AGE_MS     1600    // Older ranges are ignored, a bin is revisited within one sweep there and back
+#define SAFETY_CLOSURE_MAX_MM_S     3000    // Faster closure is treated as a measurement glitch
+#define SAFETY_SENSORS_MAX          8       // Fixed sensors, indexed as the ranging sensors
+
+/* Bin reported in a safety_event for a fixed sensor */
+#define SAFETY_SENSOR_BIN(sensor)   (RADAR_SCAN_BINS + (sensor))
+
+enum safety_action {
+    SAFETY_CLEAR = 0,
+    SAFETY_SLOW = 1,
+    SAFETY_STOP = 2,
+};
+
+struct safety_event {
+    enum safety_action action;
+    uint8_t bin;                // Bin of the nearest projected obstacle, or SAFETY_SENSOR_BIN()
+    uint16_t limit;             // Forward limit, per mille of commanded speed
+    uint16_t range_mm;          // Measured range in that bin
+    uint16_t closure_mm_s;      // Rate of closure in that bin
+};
+
+/**
+ * @brief Initialise obstacle avoidance and lift any forward limit.
+ */
+void safety_init(void);
+
+/**
+ * @brief Forget all ranges and lift any forward limit.
+ *
+ * For when ranging stops, so a stale limit does not outlive the samples it
+ * came from. Must not run concurrently with safety_range_update().
+ */
+void safety_reset(void);
+
+/**
+ * @brief Set the stop and slow down distances.
+ *
+ * @param stop_mm Forward motion is vetoed at or inside this projected range.
+ * @param slow_mm Forward motion is limited inside this projected range.
+ * @retval 0 if successful.
+ * @retval -EINVAL if the slow down distance is not beyond the stop distance.
+ */
+int safety_config_set(uint16_t stop_mm, uint16_t slow_mm);
+
+/**
+ * @brief Update obstacle avoidance with a new ranging sample.
+ *
+ * Sets the motor forward limit. Must be called from one thread only.
+ *
+ * @param bin Scan bin of the sample.
+ * @param mm Measured distance, HC_SR04_NO_RETURN_MM or HC_SR04_FAULT_MM.
+ * @param timestamp_ms Time of the sample.
+ * @param[out] event Intervention state, filled in when it changed. Its range
+ *                   is HC_SR04_FAULT_MM for a veto caused by failures.
+ * @retval true if the intervention started, changed action or ended.
+ * @retval false otherwise.
+ */
+bool safety_range_update(uint8_t bin, uint16_t mm, uint32_t timestamp_ms, struct safety_event *event);
+
+/**
+ * @brief Update obstacle avoidance with a sample from a fixed sensor.
+ *
+ * Must be called from the thread calling safety_range_update().
+ *
+ * @param sensor Index of the sensor, below SAFETY_SENSORS_MAX.
+ * @param bearing_deg Bearing of the sensor axis, counter-clockwise from straight ahead.
+ * @param mm Measured distance, HC_SR04_NO_RETURN_MM or HC_SR04_FAULT_MM.
+ * @param timestamp_ms Time of the sample.
+ * @param[out] event As for safety_range_update().
+ * @retval true if the intervention started, changed action or ended.
+ * @retval false otherwise, or if the sensor does not face forward.
+ */
+bool safety_sensor_update(uint8_t sensor, int16_t bearing_deg, uint16_t mm, uint32_t timestamp_ms,
+                          struct safety_event *event);
+
+#endif /* SAFETY_H */
@@ -0,0 +1,37 @@
+/**
+ * @file battery_sim.c
+ * @brief Source file for the battery ADC stub of the simulation build
+ *
+ * Replaces the SAADC backend, which needs the nRF peripherals. Hands over
+ * a battery which starts full and drains by SIM_BATTERY_DRAIN_MV per buffer,
+ * at the rate the real backend completes buffers, so the hysteresis and the
+ * reports can be watched in the log.
+ */
+
+#include <zephyr/kernel.h>
+#include "battery.h"
+
+#define SIM_BATTERY_DRAIN_MV    5
+
+static void sim_battery_expiry(struct k_timer *timer);
+
+static K_TIMER_DEFINE(sim_battery_timer, sim_battery_expiry, NULL);
+static uint16_t sim_battery_mv = BATTERY_FULL_MV;
+
+static void sim_battery_expiry(struct k_timer *timer)
+{
+    ARG_UNUSED(timer);
+    battery_adc_done(sim_battery_mv);
+    if (sim_battery_mv > BATTERY_EMPTY_MV)
+    {
+        sim_battery_mv -= SIM_BATTERY_DRAIN_MV;
+    }
+} /* sim_battery_expiry */
+
+int battery_adc_start(void)
+{
+    const k_timeout_t period = K_MSEC(BATTERY_SAMPLE_PERIOD_MS * BATTERY_BUFFER_SAMPLES);
+
+    k_timer_start(&sim_battery_timer, period, period);
+    return 0;
+} /* battery_adc_start */
@@ -0,0 +1,34 @@
+/**
+ * @file dk_sim.c
+ * @brief Source file for the LED stubs of the simulation build
+ *
+ * Replaces the DK buttons and LEDs library, which needs the board's LED
+ * nodes. LED changes are only logged.
+ */
+
+#include <dk_buttons_and_leds.h>
+#include <zephyr/logging/log.h>
+
+#define LOG_MODULE_NAME dk_sim
+LOG_MODULE_REGISTER(LOG_MODULE_NAME, LOG_LEVEL_WRN);
+
+int dk_leds_init(void)
+{
+    return 0;
+} /* dk_leds_init */
+
+int dk_set_led(uint8_t led_idx, uint32_t val)
+{
+    LOG_DBG("LED %u %s", led_idx, val ? "on" : "off");
+    return 0;
+} /* dk_set_led */
+
+int dk_set_led_on(uint8_t led_idx)
+{
+    return dk_set_led(led_idx, 1);
+} /* dk_set_led_on */
+
+int dk_set_led_off(uint8_t led_idx)
+{
+    return dk_set_led(led_idx, 0);
+} /* dk_set_led_off */
@@ -0,0 +1,55 @@
+/**
+ * @file dot_matrix_sim.c
+ * @brief Source file for the dot matrix stub of the simulation build
+ *
+ * Replaces the MAX7219 driver, which needs the SPI bus. A flush copies the
+ * dirty rows to a simulated matrix and completes at once.
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "dot_matrix/dot_matrix.h"
+
+#define LOG_MODULE_NAME dot_matrix_sim
+LOG_MODULE_REGISTER(LOG_MODULE_NAME, LOG_LEVEL_WRN);
+
+static uint8_t frame[DOT_MATRIX_ROWS];
+static uint8_t shown[DOT_MATRIX_ROWS];
+static uint8_t dirty;
+
+int dot_matrix_init(void)
+{
+    memset(frame, 0, sizeof(frame));
+    dirty = BIT_MASK(DOT_MATRIX_ROWS);
+    return dot_matrix_flush(NULL);
+} /* dot_matrix_init */
+
+void dot_matrix_row_set(uint8_t row, uint8_t bits)
+{
+    if (row >= DOT_MATRIX_ROWS || frame[row] == bits)
+    {
+        return;
+    }
+    frame[row] = bits;
+    dirty |= BIT(row);
+} /* dot_matrix_row_set */
+
+int dot_matrix_flush(struct k_poll_signal *done)
+{
+    for (uint8_t row = 0; row < DOT_MATRIX_ROWS; row++)
+    {
+        if (dirty & BIT(row))
+        {
+            shown[row] = frame[row];
+            LOG_DBG("Row %u %02x", row, shown[row]);
+        }
+    }
+    dirty = 0;
+
+    if (done != NULL)
+    {
+        k_poll_signal_raise(done, 0);
+    }
+    return 0;
+} /* dot_matrix_flush */
@@ -0,0 +1,226 @@
+/**
+ * @file hc_sr04_model.c
+ * @brief Source file for the emulated HC-SR04 of the simulation build
+ *
+ * Answers each trigger pulse of every sensor in the devicetree by driving
+ * its echo pin on the emulated GPIO port. The echo width is the round trip
+ * time to the nearest obstacle of the scenario within the beam at the
+ * sensor's bearing, or the 38 ms the sensor gives when nothing reflects.
+ * The bearing is the sensor's mounting angle, plus the bearing the radar
+ * servo is set to for the sensor on the servo.
+ *
+ * The bearing and the robot's travel are read back from the captured PWM
+ * output, so the model follows whatever the firmware actually commanded.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/logging/log.h>
+#include "libs/ultrasonic_hc-sr04.h"
+#include "libs/ultrasonic_hc-sr04_emul.h"
+#include "pwm_capture_emul.h"
+#include "radar_bx.h"
+#include "motor.h"
+#include "scenario.h"
+
+#define LOG_MODULE_NAME hc_sr04_model
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+#define ECHO_DELAY_US       450     // Trigger to echo rising edge while the burst is sent
+#define BEAM_WIDTH_DEG      15      // Full angle of the sensor's beam
+#define RANGE_MAX_MM        4000    // Beyond this the echo is too weak to detect
+#define RANGE_MIN_MM        20
+#define NOISE_MM            4       // Peak random error of a return
+
+struct model_sensor {
+    const struct device *dev;
+    struct gpio_dt_spec echo;
+    struct k_timer rise_timer;
+    struct k_timer fall_timer;
+    uint32_t echo_us;
+};
+
+static void echo_rise(struct k_timer *timer);
+static void echo_fall(struct k_timer *timer);
+
+#define MODEL_SENSOR(node_id)                           \
+    {                                                   \
+        .dev = DEVICE_DT_GET(node_id),                  \
+        .echo = GPIO_DT_SPEC_GET(node_id, echo_gpios),  \
+    },
+
+static struct model_sensor sensors[] = {
+    DT_FOREACH_STATUS_OKAY(hc_sr04, MODEL_SENSOR)
+};
+static const struct device *swept_sensor = DEVICE_DT_GET(DT_NODELABEL(ultrasonic_f));
+static const struct pwm_dt_spec servo = PWM_DT_SPEC_GET(DT_NODELABEL(motor_f));
+static const struct pwm_dt_spec motors_l = PWM_DT_SPEC_GET(DT_NODELABEL(motors_l));
+static const struct pwm_dt_spec motors_r = PWM_DT_SPEC_GET(DT_NODELABEL(motors_r));
+static const uint32_t MIN_PULSE_F = DT_PROP(DT_NODELABEL(motor_f), min_pulse);
+static const uint32_t MAX_PULSE_F = DT_PROP(DT_NODELABEL(motor_f), max_pulse);
+
+// Robot position along its line of travel, updated on each trigger
+static int32_t travel_um;
+static int64_t travel_ticks;
+static uint32_t last_scenario_ms;
+static uint32_t noise_state = 1;
+static int32_t bearing_mdeg;
+
+static int32_t servo_bearing_mdeg(void)
+{
+    int32_t pulse_ns = pwm_capture_emul_pulse_get(&servo);
+    int32_t mid_ns = (MIN_PULSE_F + MAX_PULSE_F) / 2;
+
+    // A parked servo gets no pulses and stays where it was
+    if (pulse_ns != 0)
+    {
+        // The longest pulse points to the left hand end of the scan
+        bearing_mdeg = ((int64_t)(pulse_ns - mid_ns) * RADAR_FOV_DEG * 1000) / (int32_t)(MAX_PULSE_F - MIN_PULSE_F);
+    }
+    return bearing_mdeg;
+} /* servo_bearing_mdeg */
+
+// Speed of a drive servo as an offset from the stop pulse. A parked servo gets no pulses and stands still
+static int32_t drive_us(const struct pwm_dt_spec *spec)
+{
+    int32_t pulse_ns = pwm_capture_emul_pulse_get(spec);
+
+    return (pulse_ns == 0) ? 0 : pulse_ns / 1000 - MOTOR_STOP_US;
+} /* drive_us */
+
+static void travel_update(uint32_t scenario_ms)
+{
+    int64_t now = k_uptime_ticks();
+    int32_t left_us = drive_us(&motors_l);
+    int32_t right_us = drive_us(&motors_r);
+    int32_t speed_mm_s = ((left_us + right_us) / 2) * SIM_MM_S_PER_US;
+
+    // Back to the start position each time the scenario loops
+    if (scenario_ms < last_scenario_ms)
+    {
+        travel_um = 0;
+    }
+    else
+    {
+        travel_um += (int32_t)((speed_mm_s * (int64_t)k_ticks_to_us_floor64(now - travel_ticks)) / 1000);
+    }
+    last_scenario_ms = scenario_ms;
+    travel_ticks = now;
+} /* travel_update */
+
+static int32_t noise_mm(void)
+{
+    noise_state = noise_state * 1103515245U + 12345U;
+    return (int32_t)((noise_state >> 16) % (2 * NOISE_MM + 1)) - NOISE_MM;
+} /* noise_mm */
+
+static uint32_t range_mm(uint32_t scenario_ms, int32_t bearing_mdeg)
+{
+    uint32_t nearest_mm = RANGE_MAX_MM;
+    int32_t half_mdeg;
+    int32_t travel_mm;
+    int32_t mm;
+
+    for (size_t i = 0; i < sim_scene_len; i++)
+    {
+        const struct sim_obstacle *ob = &sim_scene[i];
+
+        if (scenario_ms < ob->from_ms || scenario_ms >= ob->to_ms)
+        {
+            continue;
+        }
+        half_mdeg = (ob->width_deg + BEAM_WIDTH_DEG) * 1000 / 2;
+        if (bearing_mdeg < ob->bearing_deg * 1000 - half_mdeg || bearing_mdeg > ob->bearing_deg * 1000 + half_mdeg)
+        {
+            continue;
+        }
+        // Driving forwards closes on obstacles ahead and opens up those behind
+        travel_mm = (ob->bearing_deg > 90 || ob->bearing_deg < -90) ? -travel_um / 1000 : travel_um / 1000;
+        mm = MAX((int32_t)ob->range_mm - travel_mm, RANGE_MIN_MM);
+        nearest_mm = MIN(nearest_mm, (uint32_t)mm);
+    }
+    return nearest_mm;
+} /* range_mm */
+
+static void echo_rise(struct k_timer *timer)
+{
+    struct model_sensor *ms = k_timer_user_data_get(timer);
+
+    gpio_emul_input_set(ms->echo.port, ms->echo.pin, 1);
+    k_timer_start(&ms->fall_timer, K_USEC(ms->echo_us), K_NO_WAIT);
+} /* echo_rise */
+
+static void echo_fall(struct k_timer *timer)
+{
+    struct model_sensor *ms = k_timer_user_data_get(timer);
+
+    gpio_emul_input_set(ms->echo.port, ms->echo.pin, 0);
+} /* echo_fall */
+
+static void on_trigger(const struct device *dev)
+{
+    uint32_t scenario_ms = sim_scenario_time_ms();
+    struct model_sensor *ms = NULL;
+    int32_t bearing;
+    uint32_t mm;
+
+    for (size_t i = 0; i < ARRAY_SIZE(sensors); i++)
+    {
+        if (sensors[i].dev == dev)
+        {
+            ms = &sensors[i];
+        }
+    }
+    if (ms == NULL)
+    {
+        return;
+    }
+
+    travel_update(scenario_ms);
+    bearing = hc_sr04_mount_angle_get(dev) * 1000;
+    if (dev == swept_sensor)
+    {
+        bearing += servo_bearing_mdeg();
+    }
+    mm = range_mm(scenario_ms, bearing);
+    if (mm >= RANGE_MAX_MM)
+    {
+        ms->echo_us = HC_SR04_ECHO_MAX_US;
+    }
+    else
+    {
+        ms->echo_us = HC_SR04_MM_TO_US(mm + noise_mm());
+    }
+    k_timer_start(&ms->rise_timer, K_USEC(ECHO_DELAY_US), K_NO_WAIT);
+} /* on_trigger */
+
+static int hc_sr04_model_init(const struct device *dev)
+{
+    ARG_UNUSED(dev);
+
+    travel_ticks = k_uptime_ticks();
+    for (size_t i = 0; i < ARRAY_SIZE(sensors); i++)
+    {
+        struct model_sensor *ms = &sensors[i];
+
+        if (!device_is_ready(ms->dev) || !device_is_ready(ms->echo.port))
+        {
+            LOG_ERR("Emulated sensor %s not ready", ms->dev->name);
+            return -ENODEV;
+        }
+        k_timer_init(&ms->rise_timer, echo_rise, NULL);
+        k_timer_user_data_set(&ms->rise_timer, ms);
+        k_timer_init(&ms->fall_timer, echo_fall, NULL);
+        k_timer_user_data_set(&ms->fall_timer, ms);
+        hc_sr04_emul_trigger_cb_set(ms->dev, on_trigger);
+    }
+    LOG_INF("HC-SR04 model running %u sensors, %u obstacle scene", (unsigned int)ARRAY_SIZE(sensors),
+            (unsigned int)sim_scene_len);
+
+    return 0;
+} /* hc_sr04_model_init */
+
+SYS_INIT(hc_sr04_model_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
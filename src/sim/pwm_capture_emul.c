@@ -0,0 +1,115 @@
+/**
+ * @file pwm_capture_emul.c
+ * @brief Source file for the emulated PWM controller
+ */
+
+#define DT_DRV_COMPAT pwm_capture_emul
+
+#include "pwm_capture_emul.h"
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(pwm_capture_emul, CONFIG_PWM_LOG_LEVEL);
+
+struct pwm_capture_emul_config {
+    uint32_t channel_count;
+};
+
+struct pwm_capture_emul_data {
+    struct k_spinlock lock;
+    struct pwm_capture_emul_channel *channels;
+};
+
+static int pwm_capture_emul_set_cycles(const struct device *dev, uint32_t channel,
+                                       uint32_t period_cycles, uint32_t pulse_cycles,
+                                       pwm_flags_t flags)
+{
+    const struct pwm_capture_emul_config *cfg = dev->config;
+    struct pwm_capture_emul_data *data = dev->data;
+    struct pwm_capture_emul_channel *ch;
+    k_spinlock_key_t key;
+
+    if (channel >= cfg->channel_count || pulse_cycles > period_cycles)
+    {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&data->lock);
+    ch = &data->channels[channel];
+    if (ch->period_ns != period_cycles || ch->pulse_ns != pulse_cycles)
+    {
+        ch->updated_ticks = k_uptime_ticks();
+    }
+    ch->period_ns = period_cycles;
+    ch->pulse_ns = pulse_cycles;
+    ch->flags = flags;
+    ch->updates++;
+    k_spin_unlock(&data->lock, key);
+
+    LOG_DBG("%s ch %u: %u/%u ns", dev->name, channel, pulse_cycles, period_cycles);
+
+    return 0;
+} /* pwm_capture_emul_set_cycles */
+
+static int pwm_capture_emul_get_cycles_per_sec(const struct device *dev, uint32_t channel,
+                                               uint64_t *cycles)
+{
+    const struct pwm_capture_emul_config *cfg = dev->config;
+
+    if (channel >= cfg->channel_count)
+    {
+        return -EINVAL;
+    }
+    *cycles = NSEC_PER_SEC;
+
+    return 0;
+} /* pwm_capture_emul_get_cycles_per_sec */
+
+int pwm_capture_emul_channel_get(const struct device *dev, uint32_t channel,
+                                 struct pwm_capture_emul_channel *capture)
+{
+    const struct pwm_capture_emul_config *cfg = dev->config;
+    struct pwm_capture_emul_data *data = dev->data;
+    k_spinlock_key_t key;
+
+    if (channel >= cfg->channel_count)
+    {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&data->lock);
+    *capture = data->channels[channel];
+    k_spin_unlock(&data->lock, key);
+
+    return 0;
+} /* pwm_capture_emul_channel_get */
+
+static int pwm_capture_emul_init(const struct device *dev)
+{
+    ARG_UNUSED(dev);
+
+    return 0;
+} /* pwm_capture_emul_init */
+
+static const struct pwm_driver_api pwm_capture_emul_api = {
+    .set_cycles = pwm_capture_emul_set_cycles,
+    .get_cycles_per_sec = pwm_capture_emul_get_cycles_per_sec,
+};
+
+#define PWM_CAPTURE_EMUL_DEFINE(inst)                                                   \
+    static struct pwm_capture_emul_channel                                              \
+        pwm_capture_emul_channels_##inst[DT_INST_PROP(inst, channels)];                 \
+    static struct pwm_capture_emul_data pwm_capture_emul_data_##inst = {                \
+        .channels = pwm_capture_emul_channels_##inst,                                   \
+    };                                                                                  \
+    static const struct pwm_capture_emul_config pwm_capture_emul_config_##inst = {      \
+        .channel_count = DT_INST_PROP(inst, channels),                                  \
+    };                                                                                  \
+    DEVICE_DT_INST_DEFINE(inst, pwm_capture_emul_init, NULL,                            \
+                          &pwm_capture_emul_data_##inst, &pwm_capture_emul_config_##inst, \
+                          POST_KERNEL, CONFIG_PWM_INIT_PRIORITY,                        \
+                          &pwm_capture_emul_api);
+
+DT_INST_FOREACH_STATUS_OKAY(PWM_CAPTURE_EMUL_DEFINE)
@@ -0,0 +1,54 @@
+/**
+ * @file pwm_capture_emul.h
+ * @brief Header file for the emulated PWM controller
+ *
+ * Stands in for the PWM peripheral in simulation builds. Nothing is output,
+ * the setting of each channel is captured for models of the motors and the
+ * servo and for timing comparisons between builds.
+ */
+
+#ifndef PWM_CAPTURE_EMUL_H
+#define PWM_CAPTURE_EMUL_H
+
+#include <stdint.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/pwm.h>
+
+struct pwm_capture_emul_channel {
+    uint32_t period_ns;
+    uint32_t pulse_ns;
+    pwm_flags_t flags;
+    uint32_t updates;           // Number of times the channel was set
+    int64_t updated_ticks;      // Uptime of the last change of pulse or period
+};
+
+/**
+ * @brief Get the captured setting of a channel.
+ *
+ * @param dev Emulated PWM controller.
+ * @param channel Channel number.
+ * @param[out] capture Captured setting.
+ * @retval 0 if successful.
+ * @retval -EINVAL if the channel does not exist.
+ */
+int pwm_capture_emul_channel_get(const struct device *dev, uint32_t channel,
+                                 struct pwm_capture_emul_channel *capture);
+
+/**
+ * @brief Get the captured pulse width of the channel of a PWM spec.
+ *
+ * @param spec PWM spec on an emulated PWM controller.
+ * @returns Pulse width in nanoseconds, or 0 if the channel does not exist.
+ */
+static inline uint32_t pwm_capture_emul_pulse_get(const struct pwm_dt_spec *spec)
+{
+    struct pwm_capture_emul_channel capture;
+
+    if (pwm_capture_emul_channel_get(spec->dev, spec->channel, &capture) != 0)
+    {
+        return 0;
+    }
+    return capture.pulse_ns;
+}
+
+#endif /* PWM_CAPTURE_EMUL_H */
@@ -0,0 +1,347 @@
+/**
+ * @file remote_sim.c
+ * @brief Source file for the simulated central of the simulation build
+ *
+ * Replaces remote.c above the GATT layer. A central thread connects as soon
+ * as Bluetooth is initialised, enables delta radar frames and writes drive
+ * packets from the scenario's drive script every SIM_DRIVE_PERIOD_MS, which
+ * go through the same decoder and callbacks as packets received over the
+ * air. Every SIM_DRIVE_LOSS_INTERVAL-th packet is dropped to exercise the
+ * loss accounting.
+ *
+ * The drive script never pauses for long, so the link reports the active
+ * mode parameters of a 2M PHY connection with maximum data length.
+ *
+ * Radar frames, safety, ranges and stats notifications are checked and counted
+ * instead of being sent. Every SIM_REPORT_PERIOD_MS report lines with the
+ * sweep rate, frame sizes, motor command latency and the timing of each
+ * periodic task are logged, so timing can be compared across builds.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/logging/log.h>
+#include "remote.h"
+#include "link.h"
+#include "radar_frame.h"
+#include "motor.h"
+#include "periodic.h"
+#include "stats.h"
+#include "scenario.h"
+
+#define LOG_MODULE_NAME remote_sim
+LOG_MODULE_REGISTER(LOG_MODULE_NAME);
+
+#define SIM_CONNECT_DELAY_MS        500
+#define SIM_ATT_MTU                 247
+#define SIM_DRIVE_PERIOD_MS         50
+#define SIM_DRIVE_LOSS_INTERVAL     50
+#define SIM_REPORT_PERIOD_MS        5000
+
+#define SIM_CENTRAL_STACK_SIZE      1024
+#define SIM_CENTRAL_PRIORITY        5
+
+struct sim_radar_stats {
+    uint32_t frames;
+    uint32_t keyframes;
+    uint32_t bytes;
+    uint32_t bad;
+    uint32_t period_sum_ms;
+    uint32_t period_max_ms;
+    uint32_t last_timestamp_ms;
+};
+
+static void sim_central(void);
+
+static K_SEM_DEFINE(bt_init_ok, 0, 1);
+
+static struct bt_conn_cb *conn_callbacks;
+static struct bt_remote_service_cb remote_service_callbacks;
+
+// Stand-in connection handle, never dereferenced
+static uint8_t sim_conn_handle;
+static struct bt_conn *const sim_conn = (struct bt_conn *)&sim_conn_handle;
+static struct bt_conn *radar_conn;
+
+// Drive command state
+static struct drive_rx drive_rx;
+
+// Radar service state
+static struct radar_frame_encoder radar_encoder;
+static uint8_t radar_frame_buf[RADAR_FRAME_MAX_LEN];
+static struct sim_radar_stats radar_stats;
+static uint32_t safety_notifications;
+static uint32_t stats_notifications;
+static uint32_t ranges_notifications;
+static uint8_t stats_buf[STATS_PAYLOAD_LEN];
+
+K_THREAD_DEFINE(sim_central_id, SIM_CENTRAL_STACK_SIZE, sim_central, NULL, NULL, NULL,
+                SIM_CENTRAL_PRIORITY, 0, 0);
+
+struct bt_conn *bt_conn_ref(struct bt_conn *conn)
+{
+    return conn;
+} /* bt_conn_ref */
+
+void bt_conn_unref(struct bt_conn *conn)
+{
+    ARG_UNUSED(conn);
+} /* bt_conn_unref */
+
+// Same path as a write to the drive characteristic
+static void sim_drive_write(const uint8_t *buf, uint16_t len)
+{
+    struct drive_packet pkt;
+
+    if (drive_packet_decode(&drive_rx, buf, len, &pkt) == 0 && remote_service_callbacks.drive_received)
+    {
+        remote_service_callbacks.drive_received(sim_conn, &pkt);
+    }
+} /* sim_drive_write */
+
+static const struct sim_drive_step *sim_drive_step_at(uint32_t scenario_ms)
+{
+    const struct sim_drive_step *step = &sim_drive_script[0];
+
+    for (size_t i = 1; i < sim_drive_script_len && sim_drive_script[i].from_ms <= scenario_ms; i++)
+    {
+        step = &sim_drive_script[i];
+    }
+    return step;
+} /* sim_drive_step_at */
+
+static void sim_report_tasks(void)
+{
+    struct periodic_task_stats task_stats;
+    struct periodic_task *task;
+
+    for (uint8_t i = 0; i < periodic_task_count(); i++)
+    {
+        task = periodic_task_get(i);
+        if (task == NULL)
+        {
+            continue;
+        }
+        periodic_task_stats_get(task, &task_stats);
+        LOG_INF("SIM: task %s runs %u missed %u skipped %u jitter max %u us exec max %u us",
+                task->name, task_stats.runs, task_stats.deadline_misses, task_stats.skipped,
+                task_stats.jitter_max_us, task_stats.exec_max_us);
+    }
+    LOG_INF("SIM: stats notifications %u ranges notifications %u", stats_notifications,
+            ranges_notifications);
+} /* sim_report_tasks */
+
+static void sim_report(void)
+{
+    struct sim_radar_stats radar;
+    struct motor_stats motor;
+    unsigned int key;
+
+    // Radar stats are updated by the radar processing task
+    key = irq_lock();
+    radar = radar_stats;
+    memset(&radar_stats, 0, sizeof(radar_stats));
+    radar_stats.last_timestamp_ms = radar.last_timestamp_ms;
+    irq_unlock(key);
+
+    motor_stats_get(&motor);
+    LOG_INF("SIM: sweeps %u period avg %u ms max %u ms, frame avg %u B, keyframes %u, bad %u",
+            radar.frames, radar.frames ? radar.period_sum_ms / radar.frames : 0, radar.period_max_ms,
+            radar.frames ? radar.bytes / radar.frames : 0, radar.keyframes, radar.bad);
+    LOG_INF("SIM: drive rx %u lost %u late %u, motor cmds %u dropped %u watchdog %u latency %u/%u us, safety %u",
+            drive_rx.stats.received, drive_rx.stats.lost, drive_rx.stats.out_of_order,
+            motor.commands, motor.dropped, motor.watchdog_stops, motor.latency_last_us,
+            motor.latency_max_us, safety_notifications);
+    sim_report_tasks();
+} /* sim_report */
+
+static void sim_central(void)
+{
+    uint8_t pkt[DRIVE_PACKET_MIN_LEN];
+    const struct sim_drive_step *step;
+    uint16_t seq = 0;
+    int64_t next_report;
+    int64_t next_write;
+
+    k_sem_take(&bt_init_ok, K_FOREVER);
+    k_sleep(K_MSEC(SIM_CONNECT_DELAY_MS));
+
+    radar_conn = bt_conn_ref(sim_conn);
+    drive_rx_reset(&drive_rx);
+    radar_frame_encoder_request_keyframe(&radar_encoder);
+    if (conn_callbacks && conn_callbacks->connected)
+    {
+        conn_callbacks->connected(sim_conn, 0);
+    }
+    LOG_INF("Simulated central connected, ATT MTU %u", SIM_ATT_MTU);
+
+    next_write = k_uptime_get();
+    next_report = next_write + SIM_REPORT_PERIOD_MS;
+    for (;;)
+    {
+        step = sim_drive_step_at(sim_scenario_time_ms());
+        sys_put_le16(seq, &pkt[0]);
+        sys_put_le16((uint16_t)step->throttle, &pkt[2]);
+        sys_put_le16((uint16_t)step->steering, &pkt[4]);
+        if ((seq % SIM_DRIVE_LOSS_INTERVAL) != SIM_DRIVE_LOSS_INTERVAL - 1)
+        {
+            sim_drive_write(pkt, sizeof(pkt));
+        }
+        seq++;
+
+        if (k_uptime_get() >= next_report)
+        {
+            sim_report();
+            next_report += SIM_REPORT_PERIOD_MS;
+        }
+
+        // Absolute schedule so the write rate does not drift with processing time
+        next_write += SIM_DRIVE_PERIOD_MS;
+        k_sleep(K_TIMEOUT_ABS_MS(next_write));
+    }
+} /* sim_central */
+
+int remote_radar_send_sweep(const uint16_t *bins_mm, const uint8_t *confidence, uint8_t bin_count)
+{
+    uint32_t now_ms = k_uptime_get_32();
+    uint32_t period_ms;
+    int len;
+
+    if (radar_conn == NULL)
+    {
+        return -ENOTCONN;
+    }
+    if (radar_encoder.bin_count != bin_count)
+    {
+        radar_frame_encoder_init(&radar_encoder, bin_count);
+    }
+
+    // ATT notification header takes 3 bytes of the MTU
+    len = radar_frame_encode(&radar_encoder, bins_mm, confidence, now_ms, true,
+                             radar_frame_buf, MIN(sizeof(radar_frame_buf), SIM_ATT_MTU - 3));
+    if (len < 0)
+    {
+        return -EMSGSIZE;
+    }
+
+    // Receive side checks of the central
+    if (len < RADAR_FRAME_HDR_LEN || radar_frame_buf[0] != RADAR_FRAME_VERSION || radar_frame_buf[8] != bin_count)
+    {
+        radar_stats.bad++;
+    }
+    if (radar_frame_buf[1] & RADAR_FRAME_FLAG_KEYFRAME)
+    {
+        radar_stats.keyframes++;
+    }
+    if (radar_stats.last_timestamp_ms != 0)
+    {
+        period_ms = now_ms - radar_stats.last_timestamp_ms;
+        radar_stats.period_sum_ms += period_ms;
+        radar_stats.period_max_ms = MAX(radar_stats.period_max_ms, period_ms);
+    }
+    radar_stats.last_timestamp_ms = now_ms;
+    radar_stats.frames++;
+    radar_stats.bytes += len;
+
+    return 0;
+} /* remote_radar_send_sweep */
+
+int remote_safety_notify(uint8_t action, uint8_t bin, uint16_t limit, uint16_t range_mm, uint16_t closure_mm_s)
+{
+    if (radar_conn == NULL)
+    {
+        return -ENOTCONN;
+    }
+    safety_notifications++;
+    LOG_INF("SIM: safety action %u bin %u limit %u range %u mm closing %u mm/s at %u ms",
+            action, bin, limit, range_mm, closure_mm_s, sim_scenario_time_ms());
+
+    return 0;
+} /* remote_safety_notify */
+
+int remote_ranges_notify(const int16_t *bearing_deg, const uint16_t *mm, uint8_t count)
+{
+    ARG_UNUSED(bearing_deg);
+    ARG_UNUSED(mm);
+
+    if (count > REMOTE_RANGES_MAX)
+    {
+        return -EINVAL;
+    }
+    if (radar_conn == NULL)
+    {
+        return -ENOTCONN;
+    }
+    ranges_notifications++;
+
+    return 0;
+} /* remote_ranges_notify */
+
+int remote_battery_level_set(uint8_t level)
+{
+    LOG_INF("SIM: battery level %u %% at %u ms", level, sim_scenario_time_ms());
+    return 0;
+} /* remote_battery_level_set */
+
+int remote_stats_notify(void)
+{
+    int len;
+
+    if (radar_conn == NULL)
+    {
+        return -ENOTCONN;
+    }
+    len = stats_encode(stats_buf, sizeof(stats_buf));
+    if (len < 0)
+    {
+        return len;
+    }
+    if (len > SIM_ATT_MTU - 3)
+    {
+        return -EMSGSIZE;
+    }
+    stats_notifications++;
+
+    return 0;
+} /* remote_stats_notify */
+
+void link_info_get(struct link_info *info)
+{
+    memset(info, 0, sizeof(*info));
+    if (radar_conn == NULL)
+    {
+        return;
+    }
+    info->interval = LINK_ACTIVE_INTERVAL_MIN;
+    info->latency = LINK_ACTIVE_LATENCY;
+    info->timeout = LINK_ACTIVE_TIMEOUT;
+    info->tx_phy = BT_GAP_LE_PHY_2M;
+    info->rx_phy = BT_GAP_LE_PHY_2M;
+    info->tx_max_len = 251;
+    info->rx_max_len = 251;
+    info->mtu = SIM_ATT_MTU;
+    info->active = true;
+} /* link_info_get */
+
+void remote_drive_stats_get(struct drive_rx_stats *stats)
+{
+    *stats = drive_rx.stats;
+} /* remote_drive_stats_get */
+
+int bluetooth_init(struct bt_conn_cb *bt_cb, struct bt_remote_service_cb *remote_cb)
+{
+    LOG_INF("Initializing simulated Bluetooth");
+
+    if (bt_cb == NULL)
+    {
+        return -EINVAL;
+    }
+    conn_callbacks = bt_cb;
+    remote_service_callbacks = *remote_cb;
+    k_sem_give(&bt_init_ok);
+
+    return 0;
+} /* bluetooth_init */
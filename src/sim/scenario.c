@@ -0,0 +1,36 @@
+/**
+ * @file scenario.c
+ * @brief Source file for the scripted simulation scenario
+ */
+
+#include "scenario.h"
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+// Wall ahead with a post to the left, and something crossing from the right while the robot drives at the wall.
+// A wall behind for the rear sensor
+const struct sim_obstacle sim_scene[] = {
+    { .from_ms = 0,    .to_ms = UINT32_MAX, .bearing_deg = 0,   .width_deg = 40, .range_mm = 1800 },
+    { .from_ms = 0,    .to_ms = UINT32_MAX, .bearing_deg = 30,  .width_deg = 8,  .range_mm = 700 },
+    { .from_ms = 4000, .to_ms = 4600,       .bearing_deg = -25, .width_deg = 10, .range_mm = 450 },
+    { .from_ms = 4600, .to_ms = 5200,       .bearing_deg = -10, .width_deg = 10, .range_mm = 450 },
+    { .from_ms = 5200, .to_ms = 5800,       .bearing_deg = 5,   .width_deg = 10, .range_mm = 450 },
+    { .from_ms = 0,    .to_ms = UINT32_MAX, .bearing_deg = 180, .width_deg = 60, .range_mm = 600 },
+};
+const size_t sim_scene_len = ARRAY_SIZE(sim_scene);
+
+// Drive at the wall until the reflex stops the robot, back off, turn on the spot, then wait for the loop
+const struct sim_drive_step sim_drive_script[] = {
+    { .from_ms = 0,     .throttle = 0,    .steering = 0 },
+    { .from_ms = 2000,  .throttle = 800,  .steering = 0 },
+    { .from_ms = 9000,  .throttle = -600, .steering = 0 },
+    { .from_ms = 11500, .throttle = 0,    .steering = 700 },
+    { .from_ms = 12500, .throttle = 0,    .steering = -700 },
+    { .from_ms = 13500, .throttle = 0,    .steering = 0 },
+};
+const size_t sim_drive_script_len = ARRAY_SIZE(sim_drive_script);
+
+uint32_t sim_scenario_time_ms(void)
+{
+    return k_uptime_get_32() % SIM_SCENARIO_PERIOD_MS;
+} /* sim_scenario_time_ms */
@@ -0,0 +1,53 @@
+/**
+ * @file scenario.h
+ * @brief Header file for the scripted simulation scenario
+ *
+ * A scenario is the scene the emulated HC-SR04 ranges against and the
+ * drive commands the simulated central sends. Both loop every
+ * SIM_SCENARIO_PERIOD_MS so long runs give stable timing figures.
+ *
+ * Obstacles are fixed in the world, around the robot's start position.
+ * The model moves the robot along a straight line at the speed the motor PWM
+ * commands, so driving forwards closes the range to every obstacle ahead and
+ * the obstacle avoidance reflex is exercised. Obstacles more than 90 degrees
+ * off the bow are behind the robot and recede as it drives forwards.
+ */
+
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SIM_SCENARIO_PERIOD_MS  16000
+#define SIM_MM_S_PER_US         2       // Robot speed per microsecond of motor pulse offset
+
+struct sim_obstacle {
+    uint32_t from_ms;           // Visible from this time into the scenario
+    uint32_t to_ms;             // Until this time
+    int16_t bearing_deg;        // Centre of the obstacle, positive is left
+    uint16_t width_deg;         // Angle the obstacle spans
+    uint16_t range_mm;          // Range from the start position
+};
+
+struct sim_drive_step {
+    uint32_t from_ms;           // Applies from this time into the scenario
+    int16_t throttle;           // -DRIVE_FULL_SCALE to DRIVE_FULL_SCALE
+    int16_t steering;
+};
+
+extern const struct sim_obstacle sim_scene[];
+extern const size_t sim_scene_len;
+
+/* In order of increasing start time. The first step starts at 0 */
+extern const struct sim_drive_step sim_drive_script[];
+extern const size_t sim_drive_script_len;
+
+/**
+ * @brief Get the time into the current loop of the scenario.
+ *
+ * @returns Milliseconds since the loop started.
+ */
+uint32_t sim_scenario_time_ms(void);
+
+#endif /* SCENARIO_H */
@@ -0,0 +1,173 @@
+/**
+ * @file stats.c
+ * @brief Source file for the runtime performance statistics
+ */
+
+#include "stats.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include "periodic.h"
+#include "battery.h"
+#include "link.h"
+
+atomic_t stats_counters[STATS_COUNTER_COUNT];
+
+static atomic_t hists[STATS_HIST_COUNT][STATS_HIST_BUCKETS];
+static atomic_t reset_ms;
+static atomic_t sweep_period_ms;
+static atomic_t samples_per_s;
+static k_tid_t watched[STATS_THREAD_COUNT];
+
+// Owned by the radar processing task
+static uint32_t last_sweep_ms;
+static uint32_t last_sweep_samples;
+
+void stats_hist_record(enum stats_hist hist, uint32_t us)
+{
+    uint8_t bucket = (us == 0) ? 0 : MIN(32 - __builtin_clz(us), STATS_HIST_BUCKETS - 1);
+
+    atomic_inc(&hists[hist][bucket]);
+} /* stats_hist_record */
+
+void stats_sweep_done(void)
+{
+    uint32_t now_ms = k_uptime_get_32();
+    uint32_t samples = atomic_get(&stats_counters[STATS_SAMPLES]);
+    uint32_t period_ms = now_ms - last_sweep_ms;
+
+    // Skip the first sweep and the one spanning a reset
+    if (last_sweep_ms != 0 && period_ms > 0 && samples >= last_sweep_samples)
+    {
+        atomic_set(&sweep_period_ms, period_ms);
+        atomic_set(&samples_per_s, ((samples - last_sweep_samples) * 1000U) / period_ms);
+    }
+    last_sweep_ms = now_ms;
+    last_sweep_samples = samples;
+} /* stats_sweep_done */
+
+void stats_thread_watch(enum stats_thread thread, k_tid_t tid)
+{
+    watched[thread] = tid;
+} /* stats_thread_watch */
+
+void stats_reset(void)
+{
+    for (uint8_t i = 0; i < STATS_COUNTER_COUNT; i++)
+    {
+        atomic_clear(&stats_counters[i]);
+    }
+    for (uint8_t h = 0; h < STATS_HIST_COUNT; h++)
+    {
+        for (uint8_t i = 0; i < STATS_HIST_BUCKETS; i++)
+        {
+            atomic_clear(&hists[h][i]);
+        }
+    }
+    periodic_task_stats_reset();
+    atomic_set(&reset_ms, k_uptime_get_32());
+} /* stats_reset */
+
+static uint16_t stack_used(k_tid_t tid)
+{
+#if defined(CONFIG_INIT_STACKS) && defined(CONFIG_THREAD_STACK_INFO)
+    size_t unused;
+
+    // Scans the stack, so only done on read
+    if (tid != NULL && k_thread_stack_space_get(tid, &unused) == 0)
+    {
+        return MIN(tid->stack_info.size - unused, UINT16_MAX);
+    }
+#endif
+    return 0;
+} /* stack_used */
+
+static uint8_t *encode_tasks(uint8_t *p)
+{
+    struct periodic_task_stats task_stats;
+    struct periodic_task *task;
+    uint8_t *count = p++;
+
+    *count = 0;
+    for (uint8_t i = 0; i < periodic_task_count() && *count < STATS_TASKS_MAX; i++)
+    {
+        task = periodic_task_get(i);
+        if (task == NULL)
+        {
+            continue;
+        }
+        periodic_task_stats_get(task, &task_stats);
+        memset(p, 0, STATS_TASK_NAME_LEN);
+        strncpy((char *)p, task->name, STATS_TASK_NAME_LEN);
+        p += STATS_TASK_NAME_LEN;
+        sys_put_le32(task_stats.deadline_misses, p);
+        p += 4;
+        sys_put_le16(MIN(task_stats.skipped, UINT16_MAX), p);
+        p += 2;
+        sys_put_le16(MIN(task_stats.jitter_max_us, UINT16_MAX), p);
+        p += 2;
+        sys_put_le16(MIN(task_stats.exec_max_us, UINT16_MAX), p);
+        p += 2;
+        (*count)++;
+    }
+
+    return p;
+} /* encode_tasks */
+
+int stats_encode(uint8_t *buf, size_t size)
+{
+    struct link_info link;
+    uint8_t *p = buf;
+
+    if (size < STATS_PAYLOAD_LEN)
+    {
+        return -ENOSPC;
+    }
+
+    *p++ = STATS_VERSION;
+    *p++ = STATS_HIST_BUCKETS;
+    sys_put_le32(k_uptime_get_32() - (uint32_t)atomic_get(&reset_ms), p);
+    p += 4;
+    sys_put_le32(atomic_get(&stats_counters[STATS_SAMPLES]), p);
+    p += 4;
+    sys_put_le16(MIN((uint32_t)atomic_get(&samples_per_s), UINT16_MAX), p);
+    p += 2;
+    sys_put_le16(MIN((uint32_t)atomic_get(&sweep_period_ms), UINT16_MAX), p);
+    p += 2;
+    sys_put_le32(atomic_get(&stats_counters[STATS_ECHO_TIMEOUTS]), p);
+    p += 4;
+    sys_put_le32(atomic_get(&stats_counters[STATS_NO_RETURNS]), p);
+    p += 4;
+    sys_put_le32(atomic_get(&stats_counters[STATS_NOTIFY_FAILURES]), p);
+    p += 4;
+    sys_put_le32(atomic_get(&stats_counters[STATS_WATCHDOG_STOPS]), p);
+    p += 4;
+    for (uint8_t i = 0; i < STATS_THREAD_COUNT; i++)
+    {
+        sys_put_le16(stack_used(watched[i]), p);
+        p += 2;
+    }
+    sys_put_le16(battery_mv_get(), p);
+    p += 2;
+    link_info_get(&link);
+    sys_put_le16(link.interval, p);
+    p += 2;
+    sys_put_le16(link.latency, p);
+    p += 2;
+    sys_put_le16(link.timeout, p);
+    p += 2;
+    *p++ = (link.tx_phy & 0x0F) | (link.rx_phy << 4);
+    *p++ = MIN(link.tx_max_len, UINT8_MAX);
+    for (uint8_t h = 0; h < STATS_HIST_COUNT; h++)
+    {
+        for (uint8_t i = 0; i < STATS_HIST_BUCKETS; i++)
+        {
+            sys_put_le32(atomic_get(&hists[h][i]), p);
+            p += 4;
+        }
+    }
+    p = encode_tasks(p);
+
+    return p - buf;
+} /* stats_encode */
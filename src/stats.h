@@ -0,0 +1,134 @@
+/**
+ * @file stats.h
+ * @brief Header file for the runtime performance statistics
+ *
+ * Counters and latency histograms are plain atomics, updated with a single
+ * atomic increment from any context, so they stay enabled in production
+ * builds. They are only gathered into a consistent layout when a client
+ * reads the stats characteristic.
+ *
+ * Payload layout (little-endian, packed):
+ *
+ *   | version | buckets | since_reset_ms | samples | samples_per_s | sweep_period_ms |
+ *   |   u8    |   u8    |      u32       |   u32   |      u16      |       u16       |
+ *
+ *   | echo_timeouts | no_returns | notify_failures | watchdog_stops |
+ *   |      u32      |    u32     |       u32       |      u32       |
+ *
+ *   | stack_used_ranging | stack_used_main | battery_mv |
+ *   |        u16         |       u16       |    u16     |
+ *
+ *   | conn_interval | conn_latency | conn_timeout | phy | data_len |
+ *   |      u16      |     u16      |     u16      | u8  |    u8    |
+ *
+ *   | cmd_to_pwm_hist | echo_to_notify_hist |
+ *   | u32 * buckets   |   u32 * buckets     |
+ *
+ *   | task_count | task * task_count |
+ *   |     u8     |                   |
+ *
+ * with each periodic task as
+ *
+ *   | name  | deadline_misses | skipped | jitter_max_us | exec_max_us |
+ *   | u8[4] |       u32       |   u16   |      u16      |     u16     |
+ *
+ * Histogram bucket 0 counts latencies under 1 us and bucket i counts
+ * latencies from 2^(i-1) us up to 2^i us. The last bucket also counts
+ * everything longer. Stack use is the high-water mark in bytes, or 0 if
+ * not known. The battery voltage is the last one reported by the battery
+ * monitor, or 0 if not known yet. The link fields are the negotiated connection
+ * interval in 1.25 ms units, peripheral latency in connection events and
+ * supervision timeout in 10 ms units, the TX PHY in the low nibble and RX PHY
+ * in the high nibble (1 = 1M, 2 = 2M, 4 = coded) and the TX data length in
+ * octets, capped at 255. They are 0 when not connected. Task names are cut to four characters and padded with zeros.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+
+#define STATS_VERSION           4
+#define STATS_HIST_BUCKETS      16
+#define STATS_TASKS_MAX         5
+#define STATS_TASK_NAME_LEN     4
+#define STATS_TASK_LEN          (STATS_TASK_NAME_LEN + 10)
+#define STATS_PAYLOAD_LEN       (45 + 2 * STATS_HIST_BUCKETS * sizeof(uint32_t) + STATS_TASKS_MAX * STATS_TASK_LEN)
+
+enum stats_counter {
+    STATS_SAMPLES,              // Ranging samples taken
+    STATS_ECHO_TIMEOUTS,        // Samples lost to a sensor fault: no answer, busy or late
+    STATS_NO_RETURNS,           // Samples with nothing within range
+    STATS_NOTIFY_FAILURES,      // Notifications the Bluetooth stack refused
+    STATS_WATCHDOG_STOPS,       // Motor watchdog expiries
+    STATS_COUNTER_COUNT
+};
+
+enum stats_hist {
+    STATS_HIST_CMD_TO_PWM,      // Drive command receipt to motor thread update
+    STATS_HIST_ECHO_TO_NOTIFY,  // Echo completion interrupt to radar frame queued for sending
+    STATS_HIST_COUNT
+};
+
+enum stats_thread {
+    STATS_THREAD_RANGING,
+    STATS_THREAD_MAIN,
+    STATS_THREAD_COUNT
+};
+
+extern atomic_t stats_counters[STATS_COUNTER_COUNT];
+
+/**
+ * @brief Count an event. Safe from any context.
+ *
+ * @param counter Counter.
+ */
+static inline void stats_inc(enum stats_counter counter)
+{
+    atomic_inc(&stats_counters[counter]);
+}
+
+/**
+ * @brief Add a latency to a histogram. Safe from any context.
+ *
+ * @param hist Histogram.
+ * @param us Latency in microseconds.
+ */
+void stats_hist_record(enum stats_hist hist, uint32_t us);
+
+/**
+ * @brief Mark the end of a radar sweep.
+ *
+ * Updates the sweep period and the sampling rate over the sweep. Must be
+ * called from one thread only.
+ */
+void stats_sweep_done(void);
+
+/**
+ * @brief Track the stack use of a thread.
+ *
+ * Needs CONFIG_INIT_STACKS and CONFIG_THREAD_STACK_INFO.
+ *
+ * @param thread Slot of the thread in the payload.
+ * @param tid Thread.
+ */
+void stats_thread_watch(enum stats_thread thread, k_tid_t tid);
+
+/**
+ * @brief Clear all counters, histograms and periodic task statistics.
+ */
+void stats_reset(void);
+
+/**
+ * @brief Gather the statistics into the payload layout.
+ *
+ * @param buf Output buffer.
+ * @param size Size of output buffer.
+ * @returns Payload length, or -ENOSPC if the buffer is too small.
+ */
+int stats_encode(uint8_t *buf, size_t size);
+
+#endif /* STATS_H */
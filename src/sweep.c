@@ -0,0 +1,99 @@
+/**
+ * @file sweep.c
+ * @brief Source file for the radar servo sweep scheduler
+ */
+
+#include "sweep.h"
+#include <zephyr/pm/device_runtime.h>
+
+static int sweep_move(struct sweep *sw, uint8_t bin);
+
+// Command the servo to a bin and work out when it will have settled there
+static int sweep_move(struct sweep *sw, uint8_t bin)
+{
+    uint32_t travel = (bin > sw->bin) ? (bin - sw->bin) : (sw->bin - bin);
+    uint32_t settle_us = sw->cfg.settle_base_us + travel * sw->cfg.settle_per_bin_us;
+    int err;
+
+    err = pwm_set_pulse_dt(sw->cfg.servo, sw->pulse_ns[bin]);
+    if (err < 0)
+    {
+        return err;
+    }
+    sw->bin = bin;
+    sw->settled_at_ticks = k_uptime_ticks() + k_us_to_ticks_ceil64(settle_us);
+
+    return 0;
+} /* sweep_move */
+
+int sweep_init(struct sweep *sw, const struct sweep_config *cfg)
+{
+    uint32_t span_ns;
+
+    if (cfg->bins < 2 || cfg->bins > SWEEP_MAX_BINS)
+    {
+        return -EINVAL;
+    }
+    sw->cfg = *cfg;
+    span_ns = cfg->max_pulse_ns - cfg->min_pulse_ns;
+
+    // Centre of each bin, bin 0 at the left hand (max pulse) end of the scan
+    for (uint8_t i = 0; i < cfg->bins; i++)
+    {
+        sw->pulse_ns[i] = cfg->max_pulse_ns - ((2U * i + 1U) * (uint64_t)span_ns) / (2U * cfg->bins);
+    }
+
+    sw->bin = 0;
+    sw->step = 1;
+    sw->parked = true;
+    return 0;
+} /* sweep_init */
+
+int sweep_resume(struct sweep *sw)
+{
+    uint8_t bin = sw->bin;
+
+    if (!sw->parked)
+    {
+        return 0;
+    }
+    pm_device_runtime_get(sw->cfg.servo->dev);
+    sw->parked = false;
+
+    // Servo position is unknown after parking, so allow for a full traverse
+    sw->bin = (bin < sw->cfg.bins / 2) ? sw->cfg.bins - 1 : 0;
+    return sweep_move(sw, bin);
+} /* sweep_resume */
+
+void sweep_park(struct sweep *sw)
+{
+    if (sw->parked)
+    {
+        return;
+    }
+    // The servo holds its position by friction, the next resume allows for it having moved
+    pwm_set_pulse_dt(sw->cfg.servo, 0);
+    pm_device_runtime_put(sw->cfg.servo->dev);
+    sw->parked = true;
+} /* sweep_park */
+
+int sweep_advance(struct sweep *sw, bool *sweep_done)
+{
+    int next = sw->bin + sw->step;
+
+    *sweep_done = false;
+    if (next < 0 || next >= sw->cfg.bins)
+    {
+        // Reverse at either end without sampling the end bin twice
+        sw->step = -sw->step;
+        next = sw->bin + sw->step;
+        *sweep_done = true;
+    }
+
+    return sweep_move(sw, next);
+} /* sweep_advance */
+
+void sweep_wait_settled(const struct sweep *sw)
+{
+    k_sleep(K_TIMEOUT_ABS_TICKS(sw->settled_at_ticks));
+} /* sweep_wait_settled */
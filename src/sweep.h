@@ -0,0 +1,102 @@
+/**
+ * @file sweep.h
+ * @brief Header file for the radar servo sweep scheduler
+ *
+ * The scanning servo is jumped straight between precomputed bin-centre
+ * pulse widths, back and forth across the scan. After each move the
+ * scheduler only waits for the modelled settle time of the servo, so the
+ * next move can be commanded as soon as a sample has been taken and the
+ * sample processed while the servo travels.
+ */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/pwm.h>
+
+#define SWEEP_MAX_BINS 64
+
+struct sweep_config {
+    const struct pwm_dt_spec *servo;
+    uint32_t min_pulse_ns;          // Pulse width at the right hand end of the scan
+    uint32_t max_pulse_ns;          // Pulse width at the left hand end of the scan
+    uint8_t bins;                   // Number of scan bins. Max SWEEP_MAX_BINS
+    uint32_t settle_base_us;        // Settle time after any move
+    uint32_t settle_per_bin_us;     // Additional travel time per bin moved
+};
+
+struct sweep {
+    struct sweep_config cfg;
+    uint32_t pulse_ns[SWEEP_MAX_BINS];
+    uint8_t bin;
+    int8_t step;
+    int64_t settled_at_ticks;
+    bool parked;
+};
+
+/**
+ * @brief Initialise sweep scheduler with the servo parked.
+ *
+ * The scan starts from bin 0, the left hand end, once resumed.
+ *
+ * @param sw Sweep state.
+ * @param cfg Servo and scan parameters.
+ * @retval 0 if successful.
+ * @retval -EINVAL if the bin count is out of range.
+ */
+int sweep_init(struct sweep *sw, const struct sweep_config *cfg);
+
+/**
+ * @brief Power the servo and command it back to the current bin.
+ *
+ * The servo may have been moved while parked, so the settle time allows for
+ * a full traverse. Does nothing if not parked.
+ *
+ * @param sw Sweep state.
+ * @retval 0 if successful.
+ * @retval Negative error code from the PWM API otherwise.
+ */
+int sweep_resume(struct sweep *sw);
+
+/**
+ * @brief Stop pulsing the servo and release the PWM controller.
+ *
+ * Must not be called while the sweep is being advanced. Does nothing if
+ * already parked.
+ *
+ * @param sw Sweep state.
+ */
+void sweep_park(struct sweep *sw);
+
+/**
+ * @brief Command the servo to the next bin.
+ *
+ * Returns without waiting for the servo to move.
+ *
+ * @param sw Sweep state.
+ * @param[out] sweep_done Set if the bin left behind was the end of a sweep.
+ * @retval 0 if successful.
+ * @retval Negative error code from the PWM API otherwise.
+ */
+int sweep_advance(struct sweep *sw, bool *sweep_done);
+
+/**
+ * @brief Sleep until the servo has settled on the current bin.
+ *
+ * @param sw Sweep state.
+ */
+void sweep_wait_settled(const struct sweep *sw);
+
+/**
+ * @brief Get the bin the servo was last commanded to.
+ *
+ * @param sw Sweep state.
+ * @returns Bin index. 0 is left.
+ */
+static inline uint8_t sweep_bin(const struct sweep *sw)
+{
+    return sw->bin;
+}
+
+#endif /* SWEEP_H */
@@ -0,0 +1,70 @@
+"""Collect the BENCH lines of a twister run into a JSON report.
+
+Usage:
+    python bench_report.py [twister-out] [-o bench.json] [--baseline old.json]
+
+Every handler.log under the twister output directory is scanned. The report
+holds one entry per platform and benchmark. With a baseline report, the change
+in cost per operation is printed for each benchmark found in both.
+"""
+
+import argparse
+import json
+import pathlib
+import re
+
+BENCH_LINE = re.compile(r"BENCH (\S+) (\d+) (\d+) (\d+) (\S+)")
+
+
+def platform_of(log_path: pathlib.Path, out_dir: pathlib.Path) -> str:
+    # twister-out/<platform>/<test path>/<scenario>/handler.log
+    return log_path.relative_to(out_dir).parts[0]
+
+
+def collect(out_dir: pathlib.Path) -> list[dict]:
+    results = []
+    for log_path in sorted(out_dir.rglob("handler.log")):
+        platform = platform_of(log_path, out_dir)
+        for line in log_path.read_text(errors="replace").splitlines():
+            match = BENCH_LINE.search(line)
+            if match is None:
+                continue
+            name, iterations, total, per_op, unit = match.groups()
+            results.append({
+                "platform": platform,
+                "name": name,
+                "iterations": int(iterations),
+                "total": int(total),
+                "per_op": int(per_op),
+                "unit": unit,
+            })
+    return results
+
+
+def compare(results: list[dict], baseline: list[dict]) -> None:
+    old = {(r["platform"], r["name"]): r for r in baseline}
+    for r in results:
+        prev = old.get((r["platform"], r["name"]))
+        if prev is None or prev["per_op"] == 0:
+            continue
+        change = 100.0 * (r["per_op"] - prev["per_op"]) / prev["per_op"]
+        print(f"{r['platform']:<16} {r['name']:<28} {prev['per_op']:>8} -> {r['per_op']:>8} {r['unit']:<8} {change:+6.1f}%")
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("out_dir", nargs="?", default="twister-out", type=pathlib.Path)
+    parser.add_argument("-o", "--output", default="bench.json", type=pathlib.Path)
+    parser.add_argument("--baseline", type=pathlib.Path)
+    args = parser.parse_args()
+
+    results = collect(args.out_dir)
+    args.output.write_text(json.dumps(results, indent=2) + "\n")
+    print(f"{len(results)} benchmarks written to {args.output}")
+
+    if args.baseline is not None:
+        compare(results, json.loads(args.baseline.read_text()))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,66 @@
+/**
+ * @file bench.h
+ * @brief Micro-benchmark helpers for the hot path tests
+ *
+ * Each benchmark runs its body BENCH_ITERATIONS times and prints one line:
+ *
+ *   BENCH <name> <iterations> <total> <per_op> <unit>
+ *
+ * which tests/hot_paths/bench_report.py collects from the twister logs. On QEMU the
+ * unit is system timer cycles, which track instructions executed since
+ * twister runs QEMU with icount. On native_posix the firmware runs in zero
+ * simulated time, so the host's monotonic clock is used and the unit is
+ * nanoseconds of host time.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+
+#if defined(CONFIG_ARCH_POSIX)
+#include <time.h>
+#define BENCH_UNIT  "host_ns"
+#else
+#define BENCH_UNIT  "cycles"
+#endif
+
+#define BENCH_ITERATIONS    1000
+
+static inline uint64_t bench_clock(void)
+{
+#if defined(CONFIG_ARCH_POSIX)
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+#else
+    return k_cycle_get_32();
+#endif
+}
+
+static inline void bench_report(const char *name, uint32_t iterations, uint64_t start)
+{
+    // Truncation also handles the wrap of the 32-bit cycle counter
+    uint32_t total = (uint32_t)(bench_clock() - start);
+
+    printk("BENCH %s %u %u %u %s\n", name, iterations, total, total / iterations, BENCH_UNIT);
+}
+
+/* Run the statements BENCH_ITERATIONS times and report the cost. bench_i is the iteration */
+#define BENCH(name, ...)                                        \
+    do {                                                        \
+        uint64_t bench_start_ = bench_clock();                  \
+        for (uint32_t bench_i = 0; bench_i < BENCH_ITERATIONS; bench_i++) \
+        {                                                       \
+            __VA_ARGS__;                                        \
+        }                                                       \
+        bench_report(name, BENCH_ITERATIONS, bench_start_);     \
+    } while (0)
+
+/* Keep the compiler from optimising away a benchmarked result */
+#define BENCH_KEEP(val)     __asm__ volatile("" : : "r"(val) : "memory")
+
+#endif /* BENCH_H */
@@ -0,0 +1,66 @@
+/**
+ * @file test_battery.c
+ * @brief Tests for the battery state of charge and report hysteresis
+ *
+ * The ADC backend is left out, conversions are handed over here.
+ */
+
+#include <ztest.h>
+#include "battery.h"
+
+static atomic_t reports;
+static uint16_t reported_mv;
+
+int battery_adc_start(void)
+{
+    return 0;
+}
+
+static void on_changed(uint16_t mv)
+{
+    reported_mv = mv;
+    atomic_inc(&reports);
+}
+
+static void *battery_setup(void)
+{
+    zassert_equal(battery_init(on_changed), 0, "init");
+    return NULL;
+}
+
+ZTEST_SUITE(battery, NULL, battery_setup, NULL, NULL, NULL);
+
+static void adc_done(uint16_t mv)
+{
+    battery_adc_done(mv);
+    // Reports go through the system workqueue
+    k_sleep(K_MSEC(1));
+}
+
+ZTEST(battery, test_level)
+{
+    zassert_equal(battery_level(0), 0, "flat");
+    zassert_equal(battery_level(BATTERY_EMPTY_MV), 0, "empty");
+    zassert_equal(battery_level((BATTERY_EMPTY_MV + BATTERY_FULL_MV) / 2), 50, "half");
+    zassert_equal(battery_level(BATTERY_FULL_MV), 100, "full");
+    zassert_equal(battery_level(UINT16_MAX), 100, "charging");
+}
+
+ZTEST(battery, test_hysteresis)
+{
+    uint32_t before = atomic_get(&reports);
+
+    adc_done(5000);
+    zassert_equal(atomic_get(&reports), before + 1, "first conversion reported");
+    zassert_equal(reported_mv, 5000, "reported voltage");
+    zassert_equal(battery_mv_get(), 5000, "voltage kept for the stats");
+
+    adc_done(5000 - BATTERY_HYSTERESIS_MV);
+    adc_done(5000 + BATTERY_HYSTERESIS_MV);
+    zassert_equal(atomic_get(&reports), before + 1, "noise within the hysteresis not reported");
+    zassert_equal(battery_mv_get(), 5000, "last report kept");
+
+    adc_done(5000 - BATTERY_HYSTERESIS_MV - 1);
+    zassert_equal(atomic_get(&reports), before + 2, "drop past the hysteresis reported");
+    zassert_equal(reported_mv, 5000 - BATTERY_HYSTERESIS_MV - 1, "new voltage reported");
+}
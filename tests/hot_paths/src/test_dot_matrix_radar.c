@@ -0,0 +1,80 @@
+/**
+ * @file test_dot_matrix_radar.c
+ * @brief Tests for the dot matrix radar view
+ *
+ * The SPI driver is left out, rows drawn by the renderer are captured here.
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include "dot_matrix/dot_matrix.h"
+#include "radar_bx.h"
+#include "bench.h"
+
+static uint8_t rows[DOT_MATRIX_ROWS];
+static uint16_t bins[RADAR_SCAN_BINS];
+
+void dot_matrix_row_set(uint8_t row, uint8_t bits)
+{
+    zassert_true(row < DOT_MATRIX_ROWS, "row %u in range", row);
+    rows[row] = bits;
+}
+
+static void dot_matrix_radar_before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+    memset(rows, 0xAA, sizeof(rows));
+    for (uint8_t bin = 0; bin < RADAR_SCAN_BINS; bin++)
+    {
+        bins[bin] = RADAR_RANGE_MM;
+    }
+}
+
+ZTEST_SUITE(dot_matrix_radar, NULL, NULL, dot_matrix_radar_before, NULL, NULL);
+
+ZTEST(dot_matrix_radar, test_clear_when_out_of_range)
+{
+    dot_matrix_show_radar(bins, RADAR_SCAN_BINS);
+    for (uint8_t row = 0; row < DOT_MATRIX_ROWS; row++)
+    {
+        zassert_equal(rows[row], 0, "row %u empty", row);
+    }
+}
+
+ZTEST(dot_matrix_radar, test_bar_height_and_sector)
+{
+    // Leftmost bin at the sensor fills column 0, rightmost at half range fills half of column 7
+    bins[0] = 0;
+    bins[RADAR_SCAN_BINS - 1] = RADAR_RANGE_MM / 2;
+    dot_matrix_show_radar(bins, RADAR_SCAN_BINS);
+
+    for (uint8_t row = 0; row < DOT_MATRIX_ROWS; row++)
+    {
+        uint8_t expected = BIT(7) | ((row >= DOT_MATRIX_ROWS / 2) ? BIT(0) : 0);
+
+        zassert_equal(rows[row], expected, "row %u is %02x", row, rows[row]);
+    }
+}
+
+ZTEST(dot_matrix_radar, test_nearest_in_sector)
+{
+    // Bins 5 and 6 share column 2, the nearer one sets the bar
+    bins[5] = RADAR_RANGE_MM - 1;
+    bins[6] = RADAR_RANGE_MM / 8;
+    dot_matrix_show_radar(bins, RADAR_SCAN_BINS);
+
+    zassert_equal(rows[0], 0, "bar below the top");
+    zassert_equal(rows[1], BIT(5), "seven rows lit in column 2");
+    zassert_equal(rows[DOT_MATRIX_ROWS - 1], BIT(5), "bar reaches the bottom");
+}
+
+ZTEST(dot_matrix_radar, test_bench)
+{
+    for (uint8_t bin = 0; bin < RADAR_SCAN_BINS; bin++)
+    {
+        bins[bin] = (bin * 97) % RADAR_RANGE_MM;
+    }
+    BENCH("dot_matrix_show_radar",
+          bins[bench_i % RADAR_SCAN_BINS] = bench_i % RADAR_RANGE_MM;
+          dot_matrix_show_radar(bins, RADAR_SCAN_BINS));
+}
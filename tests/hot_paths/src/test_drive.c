@@ -0,0 +1,106 @@
+/**
+ * @file test_drive.c
+ * @brief Tests for the drive command mapping and the drive packet decoder
+ */
+
+#include <ztest.h>
+#include <zephyr/sys/byteorder.h>
+#include "drive.h"
+#include "drive_packet.h"
+#include "bench.h"
+
+#define SPEED_US    350
+
+ZTEST_SUITE(drive, NULL, NULL, NULL, NULL, NULL);
+
+ZTEST(drive, test_dir_speeds)
+{
+    static const int16_t expected[DIR_COUNT_E][2] = {
+        [NONE_E]        = {0, 0},
+        [NORTH_E]       = {SPEED_US, SPEED_US},
+        [NORTHEAST_E]   = {SPEED_US, SPEED_US / 2},
+        [EAST_E]        = {SPEED_US, -SPEED_US},
+        [SOUTHEAST_E]   = {-SPEED_US, -SPEED_US / 2},
+        [SOUTH_E]       = {-SPEED_US, -SPEED_US},
+        [SOUTHWEST_E]   = {-SPEED_US / 2, -SPEED_US},
+        [WEST_E]        = {-SPEED_US, SPEED_US},
+        [NORTHWEST_E]   = {SPEED_US / 2, SPEED_US},
+    };
+    struct motor_setpoint sp;
+
+    for (uint8_t dir = 0; dir < DIR_COUNT_E; dir++)
+    {
+        zassert_equal(drive_dir_speeds(dir, SPEED_US, &sp), 0, "direction %u", dir);
+        zassert_equal(sp.left_us, expected[dir][0], "left of direction %u", dir);
+        zassert_equal(sp.right_us, expected[dir][1], "right of direction %u", dir);
+    }
+    zassert_equal(drive_dir_speeds(DIR_COUNT_E, SPEED_US, &sp), -EINVAL, "out of range");
+    zassert_equal(drive_dir_speeds((uint8_t)('x' - '0'), SPEED_US, &sp), -EINVAL, "not a digit");
+}
+
+ZTEST(drive, test_mix)
+{
+    struct motor_setpoint sp;
+
+    drive_mix(DRIVE_FULL_SCALE, 0, &sp);
+    zassert_true(sp.left_us == MOTOR_SPEED_MAX_US && sp.right_us == MOTOR_SPEED_MAX_US, "full forward");
+
+    drive_mix(0, DRIVE_FULL_SCALE, &sp);
+    zassert_true(sp.left_us == MOTOR_SPEED_MAX_US && sp.right_us == -MOTOR_SPEED_MAX_US, "spin right");
+
+    drive_mix(-DRIVE_FULL_SCALE / 2, 0, &sp);
+    zassert_true(sp.left_us == -MOTOR_SPEED_MAX_US / 2 && sp.right_us == -MOTOR_SPEED_MAX_US / 2, "half reverse");
+
+    // Saturating wheel scales both down, keeping the turn
+    drive_mix(DRIVE_FULL_SCALE, DRIVE_FULL_SCALE, &sp);
+    zassert_true(sp.left_us == MOTOR_SPEED_MAX_US && sp.right_us == 0, "forward right, %d %d",
+                 sp.left_us, sp.right_us);
+}
+
+ZTEST(drive, test_packet_decode)
+{
+    struct drive_rx rx;
+    struct drive_packet pkt;
+    uint8_t buf[DRIVE_PACKET_MIN_LEN + DRIVE_PACKET_SETPOINT_LEN];
+
+    drive_rx_reset(&rx);
+    sys_put_le16(7, &buf[0]);
+    sys_put_le16(500, &buf[2]);
+    sys_put_le16((uint16_t)-2000, &buf[4]);
+    sys_put_le16(40, &buf[6]);
+    sys_put_le16(0, &buf[8]);
+    sys_put_le16(0, &buf[10]);
+
+    zassert_equal(drive_packet_decode(&rx, buf, sizeof(buf), &pkt), 0, "valid packet");
+    zassert_equal(pkt.seq, 7, "sequence");
+    zassert_equal(pkt.count, 2, "setpoints");
+    zassert_equal(pkt.setpoints[0].steering, -DRIVE_FULL_SCALE, "steering clamped");
+    zassert_equal(pkt.setpoints[1].delay_ms, 40, "delay");
+
+    zassert_equal(drive_packet_decode(&rx, buf, sizeof(buf), &pkt), -EALREADY, "duplicate");
+    zassert_equal(drive_packet_decode(&rx, buf, DRIVE_PACKET_MIN_LEN - 1, &pkt), -EINVAL, "short");
+
+    sys_put_le16(9, &buf[0]);
+    zassert_equal(drive_packet_decode(&rx, buf, sizeof(buf), &pkt), 0, "after gap");
+    zassert_equal(rx.stats.lost, 1, "lost count");
+}
+
+ZTEST(drive, test_bench)
+{
+    struct motor_setpoint sp;
+    struct drive_rx rx;
+    struct drive_packet pkt;
+    uint8_t buf[DRIVE_PACKET_MAX_LEN] = {0};
+    int32_t out = 0;
+
+    BENCH("drive_dir_speeds", drive_dir_speeds(bench_i % DIR_COUNT_E, SPEED_US, &sp); out += sp.left_us);
+    BENCH_KEEP(out);
+    BENCH("drive_mix", drive_mix((int16_t)(bench_i % 2001) - 1000, 300, &sp); out += sp.right_us);
+    BENCH_KEEP(out);
+
+    drive_rx_reset(&rx);
+    BENCH("drive_packet_decode",
+          sys_put_le16((uint16_t)bench_i, &buf[0]);
+          out += drive_packet_decode(&rx, buf, sizeof(buf), &pkt));
+    BENCH_KEEP(out);
+}
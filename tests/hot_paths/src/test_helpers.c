@@ -0,0 +1,53 @@
+/**
+ * @file test_helpers.c
+ * @brief Tests for map() and the HC-SR04 echo conversion
+ */
+
+#include <ztest.h>
+#include "helpers.h"
+#include "libs/ultrasonic_hc-sr04.h"
+#include "bench.h"
+
+ZTEST_SUITE(helpers, NULL, NULL, NULL, NULL, NULL);
+
+ZTEST(helpers, test_map_scales)
+{
+    zassert_equal(map(0, 0, 1000, 1000, 2000), 1000, "lower bound");
+    zassert_equal(map(500, 0, 1000, 1000, 2000), 1500, "midpoint");
+    zassert_equal(map(1000, 0, 1000, 1000, 2000), 2000, "upper bound");
+    zassert_equal(map(15, 10, 20, 0, 100), 50, "offset input range");
+}
+
+ZTEST(helpers, test_map_clamps)
+{
+    zassert_equal(map(5, 10, 20, 0, 100), 0, "below input range");
+    zassert_equal(map(25, 10, 20, 0, 100), 100, "above input range");
+}
+
+ZTEST(helpers, test_echo_conversion)
+{
+    struct sensor_value val = { .val1 = 1, .val2 = 250000 };
+
+    zassert_equal(HC_SR04_US_TO_MM(0), 0, "zero width");
+    zassert_equal(HC_SR04_US_TO_MM(5814), 1000, "1 m round trip");
+    zassert_equal(HC_SR04_MM_TO_US(1000), 5813, "1 m gate");
+    zassert_equal(hc_sr04_value_to_mm(&val), 1250, "sensor value to mm");
+
+    // Converting a gate to a width and back never overshoots by more than the resolution
+    for (uint32_t mm = 0; mm <= 4000; mm++)
+    {
+        uint32_t back = HC_SR04_US_TO_MM(HC_SR04_MM_TO_US(mm));
+
+        zassert_true(back <= mm && mm - back <= 1, "round trip of %u mm gave %u mm", mm, back);
+    }
+}
+
+ZTEST(helpers, test_bench)
+{
+    uint32_t out = 0;
+
+    BENCH("map", out += map(bench_i & 1023, 0, 1023, 1000, 2000));
+    BENCH_KEEP(out);
+    BENCH("echo_us_to_mm", out += HC_SR04_US_TO_MM(bench_i * 23));
+    BENCH_KEEP(out);
+}
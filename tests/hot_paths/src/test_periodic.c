@@ -0,0 +1,131 @@
+/**
+ * @file test_periodic.c
+ * @brief Tests for the periodic task framework
+ *
+ * Each test starts one task, lets it run for a fixed window and checks the
+ * run count and timing statistics. The tasks busy-wait to model their
+ * execution time, so deadline misses and skipped releases are deterministic.
+ */
+
+#include <ztest.h>
+#include "periodic.h"
+
+#define TASK_PRIORITY   5
+#define WINDOW_MS       105
+
+static atomic_t calls;
+static uint32_t busy_us;
+static atomic_t finished;
+
+static void task_fn(void)
+{
+    atomic_inc(&calls);
+    if (busy_us > 0)
+    {
+        k_busy_wait(busy_us);
+    }
+}
+
+PERIODIC_TASK_DEFINE(on_time, task_fn, 10, 5, 0, TASK_PRIORITY, 512);
+PERIODIC_TASK_DEFINE(late, task_fn, 20, 5, 0, TASK_PRIORITY, 512);
+PERIODIC_TASK_DEFINE(overrun, task_fn, 10, 10, 0, TASK_PRIORITY, 512);
+
+// Blocks part way through its run
+static void sleeper_fn(void)
+{
+    atomic_clear(&finished);
+    k_sleep(K_MSEC(20));
+    atomic_set(&finished, 1);
+}
+
+PERIODIC_TASK_DEFINE(sleeper, sleeper_fn, 50, 50, 0, TASK_PRIORITY, 512);
+
+static void periodic_before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+    atomic_clear(&calls);
+    busy_us = 0;
+    periodic_task_stats_reset();
+}
+
+ZTEST_SUITE(periodic, NULL, NULL, periodic_before, NULL, NULL);
+
+static void run_window(struct periodic_task *task, struct periodic_task_stats *stats)
+{
+    periodic_task_start(task);
+    k_sleep(K_MSEC(WINDOW_MS));
+    periodic_task_stop(task);
+    // Let a run in progress finish
+    k_sleep(K_MSEC(task->period_ms));
+    periodic_task_stats_get(task, stats);
+}
+
+ZTEST(periodic, test_registered)
+{
+    zassert_equal(periodic_task_count(), 4, "all task threads registered");
+    zassert_is_null(periodic_task_get(4), "no task past the end");
+}
+
+ZTEST(periodic, test_runs_on_period)
+{
+    struct periodic_task_stats stats;
+
+    busy_us = 1000;
+    run_window(&on_time_task, &stats);
+
+    zassert_within(stats.runs, WINDOW_MS / 10 + 1, 1, "one run per period, %u runs", stats.runs);
+    zassert_equal(stats.runs, atomic_get(&calls), "every run counted");
+    zassert_equal(stats.deadline_misses, 0, "no deadline missed");
+    zassert_equal(stats.skipped, 0, "no release skipped");
+    zassert_true(stats.exec_max_us >= busy_us, "execution time covers the busy wait");
+    TC_PRINT("Release jitter max %u us, execution max %u us\n", stats.jitter_max_us, stats.exec_max_us);
+}
+
+ZTEST(periodic, test_deadline_miss)
+{
+    struct periodic_task_stats stats;
+
+    busy_us = 8000;
+    run_window(&late_task, &stats);
+
+    zassert_true(stats.runs > 0, "task ran");
+    zassert_equal(stats.deadline_misses, stats.runs, "every run late");
+    zassert_equal(stats.skipped, 0, "still within the period");
+}
+
+ZTEST(periodic, test_overrun_skips_releases)
+{
+    struct periodic_task_stats stats;
+
+    busy_us = 25000;
+    run_window(&overrun_task, &stats);
+
+    zassert_true(stats.runs > 0, "task ran");
+    zassert_true(stats.skipped >= stats.runs, "releases during a run are skipped, %u skipped", stats.skipped);
+    zassert_equal(stats.deadline_misses, stats.runs, "every run late");
+}
+
+ZTEST(periodic, test_stop_drops_pending_release)
+{
+    struct periodic_task_stats stats;
+
+    run_window(&on_time_task, &stats);
+    atomic_clear(&calls);
+    k_sleep(K_MSEC(WINDOW_MS));
+    zassert_equal(atomic_get(&calls), 0, "no runs after stop");
+
+    // A dropped release must not leave the task busy
+    run_window(&on_time_task, &stats);
+    zassert_true(atomic_get(&calls) > 0, "task restarts");
+}
+
+ZTEST(periodic, test_wait_idle_completes_run)
+{
+    periodic_task_start(&sleeper_task);
+    k_sleep(K_MSEC(5));
+    periodic_task_stop(&sleeper_task);
+    zassert_false(atomic_get(&finished), "run still in progress after stop");
+
+    periodic_task_wait_idle(&sleeper_task);
+    zassert_true(atomic_get(&finished), "run completed");
+}
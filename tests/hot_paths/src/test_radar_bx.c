@@ -0,0 +1,118 @@
+/**
+ * @file test_radar_bx.c
+ * @brief Tests for the polar occupancy grid of the radar behaviour
+ *
+ * The test thread stands in for the radar processing task and applies every
+ * sample straight after queueing it. Timing covers the whole per-sample
+ * path: queue in, queue out and grid update.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <ztest.h>
+#include "radar_bx.h"
+#include "bench.h"
+
+static struct radar_snapshot before;
+static struct radar_snapshot after;
+
+static void *bx_setup(void)
+{
+    radar_bx_init();
+    return NULL;
+}
+
+ZTEST_SUITE(radar_bx, NULL, bx_setup, NULL, NULL, NULL);
+
+static void submit(uint8_t bin, uint16_t mm)
+{
+    struct radar_sample sample = { .bin = bin, .mm = mm, .timestamp_ms = k_uptime_get_32() };
+    struct radar_sample applied;
+
+    zassert_equal(radar_bx_submit(&sample), 0, "sample queued");
+    zassert_equal(radar_bx_process(&applied), 0, "sample applied");
+    zassert_equal(applied.bin, bin, "same sample out");
+    zassert_equal(radar_bx_process(&applied), -EAGAIN, "queue drained");
+}
+
+ZTEST(radar_bx, test_hit_and_free_space)
+{
+    const uint8_t bin = RADAR_SCAN_BINS / 2;
+    const uint8_t hit = 500 / RADAR_CELL_MM;
+
+    radar_bx_snapshot(&before);
+    submit(bin, 500);
+    radar_bx_snapshot(&after);
+
+    zassert_equal(after.updates, before.updates + 1, "sample applied");
+    zassert_true(after.logodds[bin][hit] > before.logodds[bin][hit] ||
+                 after.logodds[bin][hit] == RADAR_LOGODDS_MAX, "hit cell more occupied");
+    for (uint8_t cell = 0; cell < hit; cell++)
+    {
+        zassert_true(after.logodds[bin][cell] < before.logodds[bin][cell] ||
+                     after.logodds[bin][cell] == RADAR_LOGODDS_MIN, "cell %u more free", cell);
+    }
+    zassert_equal(after.logodds[bin][hit + 1], before.logodds[bin][hit + 1], "cell behind hit untouched");
+    zassert_equal(memcmp(after.logodds[0], before.logodds[0], RADAR_CELLS), 0, "bin outside beam untouched");
+}
+
+ZTEST(radar_bx, test_no_return_clears_ray)
+{
+    const uint8_t bin = 2;
+
+    radar_bx_snapshot(&before);
+    submit(bin, UINT16_MAX);
+    radar_bx_snapshot(&after);
+
+    for (uint8_t cell = 0; cell < RADAR_CELLS; cell++)
+    {
+        zassert_true(after.logodds[bin][cell] <= before.logodds[bin][cell], "cell %u not more occupied", cell);
+    }
+}
+
+ZTEST(radar_bx, test_saturates)
+{
+    const uint8_t bin = RADAR_SCAN_BINS - 3;
+
+    for (int i = 0; i < 50; i++)
+    {
+        submit(bin, 300);
+    }
+    radar_bx_snapshot(&after);
+    zassert_equal(after.logodds[bin][300 / RADAR_CELL_MM], RADAR_LOGODDS_MAX, "occupied limit");
+    zassert_equal(after.logodds[bin][0], RADAR_LOGODDS_MIN, "free limit");
+}
+
+ZTEST(radar_bx, test_out_of_range_bin)
+{
+    struct radar_sample sample = { .bin = RADAR_SCAN_BINS, .mm = 500 };
+
+    radar_bx_snapshot(&before);
+    zassert_equal(radar_bx_submit(&sample), 0, "sample queued");
+    zassert_equal(radar_bx_process(&sample), -EINVAL, "sample discarded");
+    radar_bx_snapshot(&after);
+    zassert_equal(after.updates, before.updates, "grid untouched");
+}
+
+ZTEST(radar_bx, test_bin_bearing)
+{
+    int16_t sin_left, cos_left, sin_right, cos_right;
+
+    radar_bx_bin_bearing(0, &sin_left, &cos_left);
+    radar_bx_bin_bearing(RADAR_SCAN_BINS - 1, &sin_right, &cos_right);
+    zassert_true(sin_left > 0 && sin_right < 0, "bin 0 is left");
+    zassert_within(sin_left, -sin_right, 1, "symmetric");
+    zassert_within(cos_left, cos_right, 1, "symmetric");
+}
+
+ZTEST(radar_bx, test_bench)
+{
+    struct radar_sample sample;
+
+    BENCH("radar_bx_sample",
+          sample.bin = bench_i % RADAR_SCAN_BINS;
+          sample.mm = 200 + (bench_i * 53) % 900;
+          sample.timestamp_ms = bench_i;
+          radar_bx_submit(&sample);
+          radar_bx_process(&sample));
+}
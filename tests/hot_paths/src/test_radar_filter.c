@@ -0,0 +1,81 @@
+/**
+ * @file test_radar_filter.c
+ * @brief Tests for the per-bin radar distance filter
+ */
+
+#include <ztest.h>
+#include "radar_filter.h"
+#include "bench.h"
+
+#define BINS    20
+
+static struct radar_filter filter;
+
+static void filter_before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+    radar_filter_init(&filter, BINS);
+}
+
+ZTEST_SUITE(radar_filter, NULL, NULL, filter_before, NULL, NULL);
+
+static void feed(uint8_t bin, uint16_t mm, uint8_t times)
+{
+    for (uint8_t i = 0; i < times; i++)
+    {
+        radar_filter_update(&filter, bin, mm);
+    }
+}
+
+ZTEST(radar_filter, test_initial_state)
+{
+    zassert_equal(filter.mm[0], RADAR_FILTER_NO_RETURN, "starts as no return");
+    zassert_equal(filter.confidence[0], 0, "starts with no confidence");
+    zassert_equal(radar_filter_update(&filter, 3, 500), 500, "first sample taken as is");
+    zassert_equal(filter.confidence[3], RADAR_FILTER_CONFIDENCE_MAX / 3, "one sample of three");
+}
+
+ZTEST(radar_filter, test_outlier_rejected)
+{
+    feed(4, 500, 3);
+    zassert_equal(radar_filter_update(&filter, 4, 2000), 500, "single outlier");
+    zassert_equal(filter.confidence[4], (2 * RADAR_FILTER_CONFIDENCE_MAX) / 3, "two of three agree");
+}
+
+ZTEST(radar_filter, test_dropout)
+{
+    feed(5, 500, 3);
+    zassert_equal(radar_filter_update(&filter, 5, RADAR_FILTER_NO_RETURN), 500, "single dropout");
+    zassert_equal(radar_filter_update(&filter, 5, RADAR_FILTER_NO_RETURN), RADAR_FILTER_NO_RETURN,
+                  "most of the window without a return");
+    zassert_equal(filter.confidence[5], (2 * RADAR_FILTER_CONFIDENCE_MAX) / 3, "two of three without a return");
+}
+
+ZTEST(radar_filter, test_step_and_smoothing)
+{
+    feed(6, 500, 3);
+    feed(6, 1000, 2);
+    zassert_equal(filter.mm[6], 1000, "large step taken immediately");
+
+    feed(7, 500, 3);
+    feed(7, 540, 2);
+    zassert_equal(filter.mm[7], 510, "small step smoothed");
+}
+
+ZTEST(radar_filter, test_bins_independent)
+{
+    feed(8, 500, 3);
+    zassert_equal(filter.mm[9], RADAR_FILTER_NO_RETURN, "neighbour untouched");
+    zassert_equal(radar_filter_update(&filter, BINS, 500), RADAR_FILTER_NO_RETURN, "bin out of range");
+}
+
+ZTEST(radar_filter, test_bench)
+{
+    uint32_t out = 0;
+
+    // Noisy returns around 600 mm with occasional dropouts, like a real sweep
+    BENCH("radar_filter_update",
+          out += radar_filter_update(&filter, bench_i % BINS,
+                                     (bench_i % 7 == 0) ? RADAR_FILTER_NO_RETURN : 600 + (bench_i * 37) % 60));
+    BENCH_KEEP(out);
+}
@@ -0,0 +1,116 @@
+/**
+ * @file test_radar_frame.c
+ * @brief Tests for the binary radar sweep frame encoder
+ */
+
+#include <ztest.h>
+#include <zephyr/sys/byteorder.h>
+#include "radar_frame.h"
+#include "bench.h"
+
+#define BINS    20
+#define MTU_PAYLOAD     244
+
+static struct radar_frame_encoder enc;
+static uint16_t mm[BINS];
+static uint8_t confidence[BINS];
+static uint8_t buf[RADAR_FRAME_MAX_LEN];
+
+static void frame_before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+    radar_frame_encoder_init(&enc, BINS);
+    for (uint8_t i = 0; i < BINS; i++)
+    {
+        mm[i] = 300 + 20 * i;
+        confidence[i] = 200;
+    }
+}
+
+ZTEST_SUITE(radar_frame, NULL, NULL, frame_before, NULL, NULL);
+
+ZTEST(radar_frame, test_keyframe)
+{
+    int len = radar_frame_encode(&enc, mm, confidence, 0x12345678, true,
+                                 buf, MTU_PAYLOAD);
+
+    zassert_equal(len, RADAR_FRAME_HDR_LEN + BINS * 3, "dense length");
+    zassert_equal(buf[0], RADAR_FRAME_VERSION, "version");
+    zassert_equal(buf[1], RADAR_FRAME_FLAG_KEYFRAME | RADAR_FRAME_FLAG_CONFIDENCE, "flags");
+    zassert_equal(sys_get_le16(&buf[2]), 1, "sequence");
+    zassert_equal(sys_get_le32(&buf[4]), 0x12345678, "timestamp");
+    zassert_equal(buf[8], BINS, "bin count");
+    zassert_equal(buf[9], BINS, "entries");
+    zassert_equal(sys_get_le16(&buf[10 + 3 * 5]), mm[5], "distance of bin 5");
+    zassert_equal(buf[10 + 3 * 5 + 2], 200, "confidence of bin 5");
+}
+
+ZTEST(radar_frame, test_delta)
+{
+    int len;
+
+    radar_frame_encode(&enc, mm, NULL, 0, true, buf, MTU_PAYLOAD);
+
+    mm[3] += RADAR_FRAME_DELTA_THRESHOLD_MM - 1;
+    len = radar_frame_encode(&enc, mm, NULL, 0, true, buf, MTU_PAYLOAD);
+    zassert_equal(len, RADAR_FRAME_HDR_LEN, "change below threshold left out");
+    zassert_equal(buf[1], RADAR_FRAME_FLAG_SPARSE, "sparse flags");
+
+    mm[7] = 1500;
+    len = radar_frame_encode(&enc, mm, NULL, 0, true, buf, MTU_PAYLOAD);
+    zassert_equal(len, RADAR_FRAME_HDR_LEN + RADAR_FRAME_SPARSE_ENTRY_LEN, "one entry");
+    zassert_equal(buf[9], 1, "entries");
+    zassert_equal(buf[10], 7, "bin of entry");
+    zassert_equal(sys_get_le16(&buf[11]), 1500, "distance of entry");
+}
+
+ZTEST(radar_frame, test_delta_falls_back_to_dense)
+{
+    int len;
+
+    radar_frame_encode(&enc, mm, NULL, 0, true, buf, MTU_PAYLOAD);
+    for (uint8_t i = 0; i < BINS; i++)
+    {
+        mm[i] += 100;
+    }
+    len = radar_frame_encode(&enc, mm, NULL, 0, true, buf, MTU_PAYLOAD);
+    zassert_equal(len, RADAR_FRAME_HDR_LEN + BINS * RADAR_FRAME_DENSE_ENTRY_LEN, "dense is smaller");
+    zassert_true(buf[1] & RADAR_FRAME_FLAG_KEYFRAME, "keyframe");
+}
+
+ZTEST(radar_frame, test_keyframe_interval)
+{
+    for (uint8_t i = 0; i <= RADAR_FRAME_KEYFRAME_INTERVAL; i++)
+    {
+        radar_frame_encode(&enc, mm, NULL, 0, true, buf, MTU_PAYLOAD);
+        zassert_equal(buf[1] & RADAR_FRAME_FLAG_KEYFRAME, (i == 0) ? RADAR_FRAME_FLAG_KEYFRAME : 0,
+                      "frame %u", i);
+    }
+    radar_frame_encode(&enc, mm, NULL, 0, true, buf, MTU_PAYLOAD);
+    zassert_true(buf[1] & RADAR_FRAME_FLAG_KEYFRAME, "forced keyframe");
+}
+
+ZTEST(radar_frame, test_no_space)
+{
+    zassert_equal(radar_frame_encode(&enc, mm, NULL, 0, true, buf, 20), -ENOSPC,
+                  "buffer too small");
+    zassert_equal(enc.seq, 0, "sequence not advanced");
+}
+
+ZTEST(radar_frame, test_bench)
+{
+    int32_t out = 0;
+
+    BENCH("radar_frame_encode_key",
+          out += radar_frame_encode(&enc, mm, confidence, bench_i, false,
+                                    buf, MTU_PAYLOAD));
+    BENCH_KEEP(out);
+
+    // Two bins move each sweep
+    BENCH("radar_frame_encode_delta",
+          mm[bench_i % BINS] += 50;
+          mm[(bench_i + 7) % BINS] -= 50;
+          out += radar_frame_encode(&enc, mm, confidence, bench_i, true,
+                                    buf, MTU_PAYLOAD));
+    BENCH_KEEP(out);
+}
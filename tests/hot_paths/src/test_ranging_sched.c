@@ -0,0 +1,79 @@
+/**
+ * @file test_ranging_sched.c
+ * @brief Tests for the multi-sensor ultrasonic firing scheduler
+ */
+
+#include <ztest.h>
+#include "ranging_sched.h"
+
+#define SEPARATION_DEG  90
+
+static struct ranging_sched sched;
+
+ZTEST_SUITE(ranging_sched, NULL, NULL, NULL, NULL, NULL);
+
+ZTEST(ranging_sched, test_angle_between)
+{
+    zassert_equal(ranging_sched_angle_between(0, 180), 180, "opposed");
+    zassert_equal(ranging_sched_angle_between(170, -170), 20, "across the wrap");
+    zassert_equal(ranging_sched_angle_between(-90, 90), 180, "left and right");
+    zassert_equal(ranging_sched_angle_between(30, 30), 0, "same bearing");
+}
+
+ZTEST(ranging_sched, test_single_sensor)
+{
+    const struct ranging_sched_sensor front = { .bearing_deg = 0, .spread_deg = 45 };
+
+    zassert_equal(ranging_sched_init(&sched, &front, 1, SEPARATION_DEG), 0, "one sensor");
+    zassert_equal(sched.slot_count, 1, "one slot");
+    zassert_equal(ranging_sched_next(&sched), BIT(0), "fired every time");
+    zassert_equal(ranging_sched_next(&sched), BIT(0), "fired every time");
+}
+
+ZTEST(ranging_sched, test_opposed_sensors_fire_together)
+{
+    const struct ranging_sched_sensor sensors[] = {
+        { .bearing_deg = 0, .spread_deg = 45 },         // Swept front
+        { .bearing_deg = 180, .spread_deg = 0 },        // Rear
+    };
+
+    ranging_sched_init(&sched, sensors, ARRAY_SIZE(sensors), SEPARATION_DEG);
+    zassert_equal(sched.slot_count, 1, "no cross talk, one slot");
+    zassert_equal(ranging_sched_next(&sched), BIT(0) | BIT(1), "both every time");
+}
+
+ZTEST(ranging_sched, test_ring_interleaved)
+{
+    const struct ranging_sched_sensor sensors[] = {
+        { .bearing_deg = 0, .spread_deg = 45 },         // Swept front
+        { .bearing_deg = 90, .spread_deg = 0 },         // Left
+        { .bearing_deg = 180, .spread_deg = 0 },        // Rear
+        { .bearing_deg = -90, .spread_deg = 0 },        // Right
+    };
+
+    ranging_sched_init(&sched, sensors, ARRAY_SIZE(sensors), SEPARATION_DEG);
+    zassert_equal(sched.slot_count, 2, "four sensors in two slots");
+    zassert_equal(ranging_sched_next(&sched), BIT(0) | BIT(2), "front with rear");
+    zassert_equal(ranging_sched_next(&sched), BIT(1) | BIT(3), "left with right");
+    zassert_equal(ranging_sched_next(&sched), BIT(0) | BIT(2), "round robin");
+}
+
+ZTEST(ranging_sched, test_close_sensors_separated)
+{
+    const struct ranging_sched_sensor sensors[] = {
+        { .bearing_deg = 20, .spread_deg = 0 },
+        { .bearing_deg = -20, .spread_deg = 0 },
+        { .bearing_deg = 0, .spread_deg = 0 },
+    };
+
+    ranging_sched_init(&sched, sensors, ARRAY_SIZE(sensors), SEPARATION_DEG);
+    zassert_equal(sched.slot_count, 3, "every sensor hears the others");
+}
+
+ZTEST(ranging_sched, test_invalid)
+{
+    const struct ranging_sched_sensor sensors[RANGING_SCHED_MAX_SENSORS + 1] = { 0 };
+
+    zassert_equal(ranging_sched_init(&sched, sensors, 0, SEPARATION_DEG), -EINVAL, "no sensors");
+    zassert_equal(ranging_sched_init(&sched, sensors, ARRAY_SIZE(sensors), SEPARATION_DEG), -EINVAL, "too many");
+}
@@ -0,0 +1,145 @@
+/**
+ * @file test_safety.c
+ * @brief Tests for the obstacle avoidance reflex
+ */
+
+#include <ztest.h>
+#include "safety.h"
+#include "motor.h"
+#include "radar_bx.h"
+#include "libs/ultrasonic_hc-sr04.h"
+#include "bench.h"
+
+#define SECTOR_BIN      10      // Straight ahead
+#define SIDE_BIN        0       // Far left, outside the forward sector
+
+static uint16_t forward_limit;
+
+// Stands in for the motor thread
+void motor_forward_limit_set(uint16_t limit)
+{
+    forward_limit = limit;
+}
+
+static void safety_before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+    forward_limit = 0;
+    safety_init();
+    safety_config_set(SAFETY_STOP_MM_DEFAULT, SAFETY_SLOW_MM_DEFAULT);
+}
+
+ZTEST_SUITE(safety, NULL, NULL, safety_before, NULL, NULL);
+
+ZTEST(safety, test_init_lifts_limit)
+{
+    zassert_equal(forward_limit, MOTOR_FORWARD_LIMIT_NONE, "no limit");
+}
+
+ZTEST(safety, test_slow_stop_clear)
+{
+    struct safety_event ev;
+
+    zassert_false(safety_range_update(SECTOR_BIN, 1000, 1000, &ev), "clear stays clear");
+    zassert_equal(forward_limit, MOTOR_FORWARD_LIMIT_NONE, "no limit");
+
+    // 600 mm closed in a second projects to 220 mm
+    zassert_true(safety_range_update(SECTOR_BIN, 400, 2000, &ev), "slow down");
+    zassert_equal(ev.action, SAFETY_SLOW, "action");
+    zassert_equal(ev.closure_mm_s, 600, "closure");
+    zassert_equal(ev.limit, 50, "limit");
+    zassert_equal(forward_limit, 50, "motor limit");
+
+    zassert_false(safety_range_update(SIDE_BIN, 100, 2050, &ev), "outside sector ignored");
+    zassert_equal(forward_limit, 50, "motor limit kept");
+
+    zassert_true(safety_range_update(SECTOR_BIN, 150, 2100, &ev), "stop");
+    zassert_equal(ev.action, SAFETY_STOP, "action");
+    zassert_equal(forward_limit, 0, "forward vetoed");
+
+    zassert_true(safety_range_update(SECTOR_BIN, 1000, 2500, &ev), "clear");
+    zassert_equal(ev.action, SAFETY_CLEAR, "action");
+    zassert_equal(forward_limit, MOTOR_FORWARD_LIMIT_NONE, "limit lifted");
+}
+
+ZTEST(safety, test_stale_range_ignored)
+{
+    struct safety_event ev;
+
+    zassert_true(safety_range_update(SECTOR_BIN, 100, 1000, &ev), "stop");
+    zassert_true(safety_range_update(SECTOR_BIN + 1, 1000, 1000 + SAFETY_RANGE_MAX_AGE_MS + 1, &ev),
+                 "old range dropped");
+    zassert_equal(ev.action, SAFETY_CLEAR, "action");
+}
+
+ZTEST(safety, test_fault_holds_limit)
+{
+    struct safety_event ev;
+
+    zassert_true(safety_range_update(SECTOR_BIN, 100, 1000, &ev), "stop");
+    zassert_false(safety_range_update(SECTOR_BIN, HC_SR04_FAULT_MM, 1025, &ev), "fault keeps the stop");
+    zassert_equal(forward_limit, 0, "forward still vetoed");
+
+    zassert_true(safety_range_update(SECTOR_BIN, HC_SR04_NO_RETURN_MM, 1050, &ev), "no return clears");
+    zassert_equal(ev.action, SAFETY_CLEAR, "action");
+    zassert_equal(forward_limit, MOTOR_FORWARD_LIMIT_NONE, "limit lifted");
+}
+
+ZTEST(safety, test_faults_only_stop)
+{
+    struct safety_event ev;
+
+    zassert_false(safety_range_update(SECTOR_BIN, 1000, 1000, &ev), "clear");
+    zassert_false(safety_range_update(SECTOR_BIN, HC_SR04_FAULT_MM, 1500, &ev), "last good range still fresh");
+    zassert_true(safety_range_update(SECTOR_BIN, HC_SR04_FAULT_MM, 1000 + SAFETY_RANGE_MAX_AGE_MS + 1, &ev),
+                 "only faults since");
+    zassert_equal(ev.action, SAFETY_STOP, "action");
+    zassert_equal(ev.range_mm, HC_SR04_FAULT_MM, "reported as a fault");
+    zassert_equal(forward_limit, 0, "forward vetoed");
+
+    zassert_true(safety_range_update(SECTOR_BIN, 1000, 2100, &ev), "good range again");
+    zassert_equal(forward_limit, MOTOR_FORWARD_LIMIT_NONE, "limit lifted");
+}
+
+ZTEST(safety, test_reset_lifts_limit)
+{
+    struct safety_event ev;
+
+    zassert_true(safety_range_update(SECTOR_BIN, 100, 1000, &ev), "stop");
+    safety_reset();
+    zassert_equal(forward_limit, MOTOR_FORWARD_LIMIT_NONE, "no limit");
+    zassert_false(safety_range_update(SECTOR_BIN, 1000, 1025, &ev), "starts from clear");
+}
+
+ZTEST(safety, test_fixed_sensors)
+{
+    struct safety_event ev;
+
+    zassert_false(safety_sensor_update(1, 180, 100, 1000, &ev), "rear sensor ignored");
+    zassert_equal(forward_limit, MOTOR_FORWARD_LIMIT_NONE, "no limit");
+
+    zassert_true(safety_sensor_update(2, 10, 100, 1000, &ev), "forward sensor stops");
+    zassert_equal(ev.action, SAFETY_STOP, "action");
+    zassert_equal(ev.bin, SAFETY_SENSOR_BIN(2), "reported as the sensor");
+    zassert_false(safety_range_update(SECTOR_BIN, 1000, 1025, &ev), "clear bin does not lift it");
+    zassert_equal(forward_limit, 0, "forward vetoed");
+
+    zassert_true(safety_sensor_update(2, 10, HC_SR04_NO_RETURN_MM, 1050, &ev), "sensor clear");
+    zassert_equal(forward_limit, MOTOR_FORWARD_LIMIT_NONE, "limit lifted");
+}
+
+ZTEST(safety, test_config)
+{
+    zassert_equal(safety_config_set(300, 300), -EINVAL, "slow must be beyond stop");
+    zassert_equal(safety_config_set(100, 400), 0, "valid");
+}
+
+ZTEST(safety, test_bench)
+{
+    struct safety_event ev;
+    uint32_t out = 0;
+
+    BENCH("safety_range_update",
+          out += safety_range_update(bench_i % RADAR_SCAN_BINS, 300 + (bench_i * 29) % 800, bench_i * 15, &ev));
+    BENCH_KEEP(out);
+}